@@ -0,0 +1,98 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "connectionPool.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    /**
+     * @brief Echo server running an EventLoop on its own thread.
+     */
+    class EchoServer
+    {
+    public:
+        EchoServer()
+            : m_listener("127.0.0.1", "", false)
+        {
+            m_listener.bind();
+            EventLoop::Handlers handlers;
+            handlers.onReadable = [this](int fd)
+            {
+                char buffer[512];
+                ssize_t bytes;
+                while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+                {
+                    ::send(fd, buffer, static_cast<size_t>(bytes), MSG_NOSIGNAL);
+                }
+                if (bytes == 0)
+                {
+                    m_loop.remove(fd);
+                }
+            };
+            m_loop.listen(m_listener, handlers);
+            m_thread = std::thread([this] { m_loop.run(); });
+        }
+
+        ~EchoServer()
+        {
+            m_loop.stop();
+            m_thread.join();
+        }
+
+        std::string GetPort()
+        {
+            return m_listener.GetPort();
+        }
+
+    private:
+        TCPv4Connection m_listener;
+        EventLoop m_loop;
+        std::thread m_thread;
+    };
+} // namespace
+
+// Short request/response over a new connection each time: lookup, socket, handshake, exchange.
+static void BM_FreshConnectionRequest(benchmark::State& state)
+{
+    EchoServer server;
+    for (auto _ : state)
+    {
+        auto connection = createConnection("127.0.0.1", server.GetPort(), true, TCP);
+        connection->connect();
+        connection->send("ping");
+        benchmark::DoNotOptimize(connection->receive());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FreshConnectionRequest);
+
+// Same exchange over a connection leased from the pool: one round trip once warm.
+static void BM_PooledConnectionRequest(benchmark::State& state)
+{
+    EchoServer server;
+    ConnectionPool pool;
+    for (auto _ : state)
+    {
+        ConnectionPool::Lease lease = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+        lease->send("ping");
+        benchmark::DoNotOptimize(lease->receive());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["reused"] = static_cast<double>(pool.counters().reused);
+}
+BENCHMARK(BM_PooledConnectionRequest);
@@ -0,0 +1,263 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "cppSocket.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <poll.h>
+
+namespace
+{
+    constexpr auto SOCKET_BUFFER = 4 * 1024 * 1024; // Kernel buffers of every socket, so UDP bursts are not dropped.
+    constexpr auto ECHO_TIMEOUT_MS = 2000;          // Longest wait for an echo before a datagram counts as lost.
+
+    enum Transport
+    {
+        TCP4,
+        TCP6,
+        UDP4,
+        UDP6,
+        UNIX,
+        UNIX_PACKET
+    };
+
+    const char* transportName(int transport)
+    {
+        static const char* names[] = {"TCPv4", "TCPv6", "UDPv4", "UDPv6", "UnixStream", "UnixSeqPacket"};
+        return names[transport];
+    }
+
+    const char* loopbackAddress(int transport)
+    {
+        return transport == TCP6 || transport == UDP6 ? "::1" : "127.0.0.1";
+    }
+
+    int protocolMacro(int transport)
+    {
+        static const int macros[] = {TCP, TCP, UDP, UDP, UNIX_STREAM, UNIX_SEQPACKET};
+        return macros[transport];
+    }
+
+    /**
+     * @brief Echo server running on its own thread: an EventLoop for TCP and Unix domain sockets, a
+     * recvfrom loop for UDP. Unix domain servers listen on an automatic abstract name.
+     */
+    class EchoServer
+    {
+    public:
+        explicit EchoServer(int transport)
+            : m_stop(false)
+        {
+            SocketOptions options;
+            options.sendBuffer = SOCKET_BUFFER;
+            options.receiveBuffer = SOCKET_BUFFER;
+            const bool isUnix = transport == UNIX || transport == UNIX_PACKET;
+            const bool isUdp = transport == UDP4 || transport == UDP6;
+            m_listener = createConnection(isUnix ? "" : loopbackAddress(transport), "", true, protocolMacro(transport),
+                                          options);
+            m_listener->bind();
+            m_address = isUnix ? static_cast<UnixConnection&>(*m_listener).GetPath() : loopbackAddress(transport);
+            m_thread = isUdp ? std::thread([this] { serveUdp(); }) : std::thread([this] { serveTcp(); });
+        }
+
+        ~EchoServer()
+        {
+            m_stop = true;
+            m_loop.stop();
+            m_thread.join();
+        }
+
+        std::string GetPort()
+        {
+            return m_listener->GetPort();
+        }
+
+        const std::string& address() const
+        {
+            return m_address;
+        }
+
+    private:
+        void serveTcp()
+        {
+            // Echoes go through a write queue per client, so large messages never block the loop. Each client
+            // has a single message in flight, so a sequenced packet is never merged with the next one.
+            std::unordered_map<int, std::unique_ptr<WriteQueue>> queues;
+            EventLoop::Handlers handlers;
+            handlers.onReadable = [this, &queues](int fd)
+            {
+                std::vector<char> buffer(65536);
+                ssize_t bytes;
+                while ((bytes = ::recv(fd, buffer.data(), buffer.size(), 0)) > 0)
+                {
+                    queues.at(fd)->write(std::string_view(buffer.data(), static_cast<size_t>(bytes)));
+                }
+                if (bytes == 0)
+                {
+                    queues.erase(fd);
+                    m_loop.remove(fd);
+                }
+            };
+            handlers.onWritable = [&queues](int fd) { queues.at(fd)->flush(); };
+            handlers.onClosed = [&queues](int fd) { queues.erase(fd); };
+            auto onAccept = [&queues](int fd) { queues[fd] = std::make_unique<WriteQueue>(fd, SIZE_MAX, 0); };
+            m_loop.listen(*m_listener, handlers, onAccept);
+            m_loop.run();
+        }
+
+        void serveUdp()
+        {
+            std::vector<char> buffer(UDP_MAX_PAYLOAD);
+            struct pollfd pollFd = {m_listener->getSocket(), POLLIN, 0};
+            while (!m_stop)
+            {
+                if (::poll(&pollFd, 1, 100) <= 0)
+                {
+                    continue;
+                }
+                struct sockaddr_storage peer;
+                socklen_t peerLength = sizeof(peer);
+                ssize_t bytes = ::recvfrom(m_listener->getSocket(), buffer.data(), buffer.size(), 0,
+                                           reinterpret_cast<struct sockaddr*>(&peer), &peerLength);
+                if (bytes > 0)
+                {
+                    ::sendto(m_listener->getSocket(), buffer.data(), static_cast<size_t>(bytes), 0,
+                             reinterpret_cast<struct sockaddr*>(&peer), peerLength);
+                }
+            }
+        }
+
+        std::unique_ptr<IConnection> m_listener;
+        std::string m_address;
+        EventLoop m_loop;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+
+    double percentile(std::vector<double>& samples, double rank)
+    {
+        if (samples.empty())
+        {
+            return 0;
+        }
+        auto position = samples.begin() + static_cast<ptrdiff_t>(rank * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), position, samples.end());
+        return *position;
+    }
+} // namespace
+
+// Echo round trips over loopback: every iteration each client sends one message and waits for its echo.
+// Arguments: transport, message size, clients. Latencies are per message, from its send to the last byte
+// of its echo; bytes_per_second counts echoed payload bytes.
+static void BM_LoopbackRoundTrip(benchmark::State& state)
+{
+    const int transport = static_cast<int>(state.range(0));
+    const auto messageSize = static_cast<size_t>(state.range(1));
+    const auto clientCount = static_cast<size_t>(state.range(2));
+
+    EchoServer server(transport);
+    SocketOptions options;
+    options.sendBuffer = SOCKET_BUFFER;
+    options.receiveBuffer = SOCKET_BUFFER;
+    options.noDelay = true;
+
+    std::vector<std::unique_ptr<IConnection>> clients;
+    std::vector<struct pollfd> pollFds;
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        const int protocol = protocolMacro(transport);
+        clients.push_back(createConnection(server.address(), server.GetPort(), true, protocol, options));
+        clients.back()->connect();
+        pollFds.push_back({clients.back()->getSocket(), POLLIN, 0});
+    }
+
+    const std::string message(messageSize, 'x');
+    std::vector<char> buffer(std::max<size_t>(messageSize, 65536));
+    std::vector<size_t> received(clientCount);
+    std::vector<std::chrono::steady_clock::time_point> sentAt(clientCount);
+    std::vector<double> latencies;
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < clientCount; ++i)
+        {
+            sentAt[i] = std::chrono::steady_clock::now();
+            clients[i]->send(message);
+            received[i] = 0;
+            pollFds[i].events = POLLIN;
+        }
+
+        size_t pending = clientCount;
+        while (pending > 0)
+        {
+            if (::poll(pollFds.data(), pollFds.size(), ECHO_TIMEOUT_MS) <= 0)
+            {
+                state.SkipWithError("echo lost");
+                return;
+            }
+            for (size_t i = 0; i < clientCount; ++i)
+            {
+                if ((pollFds[i].revents & POLLIN) == 0 || pollFds[i].events == 0)
+                {
+                    continue;
+                }
+                ssize_t bytes = ::recv(pollFds[i].fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+                received[i] += bytes > 0 ? static_cast<size_t>(bytes) : 0;
+                if (received[i] >= messageSize)
+                {
+                    std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - sentAt[i];
+                    latencies.push_back(latency.count());
+                    pollFds[i].events = 0;
+                    --pending;
+                }
+            }
+        }
+    }
+
+    state.SetLabel(transportName(transport));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(clientCount));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(clientCount * messageSize));
+    state.counters["p50_us"] = percentile(latencies, 0.50);
+    state.counters["p99_us"] = percentile(latencies, 0.99);
+    state.counters["p999_us"] = percentile(latencies, 0.999);
+}
+
+// Every transport, 64 B to 1 MB messages (UDP up to its largest datagram, sequenced packets up to 64 KiB)
+// and 1 to 64 clients. The Unix domain rows give the same-host cost next to TCP over loopback.
+static void LoopbackMatrix(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({"transport", "size", "clients"});
+    for (int transport : {TCP4, TCP6, UDP4, UDP6, UNIX, UNIX_PACKET})
+    {
+        const bool isUdp = transport == UDP4 || transport == UDP6;
+        for (int64_t size : {64, 1024, 16384, 65536, 1 << 20})
+        {
+            // A datagram cannot carry 64 KiB, the largest UDP message is the largest payload instead. A
+            // sequenced packet must fit in the send buffer, capped by net.core.wmem_max.
+            if ((isUdp || transport == UNIX_PACKET) && size > 65536)
+            {
+                continue;
+            }
+            const int64_t messageSize = isUdp ? std::min<int64_t>(size, UDP_MAX_PAYLOAD) : size;
+            for (int64_t clients : {1, 8, 64})
+            {
+                benchmark->Args({transport, messageSize, clients});
+            }
+        }
+    }
+}
+BENCHMARK(BM_LoopbackRoundTrip)->Apply(LoopbackMatrix)->UseRealTime();
@@ -0,0 +1,112 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "cppSocket.hpp"
+
+#include <benchmark/benchmark.h>
+#include <sys/mman.h>
+
+namespace
+{
+    constexpr auto SEND_FILE_SIZE = 64 << 20; // Bytes of the file streamed per iteration.
+    constexpr auto READ_CHUNK = 1 << 20;      // Bytes read per call by the copying path.
+
+    /**
+     * @brief Connected pair whose receiving side is drained by a background thread.
+     */
+    class DrainedPair
+    {
+    public:
+        DrainedPair()
+            : m_server("127.0.0.1", "", true)
+        {
+            m_server.bind();
+            m_client = std::make_unique<TCPv4Connection>("127.0.0.1", m_server.GetPort(), true);
+            m_client->connect();
+            m_serverFd = m_server.connect();
+            m_drainer = std::thread(
+                [this]
+                {
+                    std::vector<std::byte> buffer(1 << 20);
+                    while (m_server.receiveFrom(m_serverFd, buffer) > 0)
+                    {
+                    }
+                });
+        }
+
+        ~DrainedPair()
+        {
+            m_client.reset();
+            m_drainer.join();
+            ::close(m_serverFd);
+        }
+
+        TCPv4Connection& client()
+        {
+            return *m_client;
+        }
+
+    private:
+        TCPv4Connection m_server;
+        std::unique_ptr<TCPv4Connection> m_client;
+        int m_serverFd;
+        std::thread m_drainer;
+    };
+
+    int makeFile()
+    {
+        int fd = memfd_create("sendfile-benchmark", MFD_CLOEXEC);
+        std::string chunk(READ_CHUNK, 'x');
+        for (int written = 0; written < SEND_FILE_SIZE; written += READ_CHUNK)
+        {
+            benchmark::DoNotOptimize(::write(fd, chunk.data(), chunk.size()));
+        }
+        return fd;
+    }
+} // namespace
+
+// File streamed the copying way: read into a string, then send() it.
+static void BM_ReadAndSend(benchmark::State& state)
+{
+    int fd = makeFile();
+    DrainedPair pair;
+    std::string buffer(READ_CHUNK, '\0');
+    for (auto _ : state)
+    {
+        for (off_t offset = 0; offset < SEND_FILE_SIZE; offset += READ_CHUNK)
+        {
+            ssize_t bytes = ::pread(fd, buffer.data(), buffer.size(), offset);
+            pair.client().send(buffer.substr(0, static_cast<size_t>(bytes)));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * SEND_FILE_SIZE);
+    ::close(fd);
+}
+BENCHMARK(BM_ReadAndSend)->UseRealTime();
+
+// Same file through sendFile(): no copy through user space.
+static void BM_SendFile(benchmark::State& state)
+{
+    int fd = makeFile();
+    DrainedPair pair;
+    for (auto _ : state)
+    {
+        pair.client().sendFile(fd, 0, SEND_FILE_SIZE);
+    }
+    state.SetBytesProcessed(state.iterations() * SEND_FILE_SIZE);
+    ::close(fd);
+}
+BENCHMARK(BM_SendFile)->UseRealTime();
@@ -0,0 +1,100 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "sharedMemoryConnection.hpp"
+
+#include <benchmark/benchmark.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+// Cost of the data path alone: one message written and read back through a ring by the same thread.
+static void BM_SharedMemoryRingTransfer(benchmark::State& state)
+{
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    int memfd = memfd_create("ringBenchmark", MFD_CLOEXEC);
+    if (memfd < 0 || ftruncate(memfd, static_cast<off_t>(SharedMemoryRing::segmentSize(SHM_RING_CAPACITY))) < 0)
+    {
+        state.SkipWithError("cannot create shared memory");
+        return;
+    }
+    SharedMemoryRing producer(memfd, 0, SHM_RING_CAPACITY, eventfd(0, EFD_NONBLOCK), eventfd(0, EFD_NONBLOCK));
+    SharedMemoryRing consumer(memfd, 0, SHM_RING_CAPACITY, eventfd(0, EFD_NONBLOCK), eventfd(0, EFD_NONBLOCK));
+    ::close(memfd);
+
+    const std::string message(messageSize, 'x');
+    std::string_view part = message;
+    for (auto _ : state)
+    {
+        producer.tryWrite(std::span<const std::string_view>(&part, 1));
+        benchmark::DoNotOptimize(consumer.peek());
+        consumer.release();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(messageSize));
+}
+BENCHMARK(BM_SharedMemoryRingTransfer)->Arg(64)->Arg(1024)->Arg(16384);
+
+// Echo round trips through the shared memory rings. Arguments: message size and busy spin in microseconds;
+// with 0 every wait sleeps on the eventfd, otherwise both sides poll the ring first and a round trip
+// needs no syscall as long as each process has a core of its own.
+static void BM_SharedMemoryRoundTrip(benchmark::State& state)
+{
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    const std::chrono::microseconds spin(state.range(1));
+    if (spin.count() > 0 && std::thread::hardware_concurrency() < 2)
+    {
+        state.SkipWithError("busy spinning needs two cores");
+        return;
+    }
+
+    SharedMemoryConnection server("", true);
+    server.setBusySpin(spin);
+    server.bind();
+
+    std::thread echo(
+        [path = server.GetPath(), spin]
+        {
+            SharedMemoryConnection client(path, true);
+            client.setBusySpin(spin);
+            client.connect();
+            std::vector<std::byte> buffer(client.maxMessage());
+            ssize_t bytes;
+            while ((bytes = client.receive(buffer)) > 0)
+            {
+                std::string_view part(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(bytes));
+                client.send(std::span<const std::string_view>(&part, 1));
+            }
+        });
+
+    const int clientFd = server.connect();
+    const std::string message(messageSize, 'x');
+    std::vector<std::byte> buffer(messageSize);
+    for (auto _ : state)
+    {
+        server.sendto(message, clientFd);
+        benchmark::DoNotOptimize(server.receiveFrom(clientFd, buffer));
+    }
+
+    // Closing the handshake socket ends the echo loop.
+    server.disconnect(clientFd);
+    echo.join();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(messageSize));
+}
+BENCHMARK(BM_SharedMemoryRoundTrip)
+    ->ArgNames({"size", "spin_us"})
+    ->ArgsProduct({{64, 1024, 16384}, {0, 50}})
+    ->UseRealTime();
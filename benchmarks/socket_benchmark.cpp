@@ -0,0 +1,85 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "cppSocket.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Loopback transfer through an IConnection reference: virtual send(span) and receiveFrom(socket, span).
+static void BM_VirtualSendReceive(benchmark::State& state)
+{
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    const std::string message(messageSize, 'x');
+    std::vector<std::byte> buffer(messageSize);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    const int serverFd = server.connect();
+
+    IConnection& sender = client;
+    IConnection& receiver = server;
+    std::string_view part = message;
+    for (auto _ : state)
+    {
+        sender.send(std::span<const std::string_view>(&part, 1));
+        size_t received = 0;
+        while (received < messageSize)
+        {
+            received += static_cast<size_t>(receiver.receiveFrom(serverFd, std::span(buffer).subspan(received)));
+        }
+    }
+
+    ::close(serverFd);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(messageSize));
+}
+BENCHMARK(BM_VirtualSendReceive)->Arg(64)->Arg(1024)->Arg(8192);
+
+// Same transfer through Socket<Tcp, IPv4>: the send and receive calls inline down to the syscall.
+static void BM_InlineSendReceive(benchmark::State& state)
+{
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    const std::string message(messageSize, 'x');
+    std::vector<std::byte> buffer(messageSize);
+
+    Socket<Tcp, IPv4> listener;
+    auto address = IPv4::any(0);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listener.bind(address);
+    listener.listen();
+    address.sin_port = htons(listener.localPort());
+    Socket<Tcp, IPv4> client;
+    client.connect(address);
+    auto server = listener.accept();
+
+    for (auto _ : state)
+    {
+        client.send(message);
+        size_t received = 0;
+        while (received < messageSize)
+        {
+            received += static_cast<size_t>(server->receive(std::span(buffer).subspan(received)));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(messageSize));
+}
+BENCHMARK(BM_InlineSendReceive)->Arg(64)->Arg(1024)->Arg(8192);
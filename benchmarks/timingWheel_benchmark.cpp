@@ -0,0 +1,79 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "timingWheel.hpp"
+
+#include <benchmark/benchmark.h>
+#include <map>
+
+// Arm and cancel one timer next to a population of pending ones, as a connection deadline does.
+static void BM_TimingWheelArmCancel(benchmark::State& state)
+{
+    TimingWheel wheel;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        wheel.schedule(std::chrono::milliseconds(1000 + i % 60000), [] {});
+    }
+
+    for (auto _ : state)
+    {
+        uint64_t id = wheel.schedule(std::chrono::milliseconds(30000), [] {});
+        benchmark::DoNotOptimize(wheel.cancel(id));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimingWheelArmCancel)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+// Same operation on an ordered map keyed by deadline, the structure the event loop used before.
+static void BM_OrderedMapArmCancel(benchmark::State& state)
+{
+    using Key = std::pair<std::chrono::steady_clock::time_point, uint64_t>;
+    std::map<Key, std::function<void()>> timers;
+    const auto now = std::chrono::steady_clock::now();
+    uint64_t nextId = 0;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        timers.emplace(Key {now + std::chrono::milliseconds(1000 + i % 60000), ++nextId}, [] {});
+    }
+
+    for (auto _ : state)
+    {
+        auto it = timers.emplace(Key {std::chrono::steady_clock::now() + std::chrono::seconds(30), ++nextId}, [] {});
+        timers.erase(it.first);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OrderedMapArmCancel)->Arg(1000)->Arg(100000)->Arg(1000000);
+
+// Push back an idle deadline, done on every event of a connection with an idle timeout.
+static void BM_TimingWheelRestart(benchmark::State& state)
+{
+    TimingWheel wheel;
+    std::vector<uint64_t> ids;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        ids.push_back(wheel.schedule(std::chrono::milliseconds(1000 + i % 60000), [] {}));
+    }
+
+    size_t next = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(wheel.reschedule(ids[next], std::chrono::seconds(60)));
+        next = next + 1 == ids.size() ? 0 : next + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimingWheelRestart)->Arg(100000);
@@ -0,0 +1,85 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "cppSocket.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    constexpr auto DATAGRAM_SIZE = 64; // Small telemetry-like datagrams.
+    constexpr auto BATCH_SIZE = 32;    // Datagrams moved per sendmmsg/recvmmsg.
+
+    const char* loopbackAddress(bool ipv6)
+    {
+        return ipv6 ? "::1" : "127.0.0.1";
+    }
+} // namespace
+
+// One datagram per send() and per receive(): two syscalls per packet.
+static void BM_UdpSingleDatagram(benchmark::State& state)
+{
+    const bool ipv6 = state.range(0) != 0;
+    UDPConnection server(loopbackAddress(ipv6), "", true, ipv6);
+    server.bind();
+    UDPConnection client(loopbackAddress(ipv6), server.GetPort(), true, ipv6);
+    client.connect();
+
+    const std::string datagram(DATAGRAM_SIZE, 'd');
+    std::array<std::byte, MAX_MESSAGE_LENGTH> buffer;
+    for (auto _ : state)
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            client.send(datagram);
+        }
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            benchmark::DoNotOptimize(server.receive(buffer));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+    state.SetLabel(ipv6 ? "IPv6" : "IPv4");
+}
+BENCHMARK(BM_UdpSingleDatagram)->Arg(0)->Arg(1);
+
+// BATCH_SIZE datagrams per sendmmsg() and recvmmsg().
+static void BM_UdpBatch(benchmark::State& state)
+{
+    const bool ipv6 = state.range(0) != 0;
+    UDPConnection server(loopbackAddress(ipv6), "", true, ipv6);
+    server.bind();
+    UDPConnection client(loopbackAddress(ipv6), server.GetPort(), true, ipv6);
+    client.connect();
+
+    const std::string datagram(DATAGRAM_SIZE, 'd');
+    std::vector<std::string_view> datagrams(BATCH_SIZE, datagram);
+    DatagramBatch batch(BATCH_SIZE, DATAGRAM_SIZE);
+    for (auto _ : state)
+    {
+        client.sendBatch(datagrams);
+        size_t received = 0;
+        while (received < BATCH_SIZE)
+        {
+            received += server.receiveBatch(batch);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+    state.SetLabel(ipv6 ? "IPv6" : "IPv4");
+}
+BENCHMARK(BM_UdpBatch)->Arg(0)->Arg(1);
@@ -0,0 +1,76 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "cppSocket.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    constexpr auto SEGMENT_SIZE = 1400; // Datagram payload fitting an Ethernet MTU.
+    constexpr auto SEGMENTS = 44;       // Segments per super-buffer, below UDP_MAX_PAYLOAD.
+} // namespace
+
+// Bulk stream sent one datagram per send() and read one datagram per receive().
+static void BM_UdpBulkPerDatagram(benchmark::State& state)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    const std::string datagram(SEGMENT_SIZE, 's');
+    std::vector<std::byte> buffer(UDP_MAX_PAYLOAD);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < SEGMENTS; ++i)
+        {
+            client.send(datagram);
+        }
+        for (int i = 0; i < SEGMENTS; ++i)
+        {
+            benchmark::DoNotOptimize(server.receive(buffer));
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * SEGMENTS * SEGMENT_SIZE);
+}
+BENCHMARK(BM_UdpBulkPerDatagram);
+
+// Same stream sent with one UDP_SEGMENT sendmsg and read back as UDP_GRO super-buffers.
+static void BM_UdpBulkOffload(benchmark::State& state)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    server.enableReceiveOffload(true);
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    const std::string superBuffer(SEGMENTS * SEGMENT_SIZE, 's');
+    std::vector<std::byte> buffer(UDP_MAX_PAYLOAD);
+    for (auto _ : state)
+    {
+        client.sendSegmented(superBuffer, SEGMENT_SIZE);
+        size_t received = 0;
+        while (received < superBuffer.size())
+        {
+            received += server.receiveCoalesced(buffer).data.size();
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * SEGMENTS * SEGMENT_SIZE);
+}
+BENCHMARK(BM_UdpBulkOffload);
@@ -0,0 +1,108 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "uringLoop.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    constexpr auto URING_BATCH = 32; // Messages queued between two runOnce() calls.
+} // namespace
+
+// Loopback transfer through the blocking send()/receiveFrom() calls: one syscall per send and per recv.
+static void BM_BlockingLoopback(benchmark::State& state)
+{
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    const std::string message(messageSize, 'x');
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    uint64_t syscalls = 0;
+    for (auto _ : state)
+    {
+        client.send(message);
+        ++syscalls;
+
+        size_t received = 0;
+        while (received < messageSize)
+        {
+            received += server.receiveFrom(serverFd).size();
+            ++syscalls;
+        }
+    }
+
+    ::close(serverFd);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(messageSize));
+    state.counters["syscalls_per_msg"] = static_cast<double>(syscalls) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_BlockingLoopback)->Arg(64)->Arg(1024)->Arg(8192);
+
+// Same transfer through UringLoop: batched sendmsg submissions and a multishot recv on the receiver.
+static void BM_UringLoopback(benchmark::State& state)
+{
+    if (!UringLoop::isSupported())
+    {
+        state.SkipWithError("io_uring is not supported");
+        return;
+    }
+
+    const auto messageSize = static_cast<size_t>(state.range(0));
+    const std::string message(messageSize, 'x');
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    UringLoop loop;
+    size_t received = 0;
+    UringLoop::Handlers handlers;
+    handlers.onData = [&received](int, std::string_view data) { received += data.size(); };
+    loop.add(serverFd, handlers);
+    loop.add(client.getSocket(), {});
+
+    const uint64_t enterCallsBefore = loop.stats().enterCalls;
+    for (auto _ : state)
+    {
+        for (int i = 0; i < URING_BATCH; ++i)
+        {
+            loop.send(client.getSocket(), message);
+        }
+        while (received < messageSize * URING_BATCH)
+        {
+            loop.runOnce(-1);
+        }
+        received -= messageSize * URING_BATCH;
+    }
+
+    loop.remove(serverFd);
+    loop.remove(client.getSocket());
+    ::close(serverFd);
+
+    const int64_t messages = state.iterations() * URING_BATCH;
+    state.SetItemsProcessed(messages);
+    state.SetBytesProcessed(messages * static_cast<int64_t>(messageSize));
+    state.counters["syscalls_per_msg"] =
+        static_cast<double>(loop.stats().enterCalls - enterCallsBefore) / static_cast<double>(messages);
+}
+BENCHMARK(BM_UringLoopback)->Arg(64)->Arg(1024)->Arg(8192);
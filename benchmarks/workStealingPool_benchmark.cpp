@@ -0,0 +1,153 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "workStealingPool.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    constexpr auto SKEW_ROOTS = 8;             // Tasks submitted from outside the pool per iteration.
+    constexpr auto SKEW_HEAVY_CHILDREN = 4096; // Children spawned by the first root.
+    constexpr auto SKEW_LIGHT_CHILDREN = 8;    // Children spawned by every other root.
+
+    /**
+     * @brief Naive pool: every worker pops from one queue protected by one mutex.
+     */
+    class SharedQueuePool
+    {
+    public:
+        explicit SharedQueuePool(size_t threads)
+        {
+            for (size_t i = 0; i < threads; ++i)
+            {
+                m_threads.emplace_back([this] { work(); });
+            }
+        }
+
+        ~SharedQueuePool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wake.notify_all();
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        void submit(Task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+                ++m_pending;
+            }
+            m_wake.notify_one();
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_idle.wait(lock, [this] { return m_pending == 0; });
+        }
+
+    private:
+        void work()
+        {
+            while (true)
+            {
+                Task task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_pending == 0)
+                {
+                    m_idle.notify_all();
+                }
+            }
+        }
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::deque<Task> m_tasks;
+        size_t m_pending = 0;
+        bool m_stopping = false;
+    };
+
+    // Stand-in for handler work such as parsing a request.
+    void handlerWork()
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 500; ++i)
+        {
+            benchmark::DoNotOptimize(value += static_cast<uint64_t>(i) * 2654435761u);
+        }
+    }
+
+    // One root fans out into far more work than the others, as a hot connection would.
+    template<typename Pool>
+    void runSkewed(benchmark::State& state)
+    {
+        Pool pool(static_cast<size_t>(state.range(0)));
+        for (auto _ : state)
+        {
+            for (int root = 0; root < SKEW_ROOTS; ++root)
+            {
+                const int children = root == 0 ? SKEW_HEAVY_CHILDREN : SKEW_LIGHT_CHILDREN;
+                pool.submit(
+                    [&pool, children]
+                    {
+                        for (int i = 0; i < children; ++i)
+                        {
+                            pool.submit(handlerWork);
+                        }
+                    });
+            }
+            pool.wait();
+        }
+        state.SetItemsProcessed(state.iterations() *
+                                (SKEW_HEAVY_CHILDREN + (SKEW_ROOTS - 1) * SKEW_LIGHT_CHILDREN + SKEW_ROOTS));
+    }
+} // namespace
+
+// Skewed fan-out through a single mutex-protected queue.
+static void BM_SharedQueueSkewed(benchmark::State& state)
+{
+    runSkewed<SharedQueuePool>(state);
+}
+BENCHMARK(BM_SharedQueueSkewed)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// Same workload through per-worker deques with stealing.
+static void BM_WorkStealingSkewed(benchmark::State& state)
+{
+    runSkewed<WorkStealingPool>(state);
+}
+BENCHMARK(BM_WorkStealingSkewed)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
@@ -0,0 +1,95 @@
+/*
+ * Socket Library - cppSocketWrapperBenchmark
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "zeroCopySender.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    /**
+     * @brief Connected pair whose receiving side is drained by a background thread.
+     */
+    class DrainedPair
+    {
+    public:
+        DrainedPair()
+            : m_server("127.0.0.1", "", true)
+        {
+            m_server.bind();
+            m_client = std::make_unique<TCPv4Connection>("127.0.0.1", m_server.GetPort(), true);
+            m_client->connect();
+            m_serverFd = m_server.connect();
+            m_drainer = std::thread(
+                [this]
+                {
+                    std::vector<std::byte> buffer(1 << 20);
+                    while (m_server.receiveFrom(m_serverFd, buffer) > 0)
+                    {
+                    }
+                });
+        }
+
+        ~DrainedPair()
+        {
+            m_client.reset();
+            m_drainer.join();
+            ::close(m_serverFd);
+        }
+
+        TCPv4Connection& client()
+        {
+            return *m_client;
+        }
+
+    private:
+        TCPv4Connection m_server;
+        std::unique_ptr<TCPv4Connection> m_client;
+        int m_serverFd;
+        std::thread m_drainer;
+    };
+
+    void sendPayloads(benchmark::State& state, size_t threshold)
+    {
+        const auto payloadSize = static_cast<size_t>(state.range(0));
+        const std::string payload(payloadSize, 'x');
+        DrainedPair pair;
+        ZeroCopySender sender(pair.client(), -1, threshold);
+
+        for (auto _ : state)
+        {
+            sender.send(payload, nullptr);
+        }
+        sender.flush();
+
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(payloadSize));
+        state.counters["kernel_copies"] = static_cast<double>(sender.counters().kernelCopies);
+    }
+} // namespace
+
+// Payloads copied into the socket buffer by a plain send().
+static void BM_CopySend(benchmark::State& state)
+{
+    sendPayloads(state, SIZE_MAX);
+}
+BENCHMARK(BM_CopySend)->Arg(4096)->Arg(65536)->Arg(1 << 20)->UseRealTime();
+
+// Same payloads with MSG_ZEROCOPY; over loopback the kernel still copies and reports it in kernel_copies.
+static void BM_ZeroCopySend(benchmark::State& state)
+{
+    sendPayloads(state, 0);
+}
+BENCHMARK(BM_ZeroCopySend)->Arg(4096)->Arg(65536)->Arg(1 << 20)->UseRealTime();
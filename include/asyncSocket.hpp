@@ -0,0 +1,356 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _ASYNC_SOCKET_HPP
+#define _ASYNC_SOCKET_HPP
+
+#include "cppSocket.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Error thrown by an asynchronous operation whose timeout expired first.
+ */
+class AsyncTimeoutError : public TimeoutError
+{
+public:
+    AsyncTimeoutError()
+        : TimeoutError("Error: asynchronous operation timed out")
+    {
+    }
+};
+
+/**
+ * @brief Error thrown by an asynchronous operation interrupted by AsyncSocket::cancel().
+ */
+class AsyncCanceledError : public std::runtime_error
+{
+public:
+    AsyncCanceledError()
+        : std::runtime_error("Error: asynchronous operation canceled")
+    {
+    }
+};
+
+/**
+ * @brief Storage of the value produced by an AsyncTask coroutine.
+ */
+template <typename T>
+struct AsyncResult
+{
+    std::optional<T> value; ///< Value given to co_return.
+
+    void return_value(T result)
+    {
+        value.emplace(std::move(result));
+    }
+
+    T take()
+    {
+        return std::move(*value);
+    }
+};
+
+/**
+ * @brief Storage of an AsyncTask coroutine that produces no value.
+ */
+template <>
+struct AsyncResult<void>
+{
+    void return_void() {}
+
+    void take() {}
+};
+
+/**
+ * @brief Lazily started coroutine producing a T, awaitable from another coroutine.
+ *
+ * The body starts when the task is awaited and the awaiting coroutine resumes as soon as it
+ * finishes, receiving its value or its exception. Top-level tasks are started with spawn().
+ */
+template <typename T = void>
+class AsyncTask
+{
+public:
+    /**
+     * @brief Coroutine state required by the compiler.
+     */
+    struct promise_type : AsyncResult<T>
+    {
+        std::coroutine_handle<> continuation; ///< Coroutine awaiting this one.
+        std::exception_ptr error;             ///< Exception that escaped the body.
+
+        AsyncTask get_return_object()
+        {
+            return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            // Symmetric transfer: resuming the awaiting coroutine does not grow the stack.
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+            return FinalAwaiter {};
+        }
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+    };
+
+    AsyncTask(AsyncTask&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+
+    AsyncTask& operator=(AsyncTask&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+
+    ~AsyncTask()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    T await_resume()
+    {
+        if (m_handle.promise().error)
+        {
+            std::rethrow_exception(m_handle.promise().error);
+        }
+        return m_handle.promise().take();
+    }
+
+private:
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> m_handle; ///< Frame of the coroutine, owned by the task.
+};
+
+/**
+ * @brief Start a top-level coroutine on the calling thread; it runs until its first suspension.
+ *
+ * The coroutine frame frees itself when the body finishes.
+ *
+ * @param task Coroutine to run, typically a session serving one connection.
+ * @param onError Invoked with an exception escaping the body; such exceptions are dropped when empty.
+ */
+void spawn(AsyncTask<void> task, std::function<void(std::exception_ptr)> onError = nullptr);
+
+/**
+ * @brief Suspend the calling coroutine for a while, using a timer of the loop.
+ *
+ * @param loop Loop the coroutine runs on.
+ * @param delay Time to wait.
+ * @return AsyncTask<void> Task completing once the delay has elapsed.
+ */
+AsyncTask<void> asyncSleep(EventLoop& loop, std::chrono::milliseconds delay);
+
+/**
+ * @brief Socket whose connect, accept, send and receive are awaitable from coroutines.
+ *
+ * The socket is switched to non-blocking mode and registered in an EventLoop; an operation first
+ * tries the system call and only suspends on EAGAIN, to be resumed by the loop once the socket is
+ * ready. Thousands of sessions can then be written as straight-line coroutines on one loop thread;
+ * several threads each running their own loop (see ShardedListener) spread them across cores.
+ * Every operation accepts a timeout and is interrupted by cancel(). Everything must happen on the
+ * thread running the loop, and the loop must not have an executor. The socket must not be destroyed
+ * while one of its operations is suspended: cancel() it first.
+ */
+class AsyncSocket
+{
+public:
+    /**
+     * @brief Construct a new AsyncSocket object on the socket of a connection.
+     *
+     * @param loop Loop resuming the operations.
+     * @param connection Connection providing the socket and the address of asyncConnect(); it keeps
+     * the ownership of the socket.
+     */
+    AsyncSocket(EventLoop& loop, IConnection& connection);
+
+    /**
+     * @brief Construct a new AsyncSocket object on a socket, for instance one obtained from accept.
+     *
+     * @param loop Loop resuming the operations.
+     * @param socket Socket file descriptor.
+     * @param owned Close the socket when the object is destroyed.
+     */
+    AsyncSocket(EventLoop& loop, int socket, bool owned);
+
+    /**
+     * @brief Destroy the AsyncSocket object, removing the socket from the loop.
+     */
+    ~AsyncSocket();
+
+    AsyncSocket(const AsyncSocket&) = delete;
+    AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+    /**
+     * @brief Connect to the address of the connection given at construction.
+     *
+     * @param timeout Time allowed for the handshake, negative for no limit.
+     * @return AsyncTask<void> Task completing once connected; it throws if the connection fails.
+     */
+    AsyncTask<void> asyncConnect(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Accept a client of a listening socket (bind() already called).
+     *
+     * @param timeout Time to wait for a client, negative for no limit.
+     * @return AsyncTask<std::unique_ptr<AsyncSocket>> Task producing the client, registered in the
+     * same loop and owning its socket.
+     */
+    AsyncTask<std::unique_ptr<AsyncSocket>>
+    asyncAccept(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Receive the bytes available, waiting until at least one arrives.
+     *
+     * @param buffer Destination of the bytes; must stay valid until the task completes.
+     * @param timeout Time to wait for data, negative for no limit.
+     * @return AsyncTask<size_t> Task producing the number of bytes received, 0 once the peer closed.
+     */
+    AsyncTask<size_t> asyncReceive(std::span<std::byte> buffer,
+                                   std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Send a whole message, waiting for buffer space as often as needed.
+     *
+     * @param data Message; must stay valid until the task completes.
+     * @param timeout Time allowed for the whole message, negative for no limit.
+     * @return AsyncTask<size_t> Task producing the number of bytes sent.
+     */
+    AsyncTask<size_t> asyncSend(std::string_view data,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Send a message made of several parts with vectored writes.
+     *
+     * @param parts Parts of the message, sent in order; they must stay valid until the task completes.
+     * @param timeout Time allowed for the whole message, negative for no limit.
+     * @return AsyncTask<size_t> Task producing the number of bytes sent.
+     */
+    AsyncTask<size_t> asyncSend(std::span<const std::string_view> parts,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Interrupt the suspended operations, which throw AsyncCanceledError.
+     *
+     * From another thread, post() the call to the loop.
+     */
+    void cancel();
+
+    /**
+     * @brief Get the socket file descriptor.
+     *
+     * @return int File descriptor of the socket.
+     */
+    int getSocket() const
+    {
+        return m_socket;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Outcome
+    {
+        Ready,    ///< The socket became ready.
+        TimedOut, ///< The deadline of the operation passed.
+        Canceled  ///< cancel() was called.
+    };
+
+    struct Waiter
+    {
+        std::coroutine_handle<> handle; ///< Suspended operation.
+        uint64_t timer;                 ///< Timer enforcing the deadline, 0 if none.
+        Outcome outcome;                ///< Reason of the resumption.
+    };
+
+    struct State
+    {
+        EventLoop* loop; ///< Loop the socket is registered in.
+        Waiter* reader;  ///< Operation waiting for readability, nullptr if none.
+        Waiter* writer;  ///< Operation waiting for writability, nullptr if none.
+        bool registered; ///< The socket is still registered in the loop.
+        bool closed;     ///< The loop reported a hang-up or an error.
+    };
+
+    class Wait;
+
+    Wait wait(bool writable, std::optional<Clock::time_point> deadline);
+    static std::optional<Clock::time_point> deadlineAfter(std::chrono::milliseconds timeout);
+    static void wake(State& state, Waiter*& slot, Outcome outcome);
+
+    std::shared_ptr<State> m_state; ///< Shared with the loop handlers and the pending timers.
+    IConnection* m_connection;      ///< Connection given at construction, nullptr for a bare socket.
+    int m_socket;                   ///< Socket file descriptor.
+    bool m_owned;                   ///< The socket is closed on destruction.
+};
+
+#endif // _ASYNC_SOCKET_HPP
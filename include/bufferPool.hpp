@@ -0,0 +1,223 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _BUFFER_POOL_HPP
+#define _BUFFER_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+constexpr auto BUFFER_POOL_CHUNK = 64;        // Macro for slabs carved from each allocation
+constexpr auto BUFFER_POOL_THREAD_CACHE = 32; // Macro for slabs kept by each thread
+
+class BufferPool;
+
+/**
+ * @brief Move-only handle to a slab of a BufferPool, returned to the pool when released.
+ */
+class PooledBuffer
+{
+public:
+    /**
+     * @brief Construct an empty handle.
+     */
+    PooledBuffer() noexcept;
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    /**
+     * @brief Destroy the PooledBuffer object, giving the slab back to its pool.
+     */
+    ~PooledBuffer();
+
+    /**
+     * @brief Give the slab back to its pool now, leaving the handle empty.
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief Get the start of the slab.
+     *
+     * @return std::byte* Slab memory, nullptr for an empty handle.
+     */
+    std::byte* data() const
+    {
+        return m_data;
+    }
+
+    /**
+     * @brief Get the number of bytes in use.
+     *
+     * @return size_t Bytes filled, for instance by a receive.
+     */
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * @brief Get the size of the slab.
+     *
+     * @return size_t Bytes available in the slab.
+     */
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * @brief Set the number of bytes in use.
+     *
+     * @param size New size, at most capacity().
+     */
+    void resize(size_t size);
+
+    /**
+     * @brief Get the whole slab as a writable span.
+     *
+     * @return std::span<std::byte> Slab memory.
+     */
+    std::span<std::byte> span() const
+    {
+        return {m_data, m_capacity};
+    }
+
+    /**
+     * @brief Get the bytes in use as a view.
+     *
+     * @return std::string_view View of the first size() bytes.
+     */
+    std::string_view view() const
+    {
+        return {reinterpret_cast<const char*>(m_data), m_size};
+    }
+
+    /**
+     * @brief Check whether the handle holds a slab.
+     */
+    explicit operator bool() const
+    {
+        return m_data != nullptr;
+    }
+
+private:
+    friend class BufferPool;
+
+    PooledBuffer(BufferPool* pool, std::byte* data, size_t capacity) noexcept;
+
+    BufferPool* m_pool; ///< Pool owning the slab.
+    std::byte* m_data;  ///< Slab memory.
+    size_t m_capacity;  ///< Size of the slab.
+    size_t m_size;      ///< Bytes in use.
+};
+
+/**
+ * @brief Pool of fixed-size buffers (slabs) with per-thread caches.
+ *
+ * Slabs are carved from chunks allocated BUFFER_POOL_CHUNK at a time and never freed before the pool
+ * itself. Each thread keeps a small cache of free slabs, so acquiring and releasing usually touches no
+ * lock and no allocator; caches exchange slabs with a shared free list in batches. Once the working
+ * set is reached the pool allocates nothing, which the counters make observable.
+ * Every PooledBuffer must be released before its pool is destroyed.
+ */
+class BufferPool
+{
+public:
+    /**
+     * @brief Snapshot of the pool activity.
+     */
+    struct Counters
+    {
+        uint64_t chunkAllocations; ///< Calls to the system allocator.
+        uint64_t acquisitions;     ///< Buffers handed out.
+        uint64_t releases;         ///< Buffers given back.
+        uint64_t cacheHits;        ///< Acquisitions served by the thread cache.
+    };
+
+    /**
+     * @brief Construct a new BufferPool object.
+     *
+     * @param slabSize Size of every buffer.
+     * @param slabsPerChunk Number of buffers allocated at once when the pool runs dry.
+     * @param threadCacheSize Number of free buffers each thread keeps before returning some.
+     */
+    explicit BufferPool(size_t slabSize,
+                        size_t slabsPerChunk = BUFFER_POOL_CHUNK,
+                        size_t threadCacheSize = BUFFER_POOL_THREAD_CACHE);
+
+    /**
+     * @brief Destroy the BufferPool object and release its chunks.
+     */
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief Take a buffer from the pool.
+     *
+     * @return PooledBuffer Handle with size() zero and capacity() equal to the slab size.
+     */
+    PooledBuffer acquire();
+
+    /**
+     * @brief Get the size of the buffers of the pool.
+     *
+     * @return size_t Slab size.
+     */
+    size_t slabSize() const
+    {
+        return m_slabSize;
+    }
+
+    /**
+     * @brief Get a snapshot of the pool activity.
+     *
+     * @return Counters Current counter values.
+     */
+    Counters counters() const;
+
+private:
+    friend class PooledBuffer;
+    friend struct BufferPoolThreadCaches;
+
+    void release(std::byte* slab) noexcept;
+    void refill(std::vector<std::byte*>& cache);
+    void drain(std::vector<std::byte*>& cache) noexcept;
+
+    const uint64_t m_id;                                ///< Unique identifier matching thread caches.
+    const size_t m_slabSize;                            ///< Size of every buffer.
+    const size_t m_slabsPerChunk;                       ///< Buffers per chunk.
+    const size_t m_threadCacheSize;                     ///< Free buffers kept per thread.
+    std::mutex m_mutex;                                 ///< Protects the chunks and the shared free list.
+    std::vector<std::unique_ptr<std::byte[]>> m_chunks; ///< Memory of every slab.
+    std::vector<std::byte*> m_free;                     ///< Shared free list.
+    std::atomic<uint64_t> m_chunkAllocations;           ///< Calls to the system allocator.
+    std::atomic<uint64_t> m_acquisitions;               ///< Buffers handed out.
+    std::atomic<uint64_t> m_releases;                   ///< Buffers given back.
+    std::atomic<uint64_t> m_cacheHits;                  ///< Acquisitions served by the thread cache.
+};
+
+#endif // _BUFFER_POOL_HPP
@@ -0,0 +1,235 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _CONNECTION_METRICS_HPP
+#define _CONNECTION_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+constexpr auto HISTOGRAM_SUB_BUCKET_BITS = 3; // Macro for significant bits of every latency bucket
+constexpr auto HISTOGRAM_BUCKETS = (65 - HISTOGRAM_SUB_BUCKET_BITS) << HISTOGRAM_SUB_BUCKET_BITS; // Macro for buckets
+
+/**
+ * @brief Plain copy of a latency histogram, cheap to merge and to query.
+ */
+struct HistogramSnapshot
+{
+    std::array<uint64_t, HISTOGRAM_BUCKETS> buckets {}; ///< Samples per bucket.
+    uint64_t count = 0;                                 ///< Number of samples.
+    uint64_t sum = 0;                                   ///< Sum of the samples, in nanoseconds.
+    uint64_t max = 0;                                   ///< Largest sample, in nanoseconds.
+
+    /**
+     * @brief Get the value below which a fraction of the samples fall.
+     *
+     * @param quantile Fraction between 0 and 1, for instance 0.99.
+     * @return uint64_t Highest value of the bucket holding the quantile (at most max), 0 without samples.
+     */
+    uint64_t percentile(double quantile) const;
+
+    /**
+     * @brief Add the samples of another snapshot.
+     */
+    HistogramSnapshot& operator+=(const HistogramSnapshot& other);
+};
+
+/**
+ * @brief Lock-free latency histogram with log-linear buckets, in the spirit of HdrHistogram.
+ *
+ * Every power of two is split in 2^HISTOGRAM_SUB_BUCKET_BITS buckets, so a recorded value is known
+ * within 12.5% over the whole 64-bit range with a fixed 4 KiB of counters. Recording is a couple of
+ * relaxed atomic increments and may run concurrently on any number of threads.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief Record one sample.
+     *
+     * @param nanoseconds Measured latency.
+     */
+    void record(uint64_t nanoseconds)
+    {
+        m_buckets[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Copy the histogram. Samples recorded meanwhile may or may not be included.
+     *
+     * @return HistogramSnapshot Current buckets and totals.
+     */
+    HistogramSnapshot snapshot() const;
+
+    /**
+     * @brief Drop every sample.
+     */
+    void reset();
+
+    /**
+     * @brief Get the bucket a value is counted in.
+     *
+     * @param value Sample value.
+     * @return size_t Index below HISTOGRAM_BUCKETS.
+     */
+    static size_t bucketIndex(uint64_t value);
+
+    /**
+     * @brief Get the highest value counted in a bucket.
+     *
+     * @param index Index below HISTOGRAM_BUCKETS.
+     * @return uint64_t Upper bound of the bucket, inclusive.
+     */
+    static uint64_t bucketUpperBound(size_t index);
+
+    /**
+     * @brief Times a scope and records its duration in a histogram; does nothing without one.
+     */
+    class Scope
+    {
+    public:
+        /**
+         * @brief Start timing.
+         *
+         * @param histogram Histogram receiving the duration, nullptr to skip the measurement.
+         */
+        explicit Scope(LatencyHistogram* histogram)
+            : m_histogram(histogram)
+            , m_start(histogram != nullptr ? std::chrono::steady_clock::now()
+                                           : std::chrono::steady_clock::time_point {})
+        {
+        }
+
+        /**
+         * @brief Stop timing and record the duration.
+         */
+        ~Scope()
+        {
+            if (m_histogram != nullptr)
+            {
+                auto elapsed = std::chrono::steady_clock::now() - m_start;
+                m_histogram->record(
+                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LatencyHistogram* m_histogram;                 ///< Destination of the duration, may be nullptr.
+        std::chrono::steady_clock::time_point m_start; ///< Start of the scope.
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> m_buckets {}; ///< Samples per bucket.
+    std::atomic<uint64_t> m_count {0};                                 ///< Number of samples.
+    std::atomic<uint64_t> m_sum {0};                                   ///< Sum of the samples.
+    std::atomic<uint64_t> m_max {0};                                   ///< Largest sample.
+};
+
+/**
+ * @brief Plain copy of the metrics of one or several connections.
+ */
+struct MetricsSnapshot
+{
+    uint64_t bytesSent = 0;           ///< Bytes accepted by the kernel.
+    uint64_t bytesReceived = 0;       ///< Bytes read from the kernel.
+    uint64_t messagesSent = 0;        ///< Messages, datagrams or files sent.
+    uint64_t messagesReceived = 0;    ///< Non-empty reads or datagrams received.
+    uint64_t syscalls = 0;            ///< Send, receive and poll system calls made.
+    uint64_t wouldBlock = 0;          ///< Calls that failed with EAGAIN.
+    uint64_t partialWrites = 0;       ///< Writes the kernel only took part of.
+    uint64_t errors = 0;              ///< Calls that failed with any other error.
+    HistogramSnapshot sendLatency;    ///< Duration of send calls, in nanoseconds.
+    HistogramSnapshot receiveLatency; ///< Duration of receive calls, in nanoseconds.
+
+    /**
+     * @brief Add the counters and samples of another snapshot, to aggregate several connections.
+     */
+    MetricsSnapshot& operator+=(const MetricsSnapshot& other);
+
+    /**
+     * @brief Format the snapshot in the Prometheus text exposition format.
+     *
+     * Counters are exported as <prefix>_<name>_total and latencies as summaries in seconds with the
+     * 0.5, 0.9, 0.99 and 0.999 quantiles.
+     *
+     * @param prefix Prefix of every metric name.
+     * @param labels Labels added to every sample, without braces, for instance listener="api".
+     * @return std::string Exposition text, one line per sample.
+     */
+    std::string toPrometheus(std::string_view prefix = "cppsocket", std::string_view labels = "") const;
+};
+
+/**
+ * @brief Counters and latency histograms of a connection, updated with relaxed atomics.
+ *
+ * A listening connection counts the traffic of every socket accepted through it, so its metrics are
+ * the aggregate of the listener.
+ */
+struct ConnectionMetrics
+{
+    std::atomic<uint64_t> bytesSent {0};        ///< Bytes accepted by the kernel.
+    std::atomic<uint64_t> bytesReceived {0};    ///< Bytes read from the kernel.
+    std::atomic<uint64_t> messagesSent {0};     ///< Messages, datagrams or files sent.
+    std::atomic<uint64_t> messagesReceived {0}; ///< Non-empty reads or datagrams received.
+    std::atomic<uint64_t> syscalls {0};         ///< Send, receive and poll system calls made.
+    std::atomic<uint64_t> wouldBlock {0};       ///< Calls that failed with EAGAIN.
+    std::atomic<uint64_t> partialWrites {0};    ///< Writes the kernel only took part of.
+    std::atomic<uint64_t> errors {0};           ///< Calls that failed with any other error.
+    LatencyHistogram sendLatency;               ///< Duration of send calls.
+    LatencyHistogram receiveLatency;            ///< Duration of receive calls.
+
+    /**
+     * @brief Add to one of the counters of optional metrics, without ordering constraints.
+     *
+     * @param metrics Metrics to update, nullptr to do nothing.
+     * @param counter Counter to add to, for instance &ConnectionMetrics::syscalls.
+     * @param value Amount to add.
+     */
+    static void add(ConnectionMetrics* metrics, std::atomic<uint64_t> ConnectionMetrics::*counter, uint64_t value = 1)
+    {
+        if (metrics != nullptr)
+        {
+            (metrics->*counter).fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Copy the counters and histograms.
+     *
+     * @return MetricsSnapshot Current values.
+     */
+    MetricsSnapshot snapshot() const;
+
+    /**
+     * @brief Set every counter back to zero and drop the latency samples.
+     */
+    void reset();
+};
+
+#endif // _CONNECTION_METRICS_HPP
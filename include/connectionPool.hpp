@@ -0,0 +1,218 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _CONNECTION_POOL_HPP
+#define _CONNECTION_POOL_HPP
+
+#include "cppSocket.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+
+constexpr auto POOL_MAX_PER_ENDPOINT = 16;  // Macro for connections opened to the same endpoint
+constexpr auto POOL_IDLE_TIMEOUT_MS = 30000; // Macro for the time an unused connection is kept
+
+/**
+ * @brief Thread-safe pool of connected client connections, keyed by address, port and protocol.
+ *
+ * acquire() hands out an idle connection to the endpoint when a healthy one exists and only falls back
+ * to createConnection() and connect() otherwise, so repeated short exchanges skip the name lookup,
+ * the socket creation and the TCP handshake. Idle connections are checked before reuse (a peer that
+ * closed, reset or left unread bytes is dropped) and evicted after the idle timeout. At most
+ * maxPerEndpoint connections, idle or leased, exist per endpoint; further callers wait for a lease
+ * to come back. The pool must outlive its leases.
+ */
+class ConnectionPool
+{
+public:
+    class Lease;
+
+    /**
+     * @brief Snapshot of the pool activity.
+     */
+    struct Counters
+    {
+        uint64_t created;      ///< Connections opened.
+        uint64_t reused;       ///< Acquisitions served by an idle connection.
+        uint64_t evicted;      ///< Idle connections closed after the idle timeout.
+        uint64_t failedChecks; ///< Idle connections dropped by the health check.
+    };
+
+    /**
+     * @brief Construct a new ConnectionPool object.
+     *
+     * @param maxPerEndpoint Maximum number of connections, idle or leased, per endpoint.
+     * @param idleTimeout Time after which an unused connection is closed.
+     * @param isBlocking Blocking mode of the connections created by the pool.
+     */
+    explicit ConnectionPool(size_t maxPerEndpoint = POOL_MAX_PER_ENDPOINT,
+                            std::chrono::milliseconds idleTimeout = std::chrono::milliseconds(POOL_IDLE_TIMEOUT_MS),
+                            bool isBlocking = true);
+
+    /**
+     * @brief Destroy the ConnectionPool object, closing every idle connection.
+     */
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * @brief Get a connected connection to an endpoint, reusing an idle one when possible.
+     *
+     * @param address Address of the server.
+     * @param port Port of the server.
+     * @param protocolMacro TCP or UDP.
+     * @param timeout Maximum time to wait for a free slot when the endpoint is at its limit, negative to
+     * wait indefinitely.
+     * @return Lease Handle returning the connection to the pool when destroyed.
+     */
+    Lease acquire(const std::string& address,
+                  const std::string& port,
+                  int protocolMacro,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+    /**
+     * @brief Close every idle connection unused for longer than the idle timeout.
+     *
+     * @return size_t Number of connections closed.
+     */
+    size_t evictIdle();
+
+    /**
+     * @brief Get the number of idle connections, all endpoints included.
+     *
+     * @return size_t Connections waiting to be reused.
+     */
+    size_t idleCount() const;
+
+    /**
+     * @brief Get a snapshot of the pool activity.
+     *
+     * @return Counters Current counter values.
+     */
+    Counters counters() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct EndpointKey
+    {
+        std::string address; ///< Address of the server.
+        std::string port;    ///< Port of the server.
+        int protocol;        ///< TCP or UDP.
+
+        auto operator<=>(const EndpointKey&) const = default;
+    };
+
+    struct Idle
+    {
+        std::unique_ptr<IConnection> connection; ///< Connected socket.
+        Clock::time_point lastUsed;              ///< Time the connection was returned.
+    };
+
+    struct Endpoint
+    {
+        std::vector<Idle> idle; ///< Idle connections, most recently used last.
+        size_t leased = 0;      ///< Connections handed out or being opened.
+    };
+
+    void release(Endpoint& endpoint, std::unique_ptr<IConnection> connection, bool reusable);
+    size_t evictExpired(Endpoint& endpoint, Clock::time_point now);
+    static bool isHealthy(IConnection& connection);
+
+    const size_t m_maxPerEndpoint;                 ///< Connections allowed per endpoint.
+    const std::chrono::milliseconds m_idleTimeout; ///< Lifetime of an unused connection.
+    const bool m_isBlocking;                       ///< Blocking mode of created connections.
+    mutable std::mutex m_mutex;                    ///< Protects the endpoints and the counters.
+    std::condition_variable m_released;            ///< Signaled when a slot of an endpoint frees up.
+    std::map<EndpointKey, Endpoint> m_endpoints;   ///< Per-endpoint state; nodes are never erased.
+    Counters m_counters;                           ///< Activity counters.
+};
+
+/**
+ * @brief Move-only handle to a pooled connection, returned to its pool on destruction.
+ */
+class ConnectionPool::Lease
+{
+public:
+    /**
+     * @brief Construct an empty lease.
+     */
+    Lease() = default;
+
+    Lease(Lease&& other) noexcept;
+    Lease& operator=(Lease&& other) noexcept;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    /**
+     * @brief Destroy the Lease object, returning the connection to the pool.
+     */
+    ~Lease();
+
+    /**
+     * @brief Return the connection to the pool now, leaving the lease empty.
+     *
+     * A non-blocking connection with bytes still in its write queue is closed instead of reused.
+     */
+    void release();
+
+    /**
+     * @brief Close the connection instead of returning it, for instance after a protocol error.
+     */
+    void discard();
+
+    /**
+     * @brief Get the leased connection.
+     *
+     * @return IConnection* Connection, nullptr for an empty lease.
+     */
+    IConnection* get() const
+    {
+        return m_connection.get();
+    }
+
+    IConnection* operator->() const
+    {
+        return m_connection.get();
+    }
+
+    IConnection& operator*() const
+    {
+        return *m_connection;
+    }
+
+    /**
+     * @brief Check whether the lease holds a connection.
+     */
+    explicit operator bool() const
+    {
+        return m_connection != nullptr;
+    }
+
+private:
+    friend class ConnectionPool;
+
+    Lease(ConnectionPool* pool, Endpoint* endpoint, std::unique_ptr<IConnection> connection);
+
+    ConnectionPool* m_pool = nullptr;          ///< Pool the connection returns to.
+    Endpoint* m_endpoint = nullptr;            ///< Endpoint of the connection.
+    std::unique_ptr<IConnection> m_connection; ///< Leased connection.
+};
+
+#endif // _CONNECTION_POOL_HPP
@@ -17,36 +17,76 @@
 #ifndef _CPP_SOCKET_LIB_HPP
 #define _CPP_SOCKET_LIB_HPP
 
+#include "bufferPool.hpp"
+#include "connectionMetrics.hpp"
+#include "resolver.hpp"
+#include "socket.hpp"
+#include "socketOptions.hpp"
+#include "timingWheel.hpp"
+#include "workStealingPool.hpp"
+#include "writeQueue.hpp"
+
 #include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 constexpr auto TCP = 1;                    // Macro for TCP
 constexpr auto UDP = 2;                    // Macro for UDP
-constexpr auto ERROR = -1;                 // Macro for error
+constexpr auto UNIX_STREAM = 3;            // Macro for Unix domain stream sockets
+constexpr auto UNIX_SEQPACKET = 4;         // Macro for Unix domain sequenced-packet sockets
 constexpr auto MAX_MESSAGE_LENGTH = 10000; // Macro for message length
-constexpr auto TCP_BACKLOG = 1024;         // Macro for maximum connections
+constexpr auto EPOLL_BATCH_SIZE = 256;     // Macro for events handled per epoll_wait
+constexpr auto SEND_PARTS_INLINE = 16;     // Macro for message parts sent without allocating
+constexpr auto SEND_STALL_TIMEOUT_MS = 1000;// Macro for the wait to finish a message a non-blocking socket took in part
+constexpr auto UDP_SEND_BATCH = 64;        // Macro for datagrams handed to one sendmmsg
+constexpr auto UDP_MAX_SEGMENTS = 64;      // Macro for segments accepted by one UDP_SEGMENT send
+constexpr auto UDP_MAX_PAYLOAD = 65507;    // Macro for the largest UDP payload
+constexpr auto UNIX_MAX_FDS = 253;         // Macro for descriptors passed in one message (SCM_MAX_FD)
+constexpr auto ACCEPT_RETRY_MS = 50;       // Macro for the pause before accepting again after running out of resources
 
 /**
  * @brief Enumeration representing different network protocols.
  */
 enum class Protocol
 {
-    TCPv4, ///< TCP IPv4 protocol.
-    TCPv6, ///< TCP IPv6 protocol.
-    UDPv4, ///< UDP IPv4 protocol.
-    UDPv6  ///< UDP IPv6 protocol.
+    TCPv4,        ///< TCP IPv4 protocol.
+    TCPv6,        ///< TCP IPv6 protocol.
+    UDPv4,        ///< UDP IPv4 protocol.
+    UDPv6,        ///< UDP IPv6 protocol.
+    UnixStream,   ///< Unix domain stream socket.
+    UnixSeqPacket ///< Unix domain sequenced-packet socket, keeping message boundaries.
+};
+
+/**
+ * @brief Socket accepted by a listener, together with the address of the peer.
+ */
+struct AcceptedSocket
+{
+    int socket;           ///< File descriptor of the accepted socket, owned by the caller.
+    ResolvedAddress peer; ///< Address the client connected from.
 };
 
 /**
@@ -100,6 +140,71 @@ public:
      */
     virtual bool sendto(const std::string& message, int fdDestiny) = 0;
 
+    /**
+     * @brief Send a message made of several parts with a single sendmsg, without concatenating them.
+     *
+     * Partial writes are resumed from the first unsent byte until the whole message is out, so a
+     * header and its payload are written as one frame. On UDP the parts form one datagram. On a
+     * non-blocking TCP connection the bytes the socket does not take are kept in writeQueue() instead.
+     *
+     * @param parts Parts of the message, sent in order. At most IOV_MAX parts.
+     * @return true if the message is successfully sent or queued, false if the write queue is throttled.
+     */
+    virtual bool send(std::span<const std::string_view> parts);
+
+    /**
+     * @brief Send a message made of several parts through a specific socket with a single sendmsg.
+     *
+     * A non-blocking socket that cannot take any byte leaves the message unsent; one that took part of it
+     * gets at most SEND_STALL_TIMEOUT_MS to take the rest before TimeoutError is thrown.
+     *
+     * @param parts Parts of the message, sent in order. At most IOV_MAX parts.
+     * @param fdDestiny socket file descriptor to use to send message.
+     * @return true if the message is successfully sent, false if the non-blocking socket was full.
+     */
+    virtual bool sendto(std::span<const std::string_view> parts, int fdDestiny);
+
+    /**
+     * @brief Get the outbound queue of a non-blocking TCP connection.
+     *
+     * Set its watermarks and callbacks to throttle producers, and call flush() whenever the socket
+     * becomes writable (for instance from EventLoop's onWritable) to resume the queued bytes.
+     *
+     * @return WriteQueue* Queue of the connection socket, nullptr for blocking and UDP connections.
+     */
+    WriteQueue* writeQueue()
+    {
+        return m_writeQueue.get();
+    }
+
+    /**
+     * @brief Write the bytes queued by a non-blocking TCP connection until the socket is full.
+     *
+     * @return size_t Number of bytes written, 0 for connections without a write queue.
+     */
+    size_t flush();
+
+    /**
+     * @brief Start counting the traffic of the connection: bytes, messages, syscalls and call latencies.
+     *
+     * Until then the send and receive paths skip every measurement. A listening connection also counts
+     * the sockets it serves through sendto() and receiveFrom(), so its metrics aggregate the listener.
+     * Call it before the connection is shared between threads.
+     *
+     * @return ConnectionMetrics& Metrics of the connection, created on the first call.
+     */
+    ConnectionMetrics& enableMetrics();
+
+    /**
+     * @brief Get the metrics of the connection.
+     *
+     * @return ConnectionMetrics* Metrics, nullptr until enableMetrics() is called.
+     */
+    ConnectionMetrics* metrics()
+    {
+        return m_metrics.get();
+    }
+
     /**
      * @brief Receive a message through the connection.
      *
@@ -115,11 +220,114 @@ public:
     virtual std::string receiveFrom(int socket) = 0;
 
     /**
-     * @brief Change the options of the connection.
+     * @brief Receive bytes through the connection into a caller-owned buffer, without allocating.
+     *
+     * @param buffer Destination of the received bytes.
+     * @return ssize_t Number of bytes received, 0 if the peer closed the connection, ERROR if the
+     * socket is non-blocking and no data is available.
+     */
+    ssize_t receive(std::span<std::byte> buffer);
+
+    /**
+     * @brief Receive bytes through a specific socket into a caller-owned buffer, without allocating.
      *
-     * @return true if the options are successfully changed, false otherwise.
+     * receive(), receiveViewFrom() and receivePooledFrom() read through this call, so a transport that
+     * does not read from the socket itself only needs to override it.
+     *
+     * @param socket Socket file descriptor to read from.
+     * @param buffer Destination of the received bytes.
+     * @return ssize_t Number of bytes received, 0 if the peer closed the connection, ERROR if the
+     * socket is non-blocking and no data is available.
+     */
+    virtual ssize_t receiveFrom(int socket, std::span<std::byte> buffer);
+
+    /**
+     * @brief Receive a message into a buffer owned by the connection.
+     *
+     * The view stays valid until the next receiveView() or receiveViewFrom() call on this connection,
+     * so it must not be shared between threads reading through the same connection object.
+     *
+     * @return std::string_view Received message, empty if the peer closed the connection or if the
+     * socket is non-blocking and no data is available.
+     */
+    std::string_view receiveView();
+
+    /**
+     * @brief Receive a message through a specific socket into a buffer owned by the connection.
+     *
+     * @param socket Socket file descriptor to read from.
+     * @return std::string_view Received message, valid until the next view read on this connection.
      */
-    virtual bool changeOptions() = 0;
+    std::string_view receiveViewFrom(int socket);
+
+    /**
+     * @brief Receive a message into a buffer taken from a pool.
+     *
+     * The buffer can outlive the call and be handed to another thread; releasing it returns the
+     * slab to the pool, so the read path allocates nothing once the pool has warmed up.
+     *
+     * @param pool Pool providing the buffer; its slab size bounds the message length.
+     * @return PooledBuffer Received message, empty if the peer closed the connection or if the
+     * socket is non-blocking and no data is available.
+     */
+    PooledBuffer receivePooled(BufferPool& pool);
+
+    /**
+     * @brief Receive a message through a specific socket into a buffer taken from a pool.
+     *
+     * @param socket Socket file descriptor to read from.
+     * @param pool Pool providing the buffer.
+     * @return PooledBuffer Received message, empty on close or when no data is available.
+     */
+    PooledBuffer receivePooledFrom(int socket, BufferPool& pool);
+
+    /**
+     * @brief Bound the time connect() waits for the handshake of a client connection.
+     *
+     * Receive and send calls are bounded with SocketOptions::receiveTimeout and sendTimeout instead;
+     * sockets accepted by a listener inherit the listener's, which also bounds idle clients.
+     *
+     * @param timeout Longest wait, 0 (the default) to wait for the kernel's own connect timeout.
+     */
+    void setConnectTimeout(std::chrono::milliseconds timeout)
+    {
+        m_connectTimeout = timeout;
+    }
+
+    /**
+     * @brief Accept every client waiting on a listener, with the address each one connected from.
+     *
+     * A blocking listener waits for the first client and then only takes the ones already queued; a
+     * non-blocking one returns 0 when none is waiting. Accepted sockets are close-on-exec and have
+     * the blocking mode of the listener, as with connect().
+     *
+     * @param clients Receives the accepted sockets, appended.
+     * @param maxClients Most clients accepted by one call.
+     * @return size_t Number of clients appended.
+     */
+    size_t acceptAll(std::vector<AcceptedSocket>& clients, size_t maxClients = TCP_BACKLOG);
+
+    /**
+     * @brief Change the options of the connection; can be called at any time.
+     *
+     * Options that must precede bind() or connect() (reuse flags, buffer sizes) only take full
+     * effect when changed before those calls.
+     *
+     * @param options Options to set; the ones without a value are left untouched.
+     * @return true if the options are successfully changed.
+     * @throw std::runtime_error if the kernel rejects an option.
+     */
+    bool changeOptions(const SocketOptions& options);
+
+    /**
+     * @brief Allow several sockets to bind the same address and port (SO_REUSEPORT).
+     *
+     * Must be called before bind(); the kernel then spreads incoming connections or datagrams
+     * across every socket bound with the option.
+     *
+     * @param enable true to set the option, false to clear it.
+     */
+    void setReusePort(bool enable);
 
     /**
      * @brief Get the socket file descriptor.
@@ -138,29 +346,70 @@ public:
         return m_port;
     }
 
+    /**
+     * @brief Get the resolved address the connection connects or binds to.
+     *
+     * @return const ResolvedAddress& Endpoint of the connection, empty when the port is picked by bind().
+     */
+    const ResolvedAddress& GetEndpoint() const
+    {
+        return m_endpoint;
+    }
+
 protected:
-    std::string m_address; ///< IP address of the connection. */
-    std::string m_port;    ///< Port number of the connection. */
-    bool m_isBlocking;     ///< Flag to set the connection as blocking or non-blocking.*/
-    int m_socket;          ///< File descriptor of the socket.
+    std::string m_address;         ///< IP address of the connection. */
+    std::string m_port;            ///< Port number of the connection. */
+    bool m_isBlocking;             ///< Flag to set the connection as blocking or non-blocking.*/
+    int m_socket;                  ///< File descriptor of the socket.
+    ResolvedAddress m_endpoint {}; ///< Resolved address of the connection.
+
+    std::chrono::milliseconds m_connectTimeout {0}; ///< Longest wait of connect(), 0 for none.
+
+    std::unique_ptr<WriteQueue> m_writeQueue;     ///< Unsent bytes of a non-blocking TCP connection.
+    std::unique_ptr<ConnectionMetrics> m_metrics; ///< Traffic counters, nullptr until enabled.
+
+private:
+    std::unique_ptr<std::byte[]> m_viewBuffer; ///< Buffer backing receiveView(), allocated on first use.
 };
 
 /**
- * @brief Class representing a TCP IPv4 connection.
+ * @brief TCP connection over a Socket of the given address family.
+ *
+ * The IConnection calls keep their virtual interface, metrics and write queue; code that knows the
+ * family at compile time can reach the inline send and receive calls of the Socket through stream().
+ *
+ * @tparam Family IPv4 or IPv6.
  */
-class TCPv4Connection : public IConnection
+template <typename Family>
+class TCPConnection : public IConnection
 {
 public:
     /**
-     * @brief Constructor for TCPv4Connection class.
+     * @brief Construct a new TCPConnection object.
+     *
+     * @param address IP address of the remote host, empty for the wildcard address of a listener.
+     * @param port Port number for the connection, empty to let bind() pick a free one.
+     * @param isBlocking Flag indicating whether the connection is blocking.
+     */
+    TCPConnection(const std::string& address, const std::string& port, bool isBlocking);
+
+    /**
+     * @brief Construct a new TCPConnection object from an address already resolved.
      *
-     * @param address IP address of the remote host.
-     * @param port Port number for the connection.
+     * @param endpoint Address of the family, for instance obtained from Resolver::resolveAsync().
      * @param isBlocking Flag indicating whether the connection is blocking.
      */
-    TCPv4Connection(const std::string& address, const std::string& port, bool isBlocking);
+    TCPConnection(const ResolvedAddress& endpoint, bool isBlocking);
 
-    ~TCPv4Connection();
+    /**
+     * @brief Construct a new TCPConnection object around a socket that is already connected.
+     *
+     * connect() then returns at once; this is how connectHappyEyeballs() hands over the winning socket.
+     *
+     * @param stream Connected socket, whose blocking mode the connection takes.
+     * @param endpoint Address the socket is connected to.
+     */
+    TCPConnection(Socket<Tcp, Family>&& stream, const ResolvedAddress& endpoint);
 
     /**
      * @brief Bind the connection to a socket.
@@ -170,29 +419,73 @@ public:
     bool bind() override;
 
     /**
-     * @brief Connect the connection to a socket.
+     * @brief Connect the connection to a socket, or accept a client once bind() was called.
      *
-     * @return int File descriptor of the socket.
+     * A non-blocking client still waits for the handshake to finish. A non-blocking listener returns
+     * ERROR when no client is waiting, and the sockets it accepts are non-blocking as well.
+     *
+     * @return int File descriptor of the accepted socket, or true for a client.
      */
     int connect() override;
 
     /**
      * @brief Send a message through the connection.
      *
+     * A blocking connection returns once every byte is written; a non-blocking one queues the rest
+     * in writeQueue().
+     *
      * @param message Message to be sent.
-     * @return true if the message is successfully sent, false otherwise.
+     * @return true if the message is successfully sent or queued, false if the write queue is throttled.
      */
     bool send(const std::string& message) override;
 
     /**
      * @brief Send a message through a specific socket.
      *
+     * Never blocks the caller on a full non-blocking socket: nothing is written and false is returned, see
+     * IConnection::sendto(). Wrap accepted sockets in their own WriteQueue to queue and throttle instead.
+     *
      * @param message Message to be sent.
      * @param fdDestiny socket file descriptor to use to send message.
-     * @return true if the message is successfully sent, false otherwise.
+     * @return true if the message is successfully sent, false if the non-blocking socket was full.
      */
     bool sendto(const std::string& message, int fdDestiny) override;
 
+    /**
+     * @brief Stream part of a file through the connection without copying it through user space.
+     *
+     * Regular files go through sendfile(2) straight from the page cache; pipes go through splice(2).
+     * Partial writes are resumed until length bytes are sent, the file ends, or a non-blocking socket
+     * runs out of buffer space (or its pipe has no data yet); in the last case the call returns early
+     * and the transfer is resumed by calling again with the offset advanced by the returned count,
+     * typically when the socket becomes writable.
+     *
+     * Bytes still queued in writeQueue() go first: while it cannot be flushed completely nothing is
+     * sent from the file and 0 is returned, so the file never overtakes earlier messages.
+     *
+     * @param fd File descriptor of a regular file or of the read end of a pipe.
+     * @param offset Position in the file of the first byte to send; must be 0 for a pipe.
+     * @param length Number of bytes to send.
+     * @return size_t Number of bytes sent.
+     */
+    size_t sendFile(int fd, off_t offset, size_t length);
+
+    /**
+     * @brief Stream part of a file through a specific socket, see sendFile().
+     *
+     * @param fdDestiny Socket file descriptor to send the file through.
+     * @param fd File descriptor of a regular file or of the read end of a pipe.
+     * @param offset Position in the file of the first byte to send; must be 0 for a pipe.
+     * @param length Number of bytes to send.
+     * @return size_t Number of bytes sent.
+     */
+    size_t sendFileTo(int fdDestiny, int fd, off_t offset, size_t length);
+
+    using IConnection::receive;
+    using IConnection::receiveFrom;
+    using IConnection::send;
+    using IConnection::sendto;
+
     /**
      * @brief Receive a message through the connection.
      *
@@ -208,106 +501,168 @@ public:
     std::string receiveFrom(int socket) override;
 
     /**
-     * @brief Change the options of the connection.
+     * @brief Get the socket file descriptor.
      *
-     * @return true if the options are successfully changed, false otherwise.
+     * @return int File descriptor of the socket.
      */
-    bool changeOptions() override;
+    int getSocket() override;
 
     /**
-     * @brief Get the socket file descriptor.
+     * @brief Get the underlying socket, whose send() and receive() calls are not virtual.
      *
-     * @return int File descriptor of the socket.
+     * They bypass metrics and the write queue.
+     *
+     * @return Socket<Tcp, Family>& Socket of the connection.
      */
-    int getSocket() override;
+    Socket<Tcp, Family>& stream()
+    {
+        return m_stream;
+    }
 
 private:
-    bool autoSelectPort;
-    struct sockaddr_in addrinfo4;
-    std::unique_ptr<addrinfo> m_addrinfo;
-    bool binded = false;
+    Socket<Tcp, Family> m_stream; ///< Owned socket; m_socket is its file descriptor.
+    bool autoSelectPort = false;  ///< The port was empty, bind() picks one.
+    bool binded = false;          ///< bind() succeeded, connect() accepts.
+    bool connected = false;       ///< The handshake is done, connect() returns at once.
+};
+
+extern template class TCPConnection<IPv4>;
+extern template class TCPConnection<IPv6>;
+
+/**
+ * @brief Class representing a TCP IPv4 connection.
+ */
+class TCPv4Connection : public TCPConnection<IPv4>
+{
+public:
+    using TCPConnection<IPv4>::TCPConnection;
 };
 
 /**
  * @brief Class representing a TCP IPv6 connection.
  */
-class TCPv6Connection : public IConnection
+class TCPv6Connection : public TCPConnection<IPv6>
 {
 public:
-    /**
-     * @brief Construct a new TCPv6Connection object.
-     *
-     * @param address IP address of the connection.
-     * @param port Port number of the connection.
-     * @param isBlocking Flag to set the connection as blocking or non-blocking.
-     */
-    TCPv6Connection(const std::string& address, const std::string& port, bool isBlocking);
+    using TCPConnection<IPv6>::TCPConnection;
+};
 
-    ~TCPv6Connection();
 
+/**
+ * @brief Preallocated arena of datagrams filled by UDPConnection::receiveBatch().
+ *
+ * Payload slots, message headers and source addresses are allocated once, so receiving a batch
+ * performs no allocation. The views returned by operator[] stay valid until the next receiveBatch().
+ */
+class DatagramBatch
+{
+public:
     /**
-     * @brief Bind the connection to a socket.
-     *
-     * @return true if the connection is successfully binded, false otherwise.
+     * @brief A received datagram and the address it came from.
      */
-    bool bind() override;
+    struct Datagram
+    {
+        std::string_view data;                 ///< Payload, inside the batch arena.
+        const struct sockaddr_storage& source; ///< IPv4 or IPv6 address of the sender.
+        bool truncated;                        ///< The datagram was larger than the slot.
 
-    /**
-     * @brief Connect the connection to a socket.
-     *
-     * @return int File descriptor of the socket.
-     */
-    int connect() override;
+        /**
+         * @brief Get the IP address of the sender.
+         *
+         * @return std::string Numeric IPv4 or IPv6 address.
+         */
+        std::string sourceAddress() const;
+
+        /**
+         * @brief Get the port of the sender.
+         *
+         * @return std::string Port number.
+         */
+        std::string sourcePort() const;
+    };
 
     /**
-     * @brief Send a message through the connection.
+     * @brief Construct a new DatagramBatch object.
      *
-     * @param message Message to be sent.
-     * @return true if the message is successfully sent, false otherwise.
+     * @param capacity Maximum number of datagrams received per call.
+     * @param datagramSize Size of each payload slot; longer datagrams are truncated.
      */
-    bool send(const std::string& message) override;
+    explicit DatagramBatch(size_t capacity, size_t datagramSize = MAX_MESSAGE_LENGTH);
+
+    // The headers point into the buffers of the batch: a copy would make recvmmsg() write into the
+    // original. Moving keeps the vector buffers, and with them every pointer; the source is left empty.
+    DatagramBatch(const DatagramBatch&) = delete;
+    DatagramBatch& operator=(const DatagramBatch&) = delete;
+    DatagramBatch(DatagramBatch&& other) noexcept;
+    DatagramBatch& operator=(DatagramBatch&& other) noexcept;
 
     /**
-     * @brief Send a message through a specific socket.
+     * @brief Get the number of datagrams received by the last receiveBatch().
      *
-     * @param message Message to be sent.
-     * @param fdDestiny socket file descriptor to use to send message.
-     * @return true if the message is successfully sent, false otherwise.
+     * @return size_t Number of datagrams in the batch.
      */
-    bool sendto(const std::string& message, int fdDestiny) override;
+    size_t size() const
+    {
+        return m_count;
+    }
 
     /**
-     * @brief Receive a message through the connection.
+     * @brief Get the maximum number of datagrams of the batch.
      *
-     * @return std::string Received message.
+     * @return size_t Capacity given at construction.
      */
-    std::string receive() override;
+    size_t capacity() const
+    {
+        return m_headers.size();
+    }
 
     /**
-     * @brief Receive a message through a specific socket
+     * @brief Access a received datagram.
      *
-     * @return std::string Received message.
+     * @param index Position of the datagram, lower than size().
+     * @return Datagram Payload and sender of the datagram.
      */
-    std::string receiveFrom(int socket) override;
+    Datagram operator[](size_t index) const;
+
+private:
+    friend class UDPConnection;
+
+    size_t m_count;                                 ///< Datagrams received by the last call.
+    size_t m_datagramSize;                          ///< Size of each payload slot.
+    std::vector<char> m_arena;                      ///< Payload slots, one after the other.
+    std::vector<struct iovec> m_iov;                ///< One iovec per payload slot.
+    std::vector<struct sockaddr_storage> m_sources; ///< Source address of each slot.
+    std::vector<struct mmsghdr> m_headers;          ///< Headers handed to recvmmsg.
+};
+
+/**
+ * @brief Super-buffer of equally sized datagrams coalesced by UDP_GRO.
+ */
+struct CoalescedDatagrams
+{
+    std::string_view data; ///< Received bytes, in the caller buffer.
+    size_t segmentSize;    ///< Size of every datagram but the last one, which may be shorter.
 
     /**
-     * @brief Change the options of the connection.
+     * @brief Get the number of datagrams in the buffer.
      *
-     * @return true if the options are successfully changed, false otherwise.
+     * @return size_t Number of segments.
      */
-    bool changeOptions() override;
+    size_t segmentCount() const
+    {
+        return segmentSize == 0 ? 0 : (data.size() + segmentSize - 1) / segmentSize;
+    }
 
     /**
-     * @brief Get the socket file descriptor.
+     * @brief Get one datagram of the buffer without copying it.
      *
-     * @return int File descriptor of the socket.
+     * @param index Position of the datagram, lower than segmentCount().
+     * @return std::string_view Payload of the datagram.
      */
-    int getSocket() override;
-
-private:
-    struct sockaddr_in6 addrinfo6;
-    struct addrinfo* addrinfo = NULL;
-    bool binded = false;
+    std::string_view segment(size_t index) const
+    {
+        return data.substr(index * segmentSize, segmentSize);
+    }
 };
 
 /**
@@ -331,6 +686,14 @@ public:
      */
     UDPConnection(const std::string& address, const std::string& port, bool isBlocking, bool IPv6);
 
+    /**
+     * @brief Construct a new UDPConnection object from an address already resolved.
+     *
+     * @param endpoint IPv4 or IPv6 address, for instance obtained from Resolver::resolveAsync().
+     * @param isBlocking Flag to set the connection as blocking or non-blocking.
+     */
+    UDPConnection(const ResolvedAddress& endpoint, bool isBlocking);
+
     /**
      * @brief Destroy the UDPConnection object.
      */
@@ -369,6 +732,11 @@ public:
         return send(message);
     };
 
+    using IConnection::receive;
+    using IConnection::receiveFrom;
+    using IConnection::send;
+    using IConnection::sendto;
+
     /**
      * @brief Receive a message through the connection.
      *
@@ -386,11 +754,59 @@ public:
     };
 
     /**
-     * @brief Change the options of the connection.
+     * @brief Receive up to batch.capacity() datagrams with a single recvmmsg.
+     *
+     * A blocking connection waits for the first datagram only and then takes whatever else is queued.
+     *
+     * @param batch Arena receiving the datagrams and their source addresses.
+     * @return size_t Number of datagrams received, 0 if the connection is non-blocking and none is queued.
+     */
+    size_t receiveBatch(DatagramBatch& batch);
+
+    /**
+     * @brief Send several datagrams to the connected peer with sendmmsg.
+     *
+     * @param datagrams Payloads, one datagram each.
+     * @return size_t Number of datagrams sent, lower than requested if a non-blocking socket is full.
+     */
+    size_t sendBatch(std::span<const std::string_view> datagrams);
+
+    /**
+     * @brief Send several datagrams with sendmmsg, each one to the source of a received datagram.
+     *
+     * @param datagrams Payloads, one datagram each.
+     * @param destinations Batch whose source addresses are used as destinations, in the same order.
+     * @return size_t Number of datagrams sent, lower than requested if a non-blocking socket is full.
+     */
+    size_t sendBatchTo(std::span<const std::string_view> datagrams, const DatagramBatch& destinations);
+
+    /**
+     * @brief Send a large buffer as equally sized datagrams with one sendmsg (UDP_SEGMENT offload).
+     *
+     * The kernel, or the NIC when it supports it, splits the buffer; the last datagram may be shorter.
      *
-     * @return true if the options are successfully changed, false otherwise.
+     * @param buffer Bytes to send, at most UDP_MAX_PAYLOAD and UDP_MAX_SEGMENTS segments.
+     * @param segmentSize Payload size of each datagram.
+     * @return true if the buffer is successfully sent, false if a non-blocking socket is full.
      */
-    bool changeOptions() override;
+    bool sendSegmented(std::string_view buffer, uint16_t segmentSize);
+
+    /**
+     * @brief Enable or disable receive coalescing (UDP_GRO) on the socket.
+     *
+     * @param enable Flag to deliver coalesced super-buffers to receiveCoalesced().
+     */
+    void enableReceiveOffload(bool enable);
+
+    /**
+     * @brief Receive a super-buffer of coalesced datagrams into a caller-owned buffer.
+     *
+     * Without coalescing, or for a lone datagram, the segment size is the datagram length.
+     *
+     * @param buffer Destination of the received bytes, UDP_MAX_PAYLOAD bytes avoid truncation.
+     * @return CoalescedDatagrams Received bytes and segment size, empty if a non-blocking socket has no data.
+     */
+    CoalescedDatagrams receiveCoalesced(std::span<std::byte> buffer);
 
     /**
      * @brief Get the socket file descriptor.
@@ -400,22 +816,471 @@ public:
     int getSocket() override;
 
 private:
-    bool isIPv6, autoSelectPort;          ///< Flag to set the connection as blocking or non-blocking.*/
+    size_t sendBatchImpl(std::span<const std::string_view> datagrams, const DatagramBatch* destinations);
+
+    bool isIPv6, autoSelectPort = false;  ///< Flag to set the connection as blocking or non-blocking.*/
     struct sockaddr_in6 address6;         ///< IP address of the connection. */
     struct sockaddr_in address4;          ///< IP address of the connection. */
-    std::unique_ptr<addrinfo> m_addrinfo; ///< Smart pointer for addrinfo */
+};
+
+/**
+ * @brief Class representing a Unix domain connection between processes of the same host.
+ *
+ * The address is a filesystem path, or a name in the Linux abstract namespace when it starts with '@';
+ * abstract names leave no file behind and vanish with the last socket bound to them. Stream sockets
+ * behave like TCP without the TCP/IP stack; sequenced-packet sockets are just as reliable and ordered
+ * but keep message boundaries, one send() being one receive(). Both kinds can pass file descriptors
+ * to the peer with sendFds() and receiveFds().
+ */
+class UnixConnection : public IConnection
+{
+public:
+    /**
+     * @brief Construct a new UnixConnection object.
+     *
+     * @param path Filesystem path of the socket, '@' followed by an abstract name, or empty to let bind()
+     * pick a free abstract name.
+     * @param isBlocking Flag indicating whether the connection is blocking.
+     * @param seqPacket true for SOCK_SEQPACKET, false for SOCK_STREAM.
+     */
+    UnixConnection(const std::string& path, bool isBlocking, bool seqPacket = false);
+
+    /**
+     * @brief Construct a new UnixConnection object from an address built by makeEndpoint().
+     *
+     * @param endpoint AF_UNIX address; its socket type selects stream or sequenced-packet.
+     * @param isBlocking Flag indicating whether the connection is blocking.
+     */
+    UnixConnection(const ResolvedAddress& endpoint, bool isBlocking);
+
+    /**
+     * @brief Destroy the UnixConnection object, removing the socket file of a bound filesystem path.
+     */
+    ~UnixConnection();
+
+    /**
+     * @brief Build the AF_UNIX address of a path.
+     *
+     * @param path Filesystem path, '@' followed by an abstract name, or empty for an automatic abstract name.
+     * @param socketType SOCK_STREAM or SOCK_SEQPACKET.
+     * @return ResolvedAddress Address usable with connect() and bind().
+     */
+    static ResolvedAddress makeEndpoint(const std::string& path, int socketType = SOCK_STREAM);
+
+    /**
+     * @brief Bind the connection to its path and listen on it.
+     *
+     * A socket file left behind by a process that exited is replaced; a path still served by a live
+     * listener is not, and that listener sees the connect used to probe it as a client hanging up at once.
+     *
+     * @return true if the connection is successfully binded, false otherwise.
+     */
+    bool bind() override;
+
+    /**
+     * @brief Connect the connection to its path, or accept a client once bind() was called.
+     *
+     * @return int File descriptor of the accepted socket, or true for a client.
+     */
+    int connect() override;
+
+    /**
+     * @brief Send a message through the connection.
+     *
+     * On a sequenced-packet socket every call is delivered as one message.
+     *
+     * @param message Message to be sent.
+     * @return true if the message is successfully sent or queued, false if the write queue is throttled.
+     */
+    bool send(const std::string& message) override;
+
+    /**
+     * @brief Send a message through a specific socket, see IConnection::sendto().
+     *
+     * @param message Message to be sent.
+     * @param fdDestiny socket file descriptor to use to send message.
+     * @return true if the message is successfully sent, false if the non-blocking socket was full.
+     */
+    bool sendto(const std::string& message, int fdDestiny) override;
+
+    /**
+     * @brief Send a message together with file descriptors (SCM_RIGHTS).
+     *
+     * The descriptors travel with the first byte of the message, which therefore cannot be empty. The
+     * peer gets duplicates; the caller keeps, and may close, its own. Bytes still queued in writeQueue()
+     * are written first so the message is not reordered.
+     *
+     * @param message Bytes carried with the descriptors, at least one.
+     * @param fds Descriptors to pass, at most UNIX_MAX_FDS.
+     * @return true if the message is sent, false if a non-blocking write queue could not be emptied or the
+     * socket was full.
+     */
+    bool sendFds(std::string_view message, std::span<const int> fds);
+
+    /**
+     * @brief Send a message together with file descriptors through a specific socket, see sendFds().
+     *
+     * @param fdDestiny Socket file descriptor to send the message through.
+     * @param message Bytes carried with the descriptors, at least one.
+     * @param fds Descriptors to pass, at most UNIX_MAX_FDS.
+     * @return true if the message is successfully sent, false if the non-blocking socket was full.
+     */
+    bool sendFdsTo(int fdDestiny, std::string_view message, std::span<const int> fds);
+
+    /**
+     * @brief Receive bytes and the file descriptors passed with them.
+     *
+     * Received descriptors are close-on-exec and owned by the caller.
+     *
+     * @param buffer Destination of the received bytes.
+     * @param fds Vector the received descriptors are appended to.
+     * @return ssize_t Number of bytes received, 0 if the peer closed the connection, ERROR if the
+     * socket is non-blocking and has no data.
+     */
+    ssize_t receiveFds(std::span<std::byte> buffer, std::vector<int>& fds);
+
+    /**
+     * @brief Receive bytes and file descriptors through a specific socket, see receiveFds().
+     *
+     * @param socket Socket file descriptor to receive from.
+     * @param buffer Destination of the received bytes.
+     * @param fds Vector the received descriptors are appended to.
+     * @return ssize_t Number of bytes received, 0 if the peer closed the connection, ERROR if the
+     * socket is non-blocking and has no data.
+     */
+    ssize_t receiveFdsFrom(int socket, std::span<std::byte> buffer, std::vector<int>& fds);
+
+    using IConnection::receive;
+    using IConnection::receiveFrom;
+    using IConnection::send;
+    using IConnection::sendto;
+
+    /**
+     * @brief Receive a message through the connection.
+     *
+     * @return std::string Received message.
+     */
+    std::string receive() override;
+
+    /**
+     * @brief Receive a message through a specific socket
+     *
+     * @return std::string Received message.
+     */
+    std::string receiveFrom(int socket) override;
+
+    /**
+     * @brief Get the socket file descriptor.
+     *
+     * @return int File descriptor of the socket.
+     */
+    int getSocket() override;
+
+    /**
+     * @brief Get the path of the connection, with the name picked by bind() for an empty path.
+     *
+     * @return std::string Filesystem path, or '@' followed by the abstract name.
+     */
+    std::string GetPath()
+    {
+        return m_address;
+    }
+
+    /**
+     * @brief Check whether the connection keeps message boundaries.
+     *
+     * @return true for SOCK_SEQPACKET, false for SOCK_STREAM.
+     */
+    bool isSeqPacket() const
+    {
+        return m_endpoint.socktype == SOCK_SEQPACKET;
+    }
+
+private:
+    void open(bool isBlocking);
+
+    bool binded = false; ///< bind() succeeded, connect() accepts clients.
 };
 
 /**
  * @brief Factory function to create a connection.
  *
- * @param address IP address of the connection.
- * @param port Port number of the connection.
+ * @param address IP address of the connection, or the path of a UNIX_STREAM or UNIX_SEQPACKET connection.
+ * @param port Port number of the connection, ignored for Unix domain connections.
  * @param isBlocking Flag to set the connection as blocking or non-blocking.
  * @param protocolMacro Macro representing the network protocol.
+ * @param options Options applied to the socket right after it is created.
  * @return IConnection* Pointer to the created connection.
  */
-std::unique_ptr<IConnection>
-createConnection(const std::string& address, const std::string& port, bool isBlocking, int protocolMacro);
+std::unique_ptr<IConnection> createConnection(const std::string& address,
+                                              const std::string& port,
+                                              bool isBlocking,
+                                              int protocolMacro,
+                                              const SocketOptions& options = {});
+
+/**
+ * @brief Factory function to create a connection to an address already resolved.
+ *
+ * Together with Resolver::resolveAsync() this lets callers build connections without blocking on
+ * name resolution.
+ *
+ * @param endpoint Resolved address; its family selects IPv4, IPv6 or, with a UNIX_* macro, AF_UNIX.
+ * @param isBlocking Flag to set the connection as blocking or non-blocking.
+ * @param protocolMacro Macro representing the network protocol.
+ * @param options Options applied to the socket right after it is created.
+ * @return std::unique_ptr<IConnection> Pointer to the created connection.
+ */
+std::unique_ptr<IConnection> createConnection(const ResolvedAddress& endpoint,
+                                              bool isBlocking,
+                                              int protocolMacro,
+                                              const SocketOptions& options = {});
+
+/**
+ * @brief Edge-triggered epoll reactor that serves many sockets from a single thread.
+ *
+ * Every registered socket must be non-blocking: with edge-triggered notifications the readable and
+ * writable callbacks are only raised again once the socket has been drained until EAGAIN.
+ * Registration and removal must happen on the thread that runs the loop; only stop() is thread-safe.
+ */
+class EventLoop
+{
+public:
+    /**
+     * @brief Callback invoked with the file descriptor that triggered the event.
+     */
+    using Callback = std::function<void(int fd)>;
+
+    /**
+     * @brief Callback invoked with an accepted socket and the address of its peer.
+     */
+    using AcceptCallback = std::function<void(int fd, const ResolvedAddress& peer)>;
+
+    /**
+     * @brief Callback invoked with the listener that failed to accept or register a client, and the reason.
+     */
+    using ErrorCallback = std::function<void(int fd, const std::string& reason)>;
+
+    /**
+     * @brief Set of callbacks attached to a registered socket. Any of them may be empty.
+     *
+     * A peer that shuts down its side (or closes) is reported through onReadable: recv() returns 0 and
+     * the socket stays registered, so a reply can still be sent. The handler calls remove() once done.
+     */
+    struct Handlers
+    {
+        Callback onReadable;   ///< The socket has data to read, or the peer ended its input.
+        Callback onWritable;   ///< The socket can accept more outbound data.
+        Callback onClosed;     ///< The connection hung up or failed; called once before removal.
+        Callback onErrorQueue; ///< The error queue has entries, such as MSG_ZEROCOPY completions.
+    };
+
+    /**
+     * @brief Construct a new EventLoop object, creating the epoll instance.
+     */
+    EventLoop();
+
+    /**
+     * @brief Destroy the EventLoop object, closing every socket accepted by the loop.
+     */
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Register a socket for readable, writable and closed notifications.
+     *
+     * @param fd Non-blocking socket file descriptor. The caller keeps its ownership.
+     * @param handlers Callbacks to invoke for the socket.
+     */
+    void add(int fd, Handlers handlers);
+
+    /**
+     * @brief Stop watching a socket. Sockets accepted by the loop are also closed.
+     *
+     * @param fd File descriptor previously registered.
+     */
+    void remove(int fd);
+
+    /**
+     * @brief Register a bound listening connection and accept its clients.
+     *
+     * The listening socket is switched to non-blocking mode. On every wakeup the backlog is drained and
+     * each accepted socket is registered, non-blocking and owned by the loop, with the client handlers.
+     *
+     * @param listener Connection on which bind() has already been called.
+     * @param clientHandlers Callbacks attached to every accepted socket.
+     * @param onAccept Optional callback invoked with each accepted file descriptor.
+     */
+    void listen(IConnection& listener, Handlers clientHandlers, Callback onAccept = nullptr);
+
+    /**
+     * @brief Register a bound listening connection, telling onAccept where each client connected from.
+     *
+     * @param listener Connection on which bind() has already been called.
+     * @param clientHandlers Callbacks attached to every accepted socket.
+     * @param onAccept Callback invoked with each accepted file descriptor and its peer address.
+     */
+    void listen(IConnection& listener, Handlers clientHandlers, AcceptCallback onAccept);
+
+    /**
+     * @brief Run the handlers of sockets registered from now on in a thread pool.
+     *
+     * The loop thread then only waits for events and accepts connections, so a slow handler no longer
+     * delays the other sockets. Handlers of one socket never run concurrently: events arriving while
+     * they run are merged and delivered by the same task once it finishes. Handlers running in the pool
+     * may only call post() and stop() on the loop; a closed socket is removed (and closed if the loop
+     * owns it) on the loop thread once its handlers have returned, as is a socket whose handler threw; the
+     * exception is then rethrown by the wait() of the pool. The pool must be idle before the loop is
+     * destroyed.
+     *
+     * @param executor Pool running the handlers, nullptr to run them on the loop thread.
+     */
+    void setExecutor(WorkStealingPool* executor)
+    {
+        m_executor = executor;
+    }
+
+    /**
+     * @brief Report the clients a listener could not take.
+     *
+     * When accept() runs out of descriptors or memory, the loop reports it and tries again after
+     * ACCEPT_RETRY_MS, since the queued clients would otherwise wait for the next one to connect. A client
+     * that cannot be registered is reported and closed.
+     *
+     * @param onError Callback invoked on the loop thread, nullptr to drop the reports.
+     */
+    void setAcceptErrorHandler(ErrorCallback onError)
+    {
+        m_onAcceptError = std::move(onError);
+    }
+
+    /**
+     * @brief Run a task on the loop thread during the next iteration. Safe to call from any thread.
+     *
+     * @param task Work to run, for instance a remove() requested by a handler running in the pool.
+     */
+    void post(Task task);
+
+    /**
+     * @brief Run a task on the loop thread once a delay has elapsed.
+     *
+     * Timers live in a hashed timing wheel with a TIMING_WHEEL_TICK_MS tick: arming, restarting and
+     * cancelling are O(1), and a timer fires up to one tick late, never early. Expired timers run at the
+     * end of runOnce(), whose wait is shortened to the next occupied tick. Must be called from the thread
+     * running the loop.
+     *
+     * @param delay Time to wait before running the task.
+     * @param task Work to run.
+     * @return uint64_t Identifier of the timer, never 0.
+     */
+    uint64_t addTimer(std::chrono::milliseconds delay, Task task);
+
+    /**
+     * @brief Cancel a timer that has not fired yet. Must be called from the thread running the loop.
+     *
+     * @param id Identifier returned by addTimer().
+     * @return true if the timer was pending and will not run, false otherwise.
+     */
+    bool cancelTimer(uint64_t id);
+
+    /**
+     * @brief Move the deadline of a pending timer. Must be called from the thread running the loop.
+     *
+     * @param id Identifier returned by addTimer().
+     * @param delay New delay, counted from now.
+     * @return true if the timer was pending and has been re-armed, false otherwise.
+     */
+    bool restartTimer(uint64_t id, std::chrono::milliseconds delay);
+
+    /**
+     * @brief Close a registered socket that sees no event for a while.
+     *
+     * Every event of the socket pushes the deadline back. Once it passes, the socket is handled as if
+     * the peer hung up: onClosed runs and the socket is removed (and closed if the loop owns it). Call
+     * it from onAccept to bound the idle time of every accepted client. Must be called from the thread
+     * running the loop.
+     *
+     * @param fd File descriptor previously registered, not a listener.
+     * @param timeout Longest idle time, 0 to disable the timeout.
+     */
+    void setIdleTimeout(int fd, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Wait for events once and dispatch them, then run the expired timers.
+     *
+     * @param timeoutMs Maximum time to wait in milliseconds, -1 to wait indefinitely.
+     * @return int Number of events dispatched and timers run.
+     */
+    int runOnce(int timeoutMs = -1);
+
+    /**
+     * @brief Dispatch events until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief Ask a running loop to return. Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of registered sockets, listeners included.
+     *
+     * @return size_t Number of registered sockets.
+     */
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    struct Strand
+    {
+        int fd;            ///< Socket file descriptor.
+        Handlers handlers; ///< Copy of the callbacks, independent of the loop entries.
+        std::mutex mutex;  ///< Protects the fields below.
+        uint32_t events;   ///< Events not yet delivered to the handlers.
+        bool scheduled;    ///< A task is running or queued for the socket.
+        bool closeOnIdle;  ///< Removed while scheduled; the task closes the socket when done.
+    };
+
+    struct Entry
+    {
+        Handlers handlers;                         ///< Callbacks of the socket.
+        Handlers clientHandlers;                   ///< Callbacks given to accepted sockets, listeners only.
+        AcceptCallback onAccept;                   ///< Accept notification, listeners only.
+        uint32_t generation;                       ///< Distinguishes reused file descriptor numbers.
+        bool owned;                                ///< The loop closes the socket on removal.
+        bool listening;                            ///< The socket is a listener.
+        std::shared_ptr<Strand> strand;            ///< Serializes the handlers when an executor is set.
+        uint64_t idleTimer = 0;                    ///< Idle timeout timer, 0 if none.
+        std::chrono::milliseconds idleTimeout {0}; ///< Delay the idle timer is re-armed with.
+        uint64_t acceptTimer = 0;                  ///< Pending accept retry, listeners only, 0 if none.
+    };
+
+    void registerEntry(int fd, Entry entry);
+    void acceptConnections(int listenFd);
+    void retryAccept(int listenFd, uint32_t generation, const std::string& reason);
+    void dispatch(int fd, uint32_t generation, uint32_t events);
+    void schedule(int fd, uint32_t generation, uint32_t events);
+    void runStrand(const std::shared_ptr<Strand>& strand, uint32_t generation);
+    void runPosted();
+    int runTimers();
+    int waitTimeout(int timeoutMs) const;
+    bool isCurrent(int fd, uint32_t generation) const;
+
+    int m_epollFd;                            ///< File descriptor of the epoll instance.
+    int m_wakeFd;                             ///< eventfd used by stop() to interrupt epoll_wait.
+    std::atomic<bool> m_stopRequested;        ///< Flag set by stop() and cleared when run() returns.
+    uint32_t m_nextGeneration;                ///< Generation given to the next registration.
+    std::unordered_map<int, Entry> m_entries; ///< Registered sockets indexed by descriptor.
+    std::vector<struct epoll_event> m_events; ///< Buffer filled by epoll_wait.
+    WorkStealingPool* m_executor;             ///< Pool running the handlers, nullptr for inline dispatch.
+    std::mutex m_postMutex;                   ///< Protects m_posted.
+    std::vector<Task> m_posted;               ///< Tasks waiting to run on the loop thread.
+    TimingWheel m_timers;                     ///< Pending timers hashed by expiry tick.
+    ErrorCallback m_onAcceptError;            ///< Reports clients a listener could not take, may be empty.
+};
 
 #endif // _CPP_SOCKET_LIB_HPP
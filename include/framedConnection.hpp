@@ -0,0 +1,138 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _FRAMED_CONNECTION_HPP
+#define _FRAMED_CONNECTION_HPP
+
+#include "cppSocket.hpp"
+
+#include <optional>
+
+constexpr auto FRAME_READ_SIZE = 65536;           // Macro for bytes requested by each read
+constexpr auto FRAME_MAX_SIZE = 64 * 1024 * 1024; // Macro for the default largest accepted frame
+constexpr auto FRAME_MAX_PREFIX = 10;             // Macro for the longest length prefix (64-bit varint)
+
+/**
+ * @brief Encoding of the length prefix written before every frame.
+ */
+enum class FramePrefix
+{
+    Varint,  ///< Unsigned LEB128 varint, 1 to 10 bytes.
+    FixedU32 ///< 4-byte big-endian unsigned integer.
+};
+
+/**
+ * @brief Length-prefixed message framing over a TCP stream.
+ *
+ * Incoming bytes are accumulated in a per-connection reassembly buffer: a single read may bring in
+ * several frames, which are then handed out one by one as views into that buffer, without a second
+ * copy. The buffer grows on demand, so frames are only limited by the configured maximum size.
+ * Outgoing frames are written as prefix and payload with one vectored send.
+ */
+class FramedConnection
+{
+public:
+    /**
+     * @brief Construct a new FramedConnection object.
+     *
+     * @param connection Connected TCP connection (or listener, together with socket) to frame.
+     * @param prefix Encoding of the length prefix.
+     * @param socket Accepted socket to read and write, -1 to use the socket of the connection itself.
+     * @param maxFrameSize Largest payload accepted from the peer.
+     */
+    FramedConnection(IConnection& connection,
+                     FramePrefix prefix = FramePrefix::FixedU32,
+                     int socket = -1,
+                     size_t maxFrameSize = FRAME_MAX_SIZE);
+
+    /**
+     * @brief Send one frame: the length prefix followed by the payload.
+     *
+     * @param payload Bytes of the message.
+     * @return true if the frame is successfully sent, false otherwise.
+     */
+    bool sendFrame(std::string_view payload);
+
+    /**
+     * @brief Return the next complete frame, reading from the socket only when none is buffered.
+     *
+     * The view stays valid until the next call to receiveFrame(), nextFrame() or feed().
+     *
+     * @return std::optional<std::string_view> Payload of the frame; empty if the peer closed the
+     * connection (see closed()) or if a non-blocking socket has no complete frame yet.
+     */
+    std::optional<std::string_view> receiveFrame();
+
+    /**
+     * @brief Return the next complete frame already in the reassembly buffer, without reading.
+     *
+     * @return std::optional<std::string_view> Payload of the frame, empty if none is complete.
+     */
+    std::optional<std::string_view> nextFrame();
+
+    /**
+     * @brief Append bytes obtained elsewhere (for instance from an event loop) to the reassembly buffer.
+     *
+     * @param bytes Received stream bytes.
+     */
+    void feed(std::string_view bytes);
+
+    /**
+     * @brief Check whether the peer closed the connection.
+     *
+     * @return true if a read returned end of stream, false otherwise.
+     */
+    bool closed() const
+    {
+        return m_closed;
+    }
+
+    /**
+     * @brief Get the number of buffered bytes not yet returned as frames.
+     *
+     * @return size_t Pending bytes.
+     */
+    size_t buffered() const
+    {
+        return m_end - m_begin;
+    }
+
+    /**
+     * @brief Write the length prefix of a frame.
+     *
+     * @param prefix Encoding of the prefix.
+     * @param length Payload length to encode.
+     * @param out Destination, at least FRAME_MAX_PREFIX bytes.
+     * @return size_t Number of bytes written.
+     */
+    static size_t encodePrefix(FramePrefix prefix, uint64_t length, uint8_t* out);
+
+private:
+    std::optional<std::string_view> parseFrame();
+    void reserve(size_t bytes);
+    bool fill();
+
+    IConnection& m_connection;  ///< Underlying TCP connection.
+    FramePrefix m_prefix;       ///< Encoding of the length prefix.
+    int m_socket;               ///< Accepted socket, -1 for the connection socket.
+    size_t m_maxFrameSize;      ///< Largest payload accepted from the peer.
+    std::vector<char> m_buffer; ///< Reassembly buffer.
+    size_t m_begin;             ///< Offset of the first unconsumed byte.
+    size_t m_end;               ///< Offset past the last received byte.
+    bool m_closed;              ///< The peer closed the connection.
+};
+
+#endif // _FRAMED_CONNECTION_HPP
@@ -0,0 +1,81 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _HAPPY_EYEBALLS_HPP
+#define _HAPPY_EYEBALLS_HPP
+
+#include "cppSocket.hpp"
+
+constexpr auto HAPPY_EYEBALLS_ATTEMPT_DELAY_MS = 250; // Macro for the stagger between attempts (RFC 8305)
+
+/**
+ * @brief Settings of a Happy Eyeballs connect.
+ */
+struct HappyEyeballsOptions
+{
+    std::chrono::milliseconds attemptDelay {HAPPY_EYEBALLS_ATTEMPT_DELAY_MS}; ///< Wait before the next attempt.
+    std::chrono::milliseconds timeout {0};                                    ///< Longest wait overall, 0 for none.
+
+    size_t firstFamilyCount = 1; ///< Addresses of the preferred family tried before the families alternate.
+    SocketOptions socketOptions; ///< Options applied to every attempt before it connects.
+};
+
+/**
+ * @brief Order addresses for Happy Eyeballs (RFC 8305 section 4).
+ *
+ * The family of the first address is preferred, as getaddrinfo() already sorts by preference: after
+ * firstFamilyCount addresses of that family the two families alternate, and the order within each
+ * family is kept.
+ *
+ * @param addresses Resolved addresses, IPv4 and IPv6 mixed.
+ * @param firstFamilyCount Addresses of the preferred family placed before the first of the other one.
+ * @return std::vector<ResolvedAddress> The same addresses, interleaved.
+ */
+std::vector<ResolvedAddress> interleaveAddresses(std::span<const ResolvedAddress> addresses,
+                                                 size_t firstFamilyCount = 1);
+
+/**
+ * @brief Connect to the first address that answers, racing the others (RFC 8305, Happy Eyeballs).
+ *
+ * Attempts are non-blocking connects started in interleaveAddresses() order, one every attemptDelay,
+ * or at once when the previous attempts have all failed. The first handshake that completes wins and
+ * the other attempts are closed, so a dead or slow address only costs the attempt delay.
+ *
+ * @param addresses Resolved TCP addresses, IPv4 and IPv6 mixed.
+ * @param isBlocking Flag to set the returned connection as blocking or non-blocking.
+ * @param options Attempt delay, overall timeout and socket options.
+ * @return std::unique_ptr<IConnection> Connected TCPv4Connection or TCPv6Connection; throws
+ * std::runtime_error when every attempt failed and TimeoutError when the timeout expired.
+ */
+std::unique_ptr<IConnection> connectHappyEyeballs(std::span<const ResolvedAddress> addresses,
+                                                  bool isBlocking,
+                                                  const HappyEyeballsOptions& options = {});
+
+/**
+ * @brief Resolve a host in both families and connect with Happy Eyeballs.
+ *
+ * @param host Name or numeric address.
+ * @param port Service name or port number.
+ * @param isBlocking Flag to set the returned connection as blocking or non-blocking.
+ * @param options Attempt delay, overall timeout and socket options.
+ * @return std::unique_ptr<IConnection> Connected TCPv4Connection or TCPv6Connection.
+ */
+std::unique_ptr<IConnection> connectHappyEyeballs(const std::string& host,
+                                                  const std::string& port,
+                                                  bool isBlocking,
+                                                  const HappyEyeballsOptions& options = {});
+
+#endif // _HAPPY_EYEBALLS_HPP
@@ -0,0 +1,233 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _RESOLVER_HPP
+#define _RESOLVER_HPP
+
+#include "workStealingPool.hpp"
+
+#include <chrono>
+#include <future>
+#include <list>
+#include <map>
+#include <netdb.h>
+#include <string>
+#include <sys/socket.h>
+#include <tuple>
+
+constexpr auto RESOLVER_TTL_MS = 30000;    // Macro for the lifetime of lookups whose source gives no TTL
+constexpr auto RESOLVER_CACHE_SIZE = 1024; // Macro for the names kept in the cache
+constexpr auto RESOLVER_THREADS = 2;       // Macro for blocking lookups running at the same time
+
+/**
+ * @brief One socket address returned by a lookup, ready for bind() or connect().
+ */
+struct ResolvedAddress
+{
+    struct sockaddr_storage address; ///< Socket address, IPv4, IPv6 or Unix domain.
+    socklen_t length;                ///< Length of the socket address.
+    int family;                      ///< AF_INET, AF_INET6 or AF_UNIX.
+    int socktype;                    ///< SOCK_STREAM, SOCK_DGRAM or SOCK_SEQPACKET.
+    int protocol;                    ///< Protocol number, 0 for the default of the socket type.
+
+    /**
+     * @brief Get the address in the form expected by the socket calls.
+     *
+     * @return const sockaddr* Pointer to the socket address.
+     */
+    const struct sockaddr* data() const
+    {
+        return reinterpret_cast<const struct sockaddr*>(&address);
+    }
+
+    /**
+     * @brief Get the numeric host of the address.
+     *
+     * @return std::string Dotted IPv4 or colon-separated IPv6 text, or the path of a Unix domain address
+     * ('@' followed by the name for the abstract namespace).
+     */
+    std::string host() const;
+
+    /**
+     * @brief Get the port of the address.
+     *
+     * @return std::string Port number as text, empty for a Unix domain address.
+     */
+    std::string port() const;
+};
+
+/**
+ * @brief Result of a lookup: the addresses and how long they may be cached.
+ */
+struct Resolution
+{
+    std::vector<ResolvedAddress> addresses; ///< Addresses in the order given by the source.
+    std::chrono::milliseconds ttl;          ///< Cache lifetime, negative to use the resolver default.
+};
+
+/**
+ * @brief Source of name lookups used by a Resolver. Implementations may block.
+ */
+class ResolverBackend
+{
+public:
+    virtual ~ResolverBackend() = default;
+
+    /**
+     * @brief Resolve a host and port.
+     *
+     * @param host Name or numeric address, empty for the wildcard address (hints carry AI_PASSIVE).
+     * @param port Service name or port number.
+     * @param hints Family, socket type and flags of the lookup.
+     * @return Resolution Addresses found; throws std::runtime_error when the lookup fails.
+     */
+    virtual Resolution lookup(const std::string& host, const std::string& port, const struct addrinfo& hints) = 0;
+};
+
+/**
+ * @brief Backend calling getaddrinfo, which reports no TTL.
+ */
+class SystemResolverBackend : public ResolverBackend
+{
+public:
+    Resolution lookup(const std::string& host, const std::string& port, const struct addrinfo& hints) override;
+};
+
+/**
+ * @brief Caching, coalescing and asynchronous front end for name lookups.
+ *
+ * Lookups run on a small private thread pool and are cached for their TTL. Concurrent requests for a
+ * name that is already being looked up share the pending result instead of issuing a second query.
+ * Failures are not cached. The cache holds a bounded number of names: expired ones are dropped when a
+ * new name is added, and the least recently used one makes room once it is full. The connection
+ * constructors resolve through instance().
+ */
+class Resolver
+{
+public:
+    /**
+     * @brief Snapshot of the resolver activity.
+     */
+    struct Counters
+    {
+        uint64_t lookups;   ///< Queries sent to the backend.
+        uint64_t hits;      ///< Requests answered from the cache.
+        uint64_t coalesced; ///< Requests joined to a query already running.
+    };
+
+    /**
+     * @brief Construct a new Resolver object.
+     *
+     * @param backend Source of the lookups, getaddrinfo when nullptr.
+     * @param defaultTtl Cache lifetime of results that carry no TTL.
+     * @param capacity Names kept in the cache, at least one.
+     * @param threads Number of lookups that may block at the same time.
+     */
+    explicit Resolver(std::shared_ptr<ResolverBackend> backend = nullptr,
+                      std::chrono::milliseconds defaultTtl = std::chrono::milliseconds(RESOLVER_TTL_MS),
+                      size_t capacity = RESOLVER_CACHE_SIZE,
+                      size_t threads = RESOLVER_THREADS);
+
+    Resolver(const Resolver&) = delete;
+    Resolver& operator=(const Resolver&) = delete;
+
+    /**
+     * @brief Start resolving a host and port without blocking.
+     *
+     * @param host Name or numeric address, empty for the wildcard address.
+     * @param port Service name or port number.
+     * @param family AF_INET, AF_INET6 or AF_UNSPEC.
+     * @param socktype SOCK_STREAM or SOCK_DGRAM.
+     * @return std::shared_future<std::vector<ResolvedAddress>> Addresses, ready at once on a cache hit;
+     * holds a std::runtime_error if the lookup fails.
+     */
+    std::shared_future<std::vector<ResolvedAddress>>
+    resolveAsync(const std::string& host, const std::string& port, int family, int socktype);
+
+    /**
+     * @brief Resolve a host and port, blocking only when the result is not cached.
+     *
+     * @param host Name or numeric address, empty for the wildcard address.
+     * @param port Service name or port number.
+     * @param family AF_INET, AF_INET6 or AF_UNSPEC.
+     * @param socktype SOCK_STREAM or SOCK_DGRAM.
+     * @return std::vector<ResolvedAddress> Addresses, never empty.
+     */
+    std::vector<ResolvedAddress> resolve(const std::string& host, const std::string& port, int family, int socktype);
+
+    /**
+     * @brief Replace the source of the lookups and drop the cache.
+     *
+     * @param backend New source, getaddrinfo when nullptr.
+     */
+    void setBackend(std::shared_ptr<ResolverBackend> backend);
+
+    /**
+     * @brief Drop every cached result. Lookups already running still complete their callers.
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of names in the cache, pending lookups included.
+     *
+     * @return size_t Cached names.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Get a snapshot of the resolver activity.
+     *
+     * @return Counters Current counter values.
+     */
+    Counters counters() const;
+
+    /**
+     * @brief Get the resolver shared by the connection constructors.
+     *
+     * @return Resolver& Process-wide resolver using getaddrinfo by default.
+     */
+    static Resolver& instance();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Key = std::tuple<std::string, std::string, int, int>;
+
+    struct Entry
+    {
+        std::shared_future<std::vector<ResolvedAddress>> result; ///< Pending or completed lookup.
+        Clock::time_point expires;                               ///< End of validity, max while pending.
+        bool done;                                               ///< The lookup succeeded.
+        uint64_t generation;                                     ///< Identifies the lookup owning the entry.
+        std::list<Key>::iterator recent;                         ///< Position of the key in m_recent.
+    };
+
+    void complete(const Key& key, uint64_t generation, std::chrono::milliseconds ttl);
+    void fail(const Key& key, uint64_t generation);
+    void makeRoom();
+    void erase(std::map<Key, Entry>::iterator it);
+
+    mutable std::mutex m_mutex;                 ///< Protects the fields below.
+    std::shared_ptr<ResolverBackend> m_backend; ///< Source of the lookups.
+    std::chrono::milliseconds m_defaultTtl;     ///< Lifetime of results without a TTL.
+    size_t m_capacity;                          ///< Largest number of names in the cache.
+    std::map<Key, Entry> m_cache;               ///< Cached and pending lookups.
+    std::list<Key> m_recent;                    ///< Cached keys, most recently used first.
+    uint64_t m_nextGeneration;                  ///< Generation of the next lookup.
+    Counters m_counters;                        ///< Activity counters.
+    WorkStealingPool m_pool;                    ///< Threads running the blocking lookups.
+};
+
+#endif // _RESOLVER_HPP
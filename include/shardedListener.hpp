@@ -0,0 +1,137 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _SHARDED_LISTENER_HPP
+#define _SHARDED_LISTENER_HPP
+
+#include "cppSocket.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+/**
+ * @brief Multi-core listener: one SO_REUSEPORT socket and one EventLoop per worker thread.
+ *
+ * Every shard binds its own socket to the same address and port, so the kernel balances new TCP
+ * connections (or UDP flows) across the shards and no accept or receive is funneled through a single
+ * file descriptor. Each worker thread owns its loop; the setup callback, run on that thread, decides
+ * how the shard listener is served. Works for TCP over IPv4 and IPv6 and for UDP.
+ */
+class ShardedListener
+{
+public:
+    /**
+     * @brief Callback run on each worker thread before its loop starts.
+     *
+     * For TCP it usually calls loop.listen(listener, ...); for UDP, loop.add(listener.getSocket(), ...).
+     */
+    using Setup = std::function<void(EventLoop& loop, IConnection& listener, size_t shard)>;
+
+    /**
+     * @brief Construct a new ShardedListener object, binding one socket per shard.
+     *
+     * @param address Address to bind, empty for any address.
+     * @param port Port to bind, empty to let the first shard pick one shared by the others.
+     * @param protocolMacro TCP or UDP.
+     * @param shards Number of worker threads, 0 for one per hardware thread.
+     * @param pinThreads Pin worker i to core i modulo the number of cores.
+     * @param options Options applied to every shard socket before bind(); SO_REUSEPORT is always set.
+     */
+    ShardedListener(const std::string& address,
+                    const std::string& port,
+                    int protocolMacro,
+                    size_t shards = 0,
+                    bool pinThreads = false,
+                    SocketOptions options = {});
+
+    /**
+     * @brief Destroy the ShardedListener object, stopping and joining the workers.
+     */
+    ~ShardedListener();
+
+    ShardedListener(const ShardedListener&) = delete;
+    ShardedListener& operator=(const ShardedListener&) = delete;
+
+    /**
+     * @brief Start one worker thread per shard.
+     *
+     * Returns once every setup callback has completed. If one of them throws, the workers are stopped
+     * and the exception is rethrown.
+     *
+     * @param setup Callback registering the shard listener on the shard loop.
+     */
+    void start(Setup setup);
+
+    /**
+     * @brief Stop every loop and join the workers. Safe to call more than once.
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of shards.
+     *
+     * @return size_t Number of listening sockets and worker threads.
+     */
+    size_t size() const
+    {
+        return m_listeners.size();
+    }
+
+    /**
+     * @brief Get the port shared by every shard.
+     *
+     * @return std::string Bound port.
+     */
+    std::string GetPort()
+    {
+        return m_listeners.front()->GetPort();
+    }
+
+    /**
+     * @brief Get the listening connection of a shard.
+     *
+     * @param shard Index of the shard.
+     * @return IConnection& Bound listener.
+     */
+    IConnection& listener(size_t shard)
+    {
+        return *m_listeners.at(shard);
+    }
+
+    /**
+     * @brief Sum the metrics of the shard listeners, the ones enabled with listener(shard).enableMetrics().
+     *
+     * Every shard counts on its own listener, so worker threads never contend on the same counters.
+     *
+     * @return MetricsSnapshot Aggregate of the shards.
+     */
+    MetricsSnapshot metrics();
+
+private:
+    void work(size_t shard, const Setup& setup);
+
+    bool m_pinThreads;                                     ///< Pin each worker to a core.
+    std::vector<std::unique_ptr<IConnection>> m_listeners; ///< One bound socket per shard.
+    std::vector<std::unique_ptr<EventLoop>> m_loops;       ///< One loop per shard, run by its worker.
+    std::vector<std::thread> m_workers;                    ///< Worker threads.
+    std::mutex m_mutex;                                    ///< Protects the startup state below.
+    std::condition_variable m_ready;                       ///< Signaled when a setup callback returns.
+    size_t m_started;                                      ///< Setup callbacks completed.
+    std::exception_ptr m_setupError;                       ///< First exception thrown by a setup callback.
+};
+
+#endif // _SHARDED_LISTENER_HPP
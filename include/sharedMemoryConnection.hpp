@@ -0,0 +1,347 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _SHARED_MEMORY_CONNECTION_HPP
+#define _SHARED_MEMORY_CONNECTION_HPP
+
+#include "cppSocket.hpp"
+
+#include <optional>
+
+constexpr auto SHM_RING_CAPACITY = 1024 * 1024; // Macro for the default bytes of each ring, power of two
+constexpr auto SHM_RECORD_HEADER = 8;           // Macro for the length field before every message
+constexpr auto SHM_CACHE_LINE = 64;             // Macro for the padding between producer and consumer fields
+
+/**
+ * @brief Single-producer single-consumer ring of messages in a shared memory segment.
+ *
+ * The data area is mapped twice back to back, so a message that wraps around the end of the ring is
+ * still contiguous and is read in place. The producer and the consumer only exchange two counters;
+ * a side that has to wait for the other one raises a flag in the shared header and sleeps on an
+ * eventfd, which the other side only writes when it sees the flag, so a busy ring makes no syscall.
+ */
+class SharedMemoryRing
+{
+public:
+    /**
+     * @brief Control block at the start of the ring, shared by both processes.
+     */
+    struct Header
+    {
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> tail; ///< Bytes published by the producer so far.
+        std::atomic<uint32_t> consumerWaiting;              ///< The consumer sleeps on the readable eventfd.
+        alignas(SHM_CACHE_LINE) std::atomic<uint64_t> head; ///< Bytes released by the consumer so far.
+        std::atomic<uint32_t> producerWaiting;              ///< The producer sleeps on the writable eventfd.
+    };
+
+    /**
+     * @brief Map a ring of a shared memory file. A zero-filled ring is empty.
+     *
+     * @param memfd Shared memory file holding the ring; it can be closed afterwards.
+     * @param offset Position of the ring in the file, a multiple of the page size.
+     * @param capacity Bytes of the data area, a power of two and a multiple of the page size.
+     * @param readableFd eventfd written by the producer to wake the consumer. The ring takes its ownership.
+     * @param writableFd eventfd written by the consumer to wake the producer. The ring takes its ownership.
+     */
+    SharedMemoryRing(int memfd, off_t offset, size_t capacity, int readableFd, int writableFd);
+
+    /**
+     * @brief Destroy the SharedMemoryRing object, unmapping the ring and closing its eventfds.
+     */
+    ~SharedMemoryRing();
+
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+    /**
+     * @brief Get the bytes a ring takes in the shared memory file.
+     *
+     * @param capacity Bytes of the data area.
+     * @return size_t Size of the header page plus the data area.
+     */
+    static size_t segmentSize(size_t capacity);
+
+    /**
+     * @brief Publish a message made of several parts, if the ring has room for it. Producer only.
+     *
+     * @param parts Parts of the message, copied in order.
+     * @return true if the message was published, false if the ring is full.
+     */
+    bool tryWrite(std::span<const std::string_view> parts);
+
+    /**
+     * @brief Get the oldest message without releasing it. Consumer only.
+     *
+     * @return std::optional<std::string_view> Message, in place in the ring until release(); empty if
+     * the ring is empty.
+     */
+    std::optional<std::string_view> peek();
+
+    /**
+     * @brief Release the message returned by peek(), handing its room back to the producer.
+     */
+    void release();
+
+    /**
+     * @brief Wait until a message is available. Consumer only.
+     *
+     * @param peer Socket whose hangup ends the wait, -1 for none.
+     * @param spin Time to poll the ring before sleeping on the eventfd.
+     * @return true if a message is available, false if the peer hung up and the ring is empty.
+     */
+    bool waitReadable(int peer, std::chrono::microseconds spin);
+
+    /**
+     * @brief Wait until a message of the given length fits. Producer only.
+     *
+     * @param length Length of the message.
+     * @param peer Socket whose hangup ends the wait, -1 for none.
+     * @param spin Time to poll the ring before sleeping on the eventfd.
+     * @return true if the message fits, false if the peer hung up.
+     */
+    bool waitWritable(size_t length, int peer, std::chrono::microseconds spin);
+
+    /**
+     * @brief Ask the producer to write readableFd() on its next message, for instance before
+     * registering it with an EventLoop. Consumer only.
+     *
+     * @return true if the ring is still empty, false if a message arrived meanwhile.
+     */
+    bool armReadable();
+
+    /**
+     * @brief Get the eventfd that becomes readable when armReadable() was called and a message arrives.
+     *
+     * @return int File descriptor of the eventfd.
+     */
+    int readableFd() const
+    {
+        return m_readableFd;
+    }
+
+    /**
+     * @brief Get the longest message the ring accepts.
+     *
+     * @return size_t Capacity minus the length field.
+     */
+    size_t maxMessage() const
+    {
+        return m_capacity - SHM_RECORD_HEADER;
+    }
+
+private:
+    bool readable();
+    bool writable(uint64_t recordSize);
+    template <typename Ready>
+    bool wait(std::atomic<uint32_t>& flag, int fd, int peer, std::chrono::microseconds spin, Ready ready);
+
+    void* m_mapping;       ///< Reserved address range: header page and the two views of the data area.
+    size_t m_mappingSize;  ///< Length of the reserved range.
+    Header* m_header;      ///< Shared control block.
+    std::byte* m_data;     ///< First view of the data area.
+    size_t m_capacity;     ///< Bytes of the data area.
+    int m_readableFd;      ///< eventfd waking the consumer.
+    int m_writableFd;      ///< eventfd waking the producer.
+    uint64_t m_tail;       ///< Producer copy of the tail.
+    uint64_t m_cachedHead; ///< Last head seen by the producer.
+    uint64_t m_head;       ///< Consumer copy of the head.
+    uint64_t m_cachedTail; ///< Last tail seen by the consumer.
+    uint64_t m_peeked;     ///< Record size of the message returned by peek(), 0 if none.
+    bool m_armed;          ///< armReadable() raised the consumer flag, cleared by the next peek().
+};
+
+/**
+ * @brief Message transport between processes of the same host over a pair of shared memory rings.
+ *
+ * A listener binds a Unix domain stream socket; every client that connects gets a fresh memfd holding
+ * one ring per direction, passed with its eventfds through SCM_RIGHTS. After that handshake messages
+ * never touch the socket: they are copied into the rings and, with busy spinning enabled, delivered
+ * without any syscall. The socket stays open only to notice that the peer went away.
+ *
+ * Like a sequenced-packet socket, every send() is received as one message. On a listener the file
+ * descriptor returned by connect() identifies the client in sendto() and receiveFrom().
+ */
+class SharedMemoryConnection : public IConnection
+{
+public:
+    /**
+     * @brief Construct a new SharedMemoryConnection object.
+     *
+     * @param path Unix domain path of the handshake socket, '@' for the abstract namespace, or empty
+     * to let bind() pick a free abstract name.
+     * @param isBlocking Flag indicating whether receives wait for a message and sends for room.
+     * @param capacity Bytes of each ring created by a listener, a power of two of at least a page.
+     */
+    SharedMemoryConnection(const std::string& path, bool isBlocking, size_t capacity = SHM_RING_CAPACITY);
+
+    ~SharedMemoryConnection();
+
+    /**
+     * @brief Bind the handshake socket and listen on it.
+     *
+     * @return true if the connection is successfully binded, false otherwise.
+     */
+    bool bind() override;
+
+    /**
+     * @brief Connect to a listener and map the rings it sends, or accept a client once bind() was called.
+     *
+     * @return int File descriptor identifying the accepted client (ERROR if a non-blocking listener has
+     * none waiting), or true for a client.
+     */
+    int connect() override;
+
+    using IConnection::receive;
+    using IConnection::receiveFrom;
+    using IConnection::send;
+    using IConnection::sendto;
+
+    /**
+     * @brief Send a message to the peer.
+     *
+     * @param message Message to be sent, at most maxMessage() bytes.
+     * @return true if the message is sent, false if the ring of a non-blocking connection is full.
+     */
+    bool send(const std::string& message) override;
+
+    /**
+     * @brief Send a message to an accepted client.
+     *
+     * @param message Message to be sent, at most maxMessage() bytes.
+     * @param fdDestiny File descriptor returned by connect().
+     * @return true if the message is sent, false if the ring of a non-blocking connection is full.
+     */
+    bool sendto(const std::string& message, int fdDestiny) override;
+
+    /**
+     * @brief Send a message made of several parts to the peer, copied once into the ring.
+     *
+     * @param parts Parts of the message, at most maxMessage() bytes in total.
+     * @return true if the message is sent, false if the ring of a non-blocking connection is full.
+     */
+    bool send(std::span<const std::string_view> parts) override;
+
+    /**
+     * @brief Send a message made of several parts to an accepted client.
+     *
+     * @param parts Parts of the message, at most maxMessage() bytes in total.
+     * @param fdDestiny File descriptor returned by connect().
+     * @return true if the message is sent, false if the ring of a non-blocking connection is full.
+     */
+    bool sendto(std::span<const std::string_view> parts, int fdDestiny) override;
+
+    /**
+     * @brief Receive a message from the peer.
+     *
+     * @return std::string Received message.
+     */
+    std::string receive() override;
+
+    /**
+     * @brief Receive a message from an accepted client.
+     *
+     * @param socket File descriptor returned by connect().
+     * @return std::string Received message.
+     */
+    std::string receiveFrom(int socket) override;
+
+    /**
+     * @brief Receive a message into a caller-owned buffer; the part of a message that does not fit is
+     * discarded, as with a datagram.
+     *
+     * @param socket File descriptor returned by connect(), or getSocket() on a client.
+     * @param buffer Destination of the message.
+     * @return ssize_t Length copied, 0 if the peer went away, ERROR if a non-blocking ring is empty.
+     */
+    ssize_t receiveFrom(int socket, std::span<std::byte> buffer) override;
+
+    /**
+     * @brief Get the handshake socket file descriptor.
+     *
+     * @return int File descriptor of the socket.
+     */
+    int getSocket() override;
+
+    /**
+     * @brief Get the path of the handshake socket, with the name picked by bind() for an empty path.
+     *
+     * @return std::string Filesystem path, or '@' followed by the abstract name.
+     */
+    std::string GetPath()
+    {
+        return m_control.GetPath();
+    }
+
+    /**
+     * @brief Poll the ring before sleeping whenever a blocking call has to wait.
+     *
+     * Spinning trades a busy core for wakeups without a syscall; it only pays off when both processes
+     * have a core of their own.
+     *
+     * @param spin Longest time to poll, 0 (the default) to sleep right away.
+     */
+    void setBusySpin(std::chrono::microseconds spin)
+    {
+        m_spin = spin;
+    }
+
+    /**
+     * @brief Get an eventfd that becomes readable when a message arrives, to register with an EventLoop.
+     *
+     * Every receive that finds the ring empty on a non-blocking connection re-arms it, so edge-triggered
+     * handlers only have to receive until ERROR.
+     *
+     * @param socket File descriptor returned by connect(), or getSocket() on a client.
+     * @return int File descriptor of the eventfd, owned by the connection.
+     */
+    int notifyFd(int socket);
+
+    /**
+     * @brief Stop serving an accepted client, unmapping its rings and closing its socket.
+     *
+     * @param socket File descriptor returned by connect().
+     */
+    void disconnect(int socket);
+
+    /**
+     * @brief Get the longest message the rings accept.
+     *
+     * @return size_t Maximum message length in bytes.
+     */
+    size_t maxMessage() const
+    {
+        return m_capacity - SHM_RECORD_HEADER;
+    }
+
+private:
+    struct Channel
+    {
+        int socket;                            ///< Handshake socket, watched for the peer hanging up.
+        std::unique_ptr<SharedMemoryRing> out; ///< Ring written by this side.
+        std::unique_ptr<SharedMemoryRing> in;  ///< Ring read by this side.
+    };
+
+    Channel& channel(int socket);
+    ssize_t awaitMessage(Channel& channel);
+
+    UnixConnection m_control;                                     ///< Handshake socket.
+    size_t m_capacity;                                            ///< Bytes of each ring.
+    std::chrono::microseconds m_spin {0};                         ///< Busy spin before sleeping.
+    bool m_listening = false;                                     ///< bind() succeeded, connect() accepts.
+    std::unordered_map<int, std::unique_ptr<Channel>> m_channels; ///< Rings by handshake socket.
+};
+
+#endif // _SHARED_MEMORY_CONNECTION_HPP
@@ -0,0 +1,597 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _SOCKET_HPP
+#define _SOCKET_HPP
+
+#include "resolver.hpp"
+#include "socketOptions.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <optional>
+#include <poll.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+constexpr auto ERROR = -1;         // Macro for error
+constexpr auto TCP_BACKLOG = 1024; // Macro for maximum connections
+
+/**
+ * @brief Error thrown when a blocking call does not complete within the timeout set on the connection.
+ */
+class TimeoutError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Transport tag of Socket: TCP byte stream.
+ */
+struct Tcp
+{
+    static constexpr int type = SOCK_STREAM;     ///< Socket type passed to socket().
+    static constexpr int protocol = IPPROTO_TCP; ///< Protocol passed to socket().
+    static constexpr bool isStream = true;       ///< Sends may be partial, connections are accepted.
+};
+
+/**
+ * @brief Transport tag of Socket: UDP datagrams.
+ */
+struct Udp
+{
+    static constexpr int type = SOCK_DGRAM;      ///< Socket type passed to socket().
+    static constexpr int protocol = IPPROTO_UDP; ///< Protocol passed to socket().
+    static constexpr bool isStream = false;      ///< Every send is one datagram.
+};
+
+/**
+ * @brief Address family tag of Socket: IPv4.
+ */
+struct IPv4
+{
+    using Address = struct sockaddr_in;    ///< Socket address of the family.
+    static constexpr int domain = AF_INET; ///< Address family passed to socket().
+
+    /**
+     * @brief Build the wildcard address of a port.
+     *
+     * @param port Port number, 0 to let bind() pick a free one.
+     * @return Address INADDR_ANY with the port.
+     */
+    static Address any(uint16_t port)
+    {
+        Address address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        return address;
+    }
+
+    /**
+     * @brief Get the port of an address.
+     *
+     * @param address IPv4 socket address.
+     * @return uint16_t Port number in host byte order.
+     */
+    static uint16_t port(const Address& address)
+    {
+        return ntohs(address.sin_port);
+    }
+};
+
+/**
+ * @brief Address family tag of Socket: IPv6.
+ */
+struct IPv6
+{
+    using Address = struct sockaddr_in6;    ///< Socket address of the family.
+    static constexpr int domain = AF_INET6; ///< Address family passed to socket().
+
+    /**
+     * @brief Build the wildcard address of a port.
+     *
+     * @param port Port number, 0 to let bind() pick a free one.
+     * @return Address in6addr_any with the port.
+     */
+    static Address any(uint16_t port)
+    {
+        Address address {};
+        address.sin6_family = AF_INET6;
+        address.sin6_port = htons(port);
+        address.sin6_addr = in6addr_any;
+        return address;
+    }
+
+    /**
+     * @brief Get the port of an address.
+     *
+     * @param address IPv6 socket address.
+     * @return uint16_t Port number in host byte order.
+     */
+    static uint16_t port(const Address& address)
+    {
+        return ntohs(address.sin6_port);
+    }
+};
+
+/**
+ * @brief Socket whose transport and address family are fixed at compile time.
+ *
+ * Everything is defined in this header and nothing is virtual, so the send and receive calls of a hot
+ * loop inline down to the system call, and the address structure of the family is used directly
+ * instead of a sockaddr_storage. The socket owns its file descriptor and is move-only.
+ *
+ * Calls that cannot complete throw std::runtime_error, or TimeoutError when the receive or send
+ * timeout of a blocking socket expires. A non-blocking socket waits for buffer space in send() and
+ * returns ERROR from receive() when no data is available, like the IConnection calls.
+ *
+ * @tparam Transport Tcp or Udp.
+ * @tparam Family IPv4 or IPv6.
+ */
+template <typename Transport, typename Family>
+class Socket
+{
+public:
+    using Address = typename Family::Address; ///< Socket address of the family.
+
+    /**
+     * @brief Create a socket.
+     *
+     * @param isBlocking Flag indicating whether the socket is blocking.
+     */
+    explicit Socket(bool isBlocking = true)
+        : m_fd(::socket(Family::domain, Transport::type | (isBlocking ? 0 : SOCK_NONBLOCK), Transport::protocol))
+        , m_isBlocking(isBlocking)
+    {
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Error creating socket");
+        }
+    }
+
+    /**
+     * @brief Take ownership of an existing socket of the same transport and family.
+     *
+     * @param fd File descriptor of the socket.
+     * @param isBlocking Whether the socket is in blocking mode.
+     * @return Socket Socket owning fd.
+     */
+    static Socket fromDescriptor(int fd, bool isBlocking)
+    {
+        return Socket(fd, isBlocking, Adopt {});
+    }
+
+    ~Socket()
+    {
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+    }
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    Socket(Socket&& other) noexcept
+        : m_fd(std::exchange(other.m_fd, -1))
+        , m_isBlocking(other.m_isBlocking)
+    {
+    }
+
+    Socket& operator=(Socket&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+            m_fd = std::exchange(other.m_fd, -1);
+            m_isBlocking = other.m_isBlocking;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Get the file descriptor of the socket.
+     *
+     * @return int File descriptor, -1 once released.
+     */
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    /**
+     * @brief Check whether the socket is in blocking mode.
+     *
+     * @return true if calls wait, false if they return as soon as they would block.
+     */
+    bool isBlocking() const
+    {
+        return m_isBlocking;
+    }
+
+    /**
+     * @brief Give up the ownership of the file descriptor.
+     *
+     * @return int File descriptor, which the caller must close.
+     */
+    int release()
+    {
+        return std::exchange(m_fd, -1);
+    }
+
+    /**
+     * @brief Apply socket options.
+     *
+     * @param options Options to set; unset ones are left untouched.
+     */
+    void setOptions(const SocketOptions& options)
+    {
+        options.apply(m_fd);
+    }
+
+    /**
+     * @brief Bind the socket to an address.
+     *
+     * @param address Local address.
+     */
+    void bind(const Address& address)
+    {
+        bindTo(reinterpret_cast<const struct sockaddr*>(&address), sizeof(address));
+    }
+
+    /**
+     * @brief Bind the socket to a resolved address of the same family.
+     *
+     * @param endpoint Local address, for instance from Resolver::resolve().
+     */
+    void bind(const ResolvedAddress& endpoint)
+    {
+        checkFamily(endpoint);
+        bindTo(endpoint.data(), endpoint.length);
+    }
+
+    /**
+     * @brief Bind the socket to the wildcard address.
+     *
+     * @param port Port number, 0 (the default) to let the kernel pick a free one; see localPort().
+     */
+    void bindAny(uint16_t port = 0)
+    {
+        bind(Family::any(port));
+    }
+
+    /**
+     * @brief Get the address the socket is bound to.
+     *
+     * @return Address Local address.
+     */
+    Address localAddress() const
+    {
+        Address address {};
+        socklen_t length = sizeof(address);
+        if (::getsockname(m_fd, reinterpret_cast<struct sockaddr*>(&address), &length) < 0)
+        {
+            throw std::runtime_error("Error: cannot get socket name");
+        }
+        return address;
+    }
+
+    /**
+     * @brief Get the port the socket is bound to.
+     *
+     * @return uint16_t Port number in host byte order.
+     */
+    uint16_t localPort() const
+    {
+        return Family::port(localAddress());
+    }
+
+    /**
+     * @brief Listen for connections on a bound stream socket.
+     *
+     * @param backlog Length of the queue of pending connections.
+     */
+    void listen(int backlog = TCP_BACKLOG)
+        requires Transport::isStream
+    {
+        if (::listen(m_fd, backlog) < 0)
+        {
+            throw std::runtime_error("Error: cannot listen on socket");
+        }
+    }
+
+    /**
+     * @brief Accept a pending connection; it is blocking like the listening socket and close-on-exec.
+     *
+     * @param peer Filled with the address of the client, nullptr (the default) to discard it.
+     * @return std::optional<Socket> Connected socket, empty if a non-blocking socket has none waiting.
+     */
+    std::optional<Socket> accept(Address* peer = nullptr)
+        requires Transport::isStream
+    {
+        const int flags = (m_isBlocking ? 0 : SOCK_NONBLOCK) | SOCK_CLOEXEC;
+        while (true)
+        {
+            socklen_t length = sizeof(Address);
+            const int fd = ::accept4(m_fd, reinterpret_cast<struct sockaddr*>(peer), peer ? &length : nullptr, flags);
+            if (fd >= 0)
+            {
+                return Socket(fd, m_isBlocking, Adopt {});
+            }
+            if (errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (!retry(0, "accept"))
+            {
+                return std::nullopt;
+            }
+        }
+    }
+
+    /**
+     * @brief Connect the socket, waiting for the handshake of a non-blocking one to finish.
+     *
+     * With a timeout the handshake runs non-blocking and is bounded with poll(), so an unreachable
+     * peer costs the timeout instead of the kernel's SYN retries.
+     *
+     * @param address Remote address.
+     * @param timeout Longest wait, 0 (the default) for none; TimeoutError is thrown when it expires.
+     */
+    void connect(const Address& address, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+    {
+        connectTo(reinterpret_cast<const struct sockaddr*>(&address), sizeof(address), timeout);
+    }
+
+    /**
+     * @brief Connect the socket to a resolved address of the same family.
+     *
+     * @param endpoint Remote address, for instance from Resolver::resolve().
+     * @param timeout Longest wait, 0 (the default) for none; TimeoutError is thrown when it expires.
+     */
+    void connect(const ResolvedAddress& endpoint, std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+    {
+        checkFamily(endpoint);
+        connectTo(endpoint.data(), endpoint.length, timeout);
+    }
+
+    /**
+     * @brief Send bytes to the connected peer.
+     *
+     * A stream socket writes every byte before returning; a datagram socket sends them as one datagram.
+     *
+     * @param data Bytes to send.
+     * @return size_t Number of bytes sent.
+     */
+    size_t send(std::string_view data)
+    {
+        size_t sent = 0;
+        do
+        {
+            const ssize_t bytes = ::send(m_fd, data.data() + sent, data.size() - sent, 0);
+            if (bytes < 0)
+            {
+                retry(POLLOUT, "send");
+                continue;
+            }
+            sent += static_cast<size_t>(bytes);
+        } while (Transport::isStream && sent < data.size());
+        return sent;
+    }
+
+    /**
+     * @brief Receive bytes from the connected peer.
+     *
+     * @param buffer Destination of the received bytes.
+     * @return ssize_t Number of bytes received, 0 if the peer closed the connection, ERROR if the
+     * socket is non-blocking and no data is available.
+     */
+    ssize_t receive(std::span<std::byte> buffer)
+    {
+        while (true)
+        {
+            const ssize_t bytes = ::recv(m_fd, buffer.data(), buffer.size(), 0);
+            if (bytes >= 0)
+            {
+                return bytes;
+            }
+            if (!retry(0, "receive"))
+            {
+                return ERROR;
+            }
+        }
+    }
+
+    /**
+     * @brief Send one datagram to an address.
+     *
+     * @param data Payload of the datagram.
+     * @param destination Remote address.
+     * @return size_t Number of bytes sent.
+     */
+    size_t sendTo(std::string_view data, const Address& destination)
+        requires(!Transport::isStream)
+    {
+        while (true)
+        {
+            const ssize_t bytes = ::sendto(m_fd, data.data(), data.size(), 0,
+                                           reinterpret_cast<const struct sockaddr*>(&destination), sizeof(destination));
+            if (bytes >= 0)
+            {
+                return static_cast<size_t>(bytes);
+            }
+            retry(POLLOUT, "send");
+        }
+    }
+
+    /**
+     * @brief Receive one datagram and the address it came from.
+     *
+     * @param buffer Destination of the payload; the part of a longer datagram is discarded.
+     * @param source Filled with the address of the sender.
+     * @return ssize_t Number of bytes received, ERROR if the socket is non-blocking and no datagram is waiting.
+     */
+    ssize_t receiveFrom(std::span<std::byte> buffer, Address& source)
+        requires(!Transport::isStream)
+    {
+        while (true)
+        {
+            socklen_t length = sizeof(source);
+            const ssize_t bytes = ::recvfrom(m_fd, buffer.data(), buffer.size(), 0,
+                                             reinterpret_cast<struct sockaddr*>(&source), &length);
+            if (bytes >= 0)
+            {
+                return bytes;
+            }
+            if (!retry(0, "receive"))
+            {
+                return ERROR;
+            }
+        }
+    }
+
+private:
+    struct Adopt
+    {
+    };
+
+    Socket(int fd, bool isBlocking, Adopt)
+        : m_fd(fd)
+        , m_isBlocking(isBlocking)
+    {
+    }
+
+    void checkFamily(const ResolvedAddress& endpoint) const
+    {
+        if (endpoint.family != Family::domain)
+        {
+            throw std::invalid_argument("Error: address family does not match the socket");
+        }
+    }
+
+    void bindTo(const struct sockaddr* address, socklen_t length)
+    {
+        if (::bind(m_fd, address, length) < 0)
+        {
+            throw std::runtime_error("Error: cannot bind socket");
+        }
+    }
+
+    void connectTo(const struct sockaddr* address, socklen_t length, std::chrono::milliseconds timeout)
+    {
+        using Clock = std::chrono::steady_clock;
+        const bool bounded = timeout.count() > 0;
+        const int flags = fcntl(m_fd, F_GETFL, 0);
+        if (bounded && m_isBlocking)
+        {
+            fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+        }
+
+        const bool connected = ::connect(m_fd, address, length) == 0;
+        const bool pending = !connected && (errno == EINPROGRESS || errno == EINTR);
+        int ready = 1;
+        if (pending)
+        {
+            const auto deadline = Clock::now() + timeout;
+            struct pollfd pollFd = {m_fd, POLLOUT, 0};
+            do
+            {
+                int waitMs = -1;
+                if (bounded)
+                {
+                    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                    waitMs = static_cast<int>(std::max<int64_t>(left, 0));
+                }
+                ready = ::poll(&pollFd, 1, waitMs);
+            } while (ready < 0 && errno == EINTR);
+        }
+
+        if (bounded && m_isBlocking)
+        {
+            fcntl(m_fd, F_SETFL, flags);
+        }
+        if (connected)
+        {
+            return;
+        }
+        if (!pending)
+        {
+            throw std::runtime_error("Error: cannot connect");
+        }
+        if (ready == 0)
+        {
+            throw TimeoutError("Error: connect timed out");
+        }
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        if (getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) < 0 || error != 0)
+        {
+            throw std::runtime_error("Error: cannot connect");
+        }
+    }
+
+    /**
+     * @brief Handle a failed call from its errno.
+     *
+     * @param events Events to wait for before retrying on a non-blocking socket, 0 to give up instead.
+     * @param operation Name of the call, for the error message.
+     * @return true to retry the call, false when a non-blocking socket gives up.
+     */
+    bool retry(short events, const char* operation)
+    {
+        if (errno == EINTR)
+        {
+            return true;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            throw std::runtime_error(std::string("Error: ") + operation + " failed: " + strerror(errno));
+        }
+        if (m_isBlocking)
+        {
+            throw TimeoutError(std::string("Error: ") + operation + " timed out");
+        }
+        if (events == 0)
+        {
+            return false;
+        }
+        struct pollfd pollFd = {m_fd, events, 0};
+        ::poll(&pollFd, 1, -1);
+        return true;
+    }
+
+    int m_fd;          ///< File descriptor of the socket, -1 once released.
+    bool m_isBlocking; ///< The socket is in blocking mode.
+};
+
+#endif // _SOCKET_HPP
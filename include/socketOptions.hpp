@@ -0,0 +1,74 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _SOCKET_OPTIONS_HPP
+#define _SOCKET_OPTIONS_HPP
+
+#include <chrono>
+#include <optional>
+
+/**
+ * @brief Typed set of socket tuning options applied with a single call.
+ *
+ * Every option is optional: only the ones given a value are set on the socket, the others keep
+ * their current (kernel default) value. Options at the TCP level are skipped on non-TCP sockets, so
+ * the same set can be used for every connection of an application.
+ */
+struct SocketOptions
+{
+    std::optional<bool> noDelay;          ///< TCP_NODELAY: send small segments without waiting (no Nagle).
+    std::optional<bool> cork;             ///< TCP_CORK: hold partial segments until uncorked or full.
+    std::optional<bool> quickAck;         ///< TCP_QUICKACK: acknowledge at once; the kernel may reset it.
+    std::optional<int> sendBuffer;        ///< SO_SNDBUF in bytes; the kernel doubles the value.
+    std::optional<int> receiveBuffer;     ///< SO_RCVBUF in bytes; set before connect() or bind().
+    std::optional<int> busyPoll;          ///< SO_BUSY_POLL in microseconds; raising it needs CAP_NET_ADMIN.
+    std::optional<int> priority;          ///< SO_PRIORITY; values above 6 need CAP_NET_ADMIN.
+    std::optional<int> notSentLowat;      ///< TCP_NOTSENT_LOWAT: unsent bytes above which the socket is not writable.
+    std::optional<bool> reuseAddress;     ///< SO_REUSEADDR; set before bind().
+    std::optional<bool> reusePort;        ///< SO_REUSEPORT; set before bind().
+    std::optional<bool> keepAlive;        ///< SO_KEEPALIVE: probe idle connections.
+    std::optional<int> keepAliveIdle;     ///< TCP_KEEPIDLE: idle seconds before the first probe.
+    std::optional<int> keepAliveInterval; ///< TCP_KEEPINTVL: seconds between probes.
+    std::optional<int> keepAliveCount;    ///< TCP_KEEPCNT: unanswered probes before the connection is dropped.
+
+    std::optional<std::chrono::milliseconds> receiveTimeout; ///< SO_RCVTIMEO: longest blocking receive, 0 for none.
+    std::optional<std::chrono::milliseconds> sendTimeout;    ///< SO_SNDTIMEO: longest blocking send, 0 for none.
+
+    /**
+     * @brief Preset for request/response traffic: no Nagle delay, immediate acknowledgements,
+     * a small unsent backlog and an interactive priority.
+     *
+     * @return SocketOptions Low-latency profile.
+     */
+    static SocketOptions lowLatency();
+
+    /**
+     * @brief Preset for large transfers: Nagle kept on and large kernel buffers.
+     *
+     * @return SocketOptions Bulk-throughput profile.
+     */
+    static SocketOptions bulkThroughput();
+
+    /**
+     * @brief Apply every option that has a value to a socket.
+     *
+     * @param socket Socket file descriptor.
+     * @throw std::runtime_error if the kernel rejects an option; the options before it stay applied.
+     */
+    void apply(int socket) const;
+};
+
+#endif // _SOCKET_OPTIONS_HPP
@@ -0,0 +1,159 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _TIMING_WHEEL_HPP
+#define _TIMING_WHEEL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+constexpr auto TIMING_WHEEL_TICK_MS = 1;  // Macro for the default resolution of a timing wheel
+constexpr auto TIMING_WHEEL_SLOTS = 4096; // Macro for the default number of slots, a power of two
+
+/**
+ * @brief Hashed timing wheel: timers are hashed by expiry tick into a ring of slots.
+ *
+ * Arming, re-arming and cancelling a timer are O(1) whatever the number of timers, which suits one
+ * idle or deadline timer per connection on servers with hundreds of thousands of them. Each slot holds
+ * an intrusive list of timers; a timer further away than one turn of the wheel stays in its slot for
+ * the following turns. Timers never fire early: a timer fires on the first tick boundary at or after
+ * its deadline, so it may be late by up to one tick. Not thread-safe; one thread drives the wheel.
+ */
+class TimingWheel
+{
+public:
+    /**
+     * @brief Work run when a timer expires.
+     */
+    using Task = std::function<void()>;
+
+    /**
+     * @brief Clock used for the deadlines.
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Construct a new TimingWheel object, starting at the current time.
+     *
+     * @param tick Resolution of the wheel.
+     * @param slots Number of slots, a power of two of at least 64; one turn lasts slots * tick.
+     * @throw std::invalid_argument if the tick is not positive or slots is not a valid power of two.
+     */
+    explicit TimingWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(TIMING_WHEEL_TICK_MS),
+                         size_t slots = TIMING_WHEEL_SLOTS);
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    /**
+     * @brief Arm a timer.
+     *
+     * @param delay Time to wait before running the task; negative values count as 0.
+     * @param task Work to run from advance().
+     * @return uint64_t Identifier of the timer, never 0.
+     */
+    uint64_t schedule(std::chrono::milliseconds delay, Task task);
+
+    /**
+     * @brief Move the deadline of a pending timer, for instance to push back an idle timeout.
+     *
+     * @param id Identifier returned by schedule().
+     * @param delay New delay, counted from now.
+     * @return true if the timer was pending and has been re-armed, false otherwise.
+     */
+    bool reschedule(uint64_t id, std::chrono::milliseconds delay);
+
+    /**
+     * @brief Cancel a pending timer.
+     *
+     * @param id Identifier returned by schedule().
+     * @return true if the timer was pending and will not run, false otherwise.
+     */
+    bool cancel(uint64_t id);
+
+    /**
+     * @brief Run the tasks of every timer whose deadline has passed, in deadline order.
+     *
+     * Tasks may schedule, re-arm and cancel timers, including the ones expiring in the same call.
+     *
+     * @param now Current time.
+     * @return size_t Number of tasks run.
+     */
+    size_t advance(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Get the time left until the next occupied slot, to bound a poll or epoll_wait.
+     *
+     * The slot may only hold timers of a later turn, in which case the caller wakes up early and asks
+     * again; it never wakes up late.
+     *
+     * @param now Current time.
+     * @return int Milliseconds to wait, rounded up; -1 if no timer is pending.
+     */
+    int timeoutMs(Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief Get the number of pending timers.
+     *
+     * @return size_t Timers armed and not yet run or cancelled.
+     */
+    size_t size() const
+    {
+        return m_pending;
+    }
+
+private:
+    enum class State : uint8_t
+    {
+        Free,  ///< In the free list.
+        Armed, ///< Linked in a slot.
+        Due    ///< Expired, waiting for its task to run.
+    };
+
+    struct Node
+    {
+        Task task;           ///< Work to run.
+        uint64_t expiry;     ///< Tick at which the timer fires.
+        uint32_t generation; ///< Distinguishes reused nodes, part of the identifier.
+        int32_t prev;        ///< Previous node of the slot, -1 for the head.
+        int32_t next;        ///< Next node of the slot or of the free list, -1 for the tail.
+        State state;         ///< Position of the node.
+    };
+
+    uint64_t ticksAt(Clock::time_point now) const;
+    Node* find(uint64_t id);
+    void arm(int32_t index, std::chrono::milliseconds delay);
+    void link(int32_t index);
+    void unlink(int32_t index);
+    void release(int32_t index);
+
+    Clock::time_point m_start;        ///< Time of tick 0.
+    Clock::duration m_tick;           ///< Length of a tick.
+    size_t m_mask;                    ///< Number of slots minus one.
+    uint64_t m_current;               ///< Last tick processed by advance().
+    size_t m_pending;                 ///< Armed and due timers.
+    std::vector<Node> m_nodes;        ///< Storage of every timer, indexed by the low half of the identifier.
+    int32_t m_free;                   ///< Head of the free list, -1 if empty.
+    std::vector<int32_t> m_heads;     ///< First node of each slot, -1 if empty.
+    std::vector<int32_t> m_tails;     ///< Last node of each slot, -1 if empty.
+    std::vector<uint64_t> m_occupied; ///< One bit per non-empty slot.
+    std::vector<uint64_t> m_due;      ///< Identifiers expired by the current advance(), oldest first.
+};
+
+#endif // _TIMING_WHEEL_HPP
@@ -0,0 +1,264 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _URING_LOOP_HPP
+#define _URING_LOOP_HPP
+
+#include "cppSocket.hpp"
+
+#include <deque>
+#include <linux/io_uring.h>
+#include <string_view>
+#include <sys/uio.h>
+
+constexpr auto URING_ENTRIES = 256;          // Macro for submission queue entries
+constexpr auto URING_BUFFER_COUNT = 256;     // Macro for provided receive buffers, power of two
+constexpr auto URING_BUFFER_SIZE = 16384;    // Macro for provided receive buffer length
+constexpr auto URING_MAX_FILES = 4096;       // Macro for registered file table slots
+constexpr auto URING_MAX_SEND_BATCH = 64;    // Macro for messages gathered in one sendmsg
+
+/**
+ * @brief Completion-based io_uring backend for accept, send and receive.
+ *
+ * Listeners use multishot accept, every connection is placed in the registered file table and
+ * receives through a multishot recv that picks buffers from a provided buffer ring, so steady-state
+ * reads need no submission at all. Sends are queued per connection and gathered into a single
+ * sendmsg; all queued submissions are flushed by one io_uring_enter per runOnce().
+ *
+ * The loop is the per-loop selection of the backend: sockets registered here use io_uring, any other
+ * connection keeps using the blocking IConnection calls. When isSupported() returns false (old kernel
+ * or io_uring disabled) callers should fall back to EventLoop or to the blocking calls.
+ * Every method except stop() must be called from the thread running the loop.
+ */
+class UringLoop
+{
+public:
+    /**
+     * @brief Callback invoked with the file descriptor of the connection.
+     */
+    using Callback = std::function<void(int fd)>;
+
+    /**
+     * @brief Callback invoked with received bytes. The view is only valid during the call.
+     */
+    using DataCallback = std::function<void(int fd, std::string_view data)>;
+
+    /**
+     * @brief Set of callbacks attached to a registered connection. Any of them may be empty.
+     *
+     * As with EventLoop, a peer that shuts down its side (or closes) is reported through onData, with an
+     * empty view: the socket stays registered, so a reply can still be sent, and the handler calls
+     * remove() once done. Without an onData handler the socket is closed right away.
+     */
+    struct Handlers
+    {
+        DataCallback onData; ///< Bytes were received, or an empty view once the peer ended its input.
+        Callback onClosed;   ///< The connection failed; called once before removal.
+    };
+
+    /**
+     * @brief Counters used to measure the syscall cost of the backend.
+     */
+    struct Stats
+    {
+        uint64_t enterCalls = 0;  ///< io_uring_enter system calls.
+        uint64_t submissions = 0; ///< Submission queue entries consumed by the kernel.
+        uint64_t completions = 0; ///< Completion queue entries processed.
+        uint64_t messages = 0;    ///< Messages handed to send().
+    };
+
+    /**
+     * @brief Construct a new UringLoop object, setting up the rings and registering the buffers.
+     *
+     * @param entries Number of submission queue entries.
+     * @param bufferCount Number of provided receive buffers, must be a power of two.
+     * @param bufferSize Length of each provided receive buffer.
+     * @param maxFiles Number of slots in the registered file table.
+     */
+    UringLoop(unsigned entries = URING_ENTRIES,
+              unsigned bufferCount = URING_BUFFER_COUNT,
+              unsigned bufferSize = URING_BUFFER_SIZE,
+              unsigned maxFiles = URING_MAX_FILES);
+
+    /**
+     * @brief Destroy the UringLoop object, closing every socket accepted by the loop.
+     */
+    ~UringLoop();
+
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+
+    /**
+     * @brief Check whether the running kernel provides the io_uring features used by the loop.
+     *
+     * @return true if a UringLoop can be constructed, false otherwise.
+     */
+    static bool isSupported();
+
+    /**
+     * @brief Register a connected socket and start receiving on it.
+     *
+     * @param fd Socket file descriptor. The caller keeps its ownership.
+     * @param handlers Callbacks to invoke for the socket.
+     */
+    void add(int fd, Handlers handlers);
+
+    /**
+     * @brief Stop serving a socket. Sockets accepted by the loop are also closed.
+     *
+     * Messages already queued with send() are written first; the socket is released once they are.
+     *
+     * @param fd File descriptor previously registered.
+     */
+    void remove(int fd);
+
+    /**
+     * @brief Register a bound listening connection and accept its clients with multishot accept.
+     *
+     * @param listener Connection on which bind() has already been called.
+     * @param clientHandlers Callbacks attached to every accepted socket.
+     * @param onAccept Optional callback invoked with each accepted file descriptor.
+     */
+    void listen(IConnection& listener, Handlers clientHandlers, Callback onAccept = nullptr);
+
+    /**
+     * @brief Queue a message on a registered socket.
+     *
+     * Messages of the same socket are sent in order; partial writes are resumed automatically.
+     * The submission reaches the kernel on the next runOnce().
+     *
+     * @param fd File descriptor previously registered.
+     * @param message Message to be sent, moved into the loop until it is written.
+     * @return true if the message was queued, false if the socket is not registered or being removed.
+     */
+    bool send(int fd, std::string message);
+
+    /**
+     * @brief Submit queued work, wait for completions and dispatch them.
+     *
+     * @param timeoutMs Maximum time to wait in milliseconds, -1 to wait indefinitely.
+     * @return int Number of completions processed.
+     */
+    int runOnce(int timeoutMs = -1);
+
+    /**
+     * @brief Dispatch completions until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief Ask the loop to return from run(). Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * @brief Get the syscall and completion counters.
+     *
+     * @return const Stats& Counters accumulated since construction.
+     */
+    const Stats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Connection
+    {
+        int fd;                            ///< Socket file descriptor.
+        int slot;                          ///< Index in the registered file table, -1 if none.
+        bool owned;                        ///< The loop closes the socket on removal.
+        bool listening;                    ///< The socket is a listener.
+        bool closed;                       ///< Removed from the loop, waiting for its completions.
+        bool sending;                      ///< A sendmsg is in flight.
+        bool draining;                     ///< Removed by the user, released once its messages are written.
+        int outstanding;                   ///< Requests that will still produce completions.
+        Handlers handlers;                 ///< Callbacks of the socket.
+        Handlers clientHandlers;           ///< Callbacks given to accepted sockets, listeners only.
+        Callback onAccept;                 ///< Accept notification, listeners only.
+        std::deque<std::string> pending;   ///< Messages waiting for the in-flight send.
+        std::vector<std::string> inFlight; ///< Messages referenced by the in-flight send.
+        std::vector<struct iovec> iov;     ///< Remaining part of the in-flight messages.
+        struct msghdr msg;                 ///< Header of the in-flight send.
+    };
+
+    enum class Operation : uint64_t
+    {
+        Wake = 1,
+        Accept = 2,
+        Recv = 3,
+        Send = 4,
+        Cancel = 5
+    };
+
+    void setupRings(unsigned entries);
+    void setupBuffers();
+    void setupFiles();
+    struct io_uring_sqe* nextSqe();
+    void prepare(struct io_uring_sqe* sqe, Connection& connection, uint8_t opcode, Operation operation);
+    void submitAccept(Connection& connection);
+    void submitRecv(Connection& connection);
+    void submitSend(Connection& connection);
+    void submitWake();
+    void submitCancel(Connection& connection);
+    void recycleBuffer(uint16_t bufferId);
+    Connection& registerConnection(int fd, bool owned, bool listening);
+    void closeConnection(Connection& connection, bool notify);
+    void release(Connection& connection);
+    void handleCompletion(const struct io_uring_cqe& cqe);
+    void handleAccept(Connection& connection, const struct io_uring_cqe& cqe);
+    void handleRecv(Connection& connection, const struct io_uring_cqe& cqe);
+    void handleSend(Connection& connection, const struct io_uring_cqe& cqe);
+    int enter(unsigned minComplete, int timeoutMs, bool getEvents);
+    void releaseRings();
+
+    int m_ringFd;                      ///< File descriptor of the io_uring instance.
+    int m_wakeFd;                      ///< eventfd used by stop() to interrupt a wait.
+    uint64_t m_wakeValue;              ///< Target of the eventfd read.
+    std::atomic<bool> m_stopRequested; ///< Flag set by stop() and cleared when run() returns.
+    Stats m_stats;                     ///< Syscall and completion counters.
+
+    void* m_sqRing;              ///< Mapping of the submission ring.
+    size_t m_sqRingSize;         ///< Length of the submission ring mapping.
+    void* m_cqRing;              ///< Mapping of the completion ring, may alias m_sqRing.
+    size_t m_cqRingSize;         ///< Length of the completion ring mapping.
+    struct io_uring_sqe* m_sqes; ///< Mapping of the submission queue entries.
+    size_t m_sqesSize;           ///< Length of the submission queue entries mapping.
+    unsigned* m_sqHead;          ///< Kernel-owned submission head.
+    unsigned* m_sqTail;          ///< Submission tail published to the kernel.
+    unsigned m_sqMask;           ///< Mask of the submission ring.
+    unsigned m_sqEntries;        ///< Size of the submission ring.
+    unsigned m_sqLocalTail;      ///< Submission tail not yet published.
+    unsigned m_unsubmitted;      ///< Entries published but not yet consumed by the kernel.
+    unsigned* m_cqHead;          ///< Completion head published to the kernel.
+    unsigned* m_cqTail;          ///< Kernel-owned completion tail.
+    unsigned m_cqMask;           ///< Mask of the completion ring.
+    struct io_uring_cqe* m_cqes; ///< Completion queue entries.
+
+    unsigned m_bufferCount;      ///< Number of provided receive buffers.
+    unsigned m_bufferSize;       ///< Length of each provided receive buffer.
+    void* m_bufferRing;          ///< Provided buffer ring shared with the kernel.
+    size_t m_bufferRingSize;     ///< Length of the provided buffer ring mapping.
+    uint16_t m_bufferTail;       ///< Tail of the provided buffer ring.
+    std::vector<char> m_buffers; ///< Storage of the provided receive buffers.
+
+    unsigned m_maxFiles;          ///< Slots in the registered file table.
+    std::vector<int> m_freeSlots; ///< Unused slots of the registered file table.
+
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;     ///< Registered sockets.
+    std::unordered_map<Connection*, std::unique_ptr<Connection>> m_retired; ///< Removed, still referenced.
+};
+
+#endif // _URING_LOOP_HPP
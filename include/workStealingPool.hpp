@@ -0,0 +1,196 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _WORK_STEALING_POOL_HPP
+#define _WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr auto WORK_DEQUE_CAPACITY = 256; // Macro for the initial slots of each worker deque
+
+/**
+ * @brief Unit of work run by a WorkStealingPool.
+ */
+using Task = std::function<void()>;
+
+/**
+ * @brief Chase-Lev work-stealing deque of tasks.
+ *
+ * The owner thread pushes and pops at the bottom without locking; any other thread steals from the
+ * top with a single compare-and-swap. The slot array doubles when full; replaced arrays are kept
+ * until destruction because a concurrent thief may still be reading them.
+ */
+class WorkStealingDeque
+{
+public:
+    /**
+     * @brief Construct a new WorkStealingDeque object.
+     *
+     * @param capacity Initial number of slots, must be a power of two.
+     */
+    explicit WorkStealingDeque(size_t capacity = WORK_DEQUE_CAPACITY);
+
+    /**
+     * @brief Destroy the WorkStealingDeque object, deleting the tasks still queued.
+     */
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Push a task at the bottom. Owner thread only.
+     *
+     * @param task Heap-allocated task, owned by the deque until it is taken.
+     */
+    void push(Task* task);
+
+    /**
+     * @brief Take the most recently pushed task. Owner thread only.
+     *
+     * @return Task* Task now owned by the caller, nullptr if the deque is empty.
+     */
+    Task* pop();
+
+    /**
+     * @brief Take the oldest task. Safe to call from any thread.
+     *
+     * @return Task* Task now owned by the caller, nullptr if the deque is empty or the race was lost.
+     */
+    Task* steal();
+
+private:
+    struct Array
+    {
+        explicit Array(size_t capacity);
+
+        size_t mask;                                 ///< Capacity minus one.
+        std::unique_ptr<std::atomic<Task*>[]> slots; ///< Circular buffer indexed by position & mask.
+    };
+
+    Array* grow(Array* array, int64_t top, int64_t bottom);
+
+    std::atomic<int64_t> m_top;                   ///< Next position to steal.
+    std::atomic<int64_t> m_bottom;                ///< Next position to push.
+    std::atomic<Array*> m_array;                  ///< Current slot array.
+    std::vector<std::unique_ptr<Array>> m_arrays; ///< Every array allocated, current one included.
+};
+
+/**
+ * @brief Thread pool where every worker owns a work-stealing deque.
+ *
+ * Tasks submitted from a worker go to its own deque and are run newest first, which keeps related
+ * work on the same core; tasks submitted from any other thread (for instance an I/O thread) go to a
+ * shared injection queue. An idle worker first drains its deque, then the injection queue, then
+ * steals the oldest task of another worker, so uneven load spreads across every core without a
+ * global lock on the common path. A task that throws does not stop its worker: the first exception is
+ * kept and rethrown by wait().
+ */
+class WorkStealingPool
+{
+public:
+    /**
+     * @brief Snapshot of the pool activity.
+     */
+    struct Counters
+    {
+        uint64_t executed; ///< Tasks run.
+        uint64_t stolen;   ///< Tasks taken from the deque of another worker.
+    };
+
+    /**
+     * @brief Construct a new WorkStealingPool object and start its workers.
+     *
+     * @param threads Number of workers, 0 for one per hardware thread.
+     */
+    explicit WorkStealingPool(size_t threads = 0);
+
+    /**
+     * @brief Destroy the WorkStealingPool object after running every submitted task.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queue a task. Safe to call from any thread, including from a running task.
+     *
+     * @param task Work to run on one of the workers.
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Block until every submitted task has run, including tasks they submitted.
+     *
+     * @throw The first exception thrown by a task since the previous wait(), once the pool is idle.
+     */
+    void wait();
+
+    /**
+     * @brief Get the number of workers.
+     *
+     * @return size_t Worker threads.
+     */
+    size_t size() const
+    {
+        return m_workers.size();
+    }
+
+    /**
+     * @brief Get a snapshot of the pool activity.
+     *
+     * @return Counters Current counter values.
+     */
+    Counters counters() const;
+
+private:
+    struct Worker
+    {
+        WorkStealingDeque deque; ///< Tasks submitted by this worker.
+        std::thread thread;      ///< Thread running work().
+    };
+
+    void work(size_t index);
+    Task* take(size_t index);
+    void finish();
+    void waitIdle();
+
+    std::vector<std::unique_ptr<Worker>> m_workers; ///< Workers and their deques.
+    std::mutex m_injectMutex;                       ///< Protects the injection queue.
+    std::deque<Task*> m_injected;                   ///< Tasks submitted from outside the pool.
+    std::mutex m_mutex;                             ///< Protects sleeping and stopping.
+    std::condition_variable m_wake;                 ///< Signaled when work is queued or on shutdown.
+    std::condition_variable m_idle;                 ///< Signaled when the last pending task finishes.
+    std::atomic<size_t> m_queued;                   ///< Tasks queued and not yet taken.
+    std::atomic<size_t> m_pending;                  ///< Tasks queued or running.
+    std::atomic<size_t> m_sleeping;                 ///< Workers waiting on m_wake.
+    bool m_stopping;                                ///< Set by the destructor.
+    std::exception_ptr m_error;                     ///< First exception thrown by a task, guarded by m_mutex.
+    std::atomic<uint64_t> m_executed;               ///< Tasks run.
+    std::atomic<uint64_t> m_stolen;                 ///< Tasks stolen.
+};
+
+#endif // _WORK_STEALING_POOL_HPP
@@ -0,0 +1,147 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _WRITE_QUEUE_HPP
+#define _WRITE_QUEUE_HPP
+
+#include "connectionMetrics.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+constexpr auto WRITE_QUEUE_HIGH_WATERMARK = 4 * 1024 * 1024; // Macro for queued bytes that throttle producers
+constexpr auto WRITE_QUEUE_LOW_WATERMARK = 1024 * 1024;      // Macro for queued bytes that release producers
+
+/**
+ * @brief Outbound byte queue of a non-blocking stream socket, with high and low watermarks.
+ *
+ * write() sends as much as the socket takes right away and keeps the rest in order; flush() resumes
+ * once the socket is writable again (for instance from EventLoop's onWritable). When the queued bytes
+ * reach the high watermark the queue becomes throttled: further writes are refused until flush()
+ * brings it down to the low watermark, so a slow peer cannot make the process buffer without limit.
+ */
+class WriteQueue
+{
+public:
+    /**
+     * @brief Callback invoked when the queue crosses one of its watermarks.
+     */
+    using Callback = std::function<void()>;
+
+    /**
+     * @brief Construct a new WriteQueue object.
+     *
+     * @param socket Non-blocking socket to write to. The caller keeps its ownership.
+     * @param highWatermark Queued bytes at which writes start being refused.
+     * @param lowWatermark Queued bytes at which writes are accepted again.
+     */
+    explicit WriteQueue(int socket,
+                        size_t highWatermark = WRITE_QUEUE_HIGH_WATERMARK,
+                        size_t lowWatermark = WRITE_QUEUE_LOW_WATERMARK);
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    /**
+     * @brief Send a message, queueing whatever the socket does not take immediately.
+     *
+     * @param parts Pieces of the message, written back to back.
+     * @return true if the whole message was sent or queued, false if the queue is throttled and the
+     * message was not taken at all.
+     */
+    bool write(std::span<const std::string_view> parts);
+
+    /**
+     * @brief Send a message, queueing whatever the socket does not take immediately.
+     *
+     * @param data Message to be sent.
+     * @return true if the message was sent or queued, false if the queue is throttled.
+     */
+    bool write(std::string_view data);
+
+    /**
+     * @brief Write queued bytes until the queue is empty or the socket is full.
+     *
+     * @return size_t Number of bytes written.
+     */
+    size_t flush();
+
+    /**
+     * @brief Set the watermarks; the low one must not exceed the high one.
+     *
+     * @param highWatermark Queued bytes at which writes start being refused.
+     * @param lowWatermark Queued bytes at which writes are accepted again.
+     */
+    void setWatermarks(size_t highWatermark, size_t lowWatermark);
+
+    /**
+     * @brief Set the callbacks raised when the queue becomes throttled and when it is released.
+     *
+     * @param onHighWatermark Invoked by write() when the queue reaches the high watermark.
+     * @param onLowWatermark Invoked by flush() when a throttled queue drains to the low watermark.
+     */
+    void setCallbacks(Callback onHighWatermark, Callback onLowWatermark);
+
+    /**
+     * @brief Count the writes of the queue in the metrics of a connection.
+     *
+     * @param metrics Metrics to update, nullptr to stop counting. Must outlive the queue.
+     */
+    void setMetrics(ConnectionMetrics* metrics)
+    {
+        m_metrics = metrics;
+    }
+
+    /**
+     * @brief Get the number of bytes waiting to be written.
+     *
+     * @return size_t Queued bytes.
+     */
+    size_t pending() const
+    {
+        return m_pending;
+    }
+
+    /**
+     * @brief Check whether writes are currently refused.
+     *
+     * @return true between reaching the high watermark and draining to the low one.
+     */
+    bool throttled() const
+    {
+        return m_throttled;
+    }
+
+private:
+    void consume(size_t bytes);
+
+    int m_socket;                     ///< Socket written to.
+    std::deque<std::string> m_chunks; ///< Unsent messages, oldest first.
+    size_t m_offset;                  ///< Bytes of the first chunk already written.
+    size_t m_pending;                 ///< Unsent bytes across every chunk.
+    size_t m_highWatermark;           ///< Queued bytes that throttle writes.
+    size_t m_lowWatermark;            ///< Queued bytes that release writes.
+    bool m_throttled;                 ///< Writes are refused until the low watermark.
+    Callback m_onHighWatermark;       ///< Raised when the queue becomes throttled.
+    Callback m_onLowWatermark;        ///< Raised when the queue is released.
+    ConnectionMetrics* m_metrics;     ///< Metrics updated by the writes, may be nullptr.
+};
+
+#endif // _WRITE_QUEUE_HPP
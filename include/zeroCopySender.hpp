@@ -0,0 +1,158 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef _ZERO_COPY_SENDER_HPP
+#define _ZERO_COPY_SENDER_HPP
+
+#include "cppSocket.hpp"
+
+#include <deque>
+#include <future>
+
+constexpr auto ZEROCOPY_THRESHOLD = 10240; // Macro for the smallest payload sent with MSG_ZEROCOPY
+
+/**
+ * @brief Opt-in MSG_ZEROCOPY sender for large payloads on a TCP socket.
+ *
+ * Payloads of at least the threshold are handed to the kernel by reference: the pages are pinned
+ * instead of copied, and the buffer must stay untouched until its completion is reported. The kernel
+ * signals completions through the socket error queue; pollCompletions() reads them and invokes the
+ * completion of every buffer that can be reused. With an EventLoop, call pollCompletions(0) from the
+ * onErrorQueue handler of the socket. Smaller payloads, and every payload when the kernel does not
+ * support SO_ZEROCOPY, take the normal copying path and complete immediately.
+ */
+class ZeroCopySender
+{
+public:
+    /**
+     * @brief Callback invoked once the buffer of a send may be reused.
+     *
+     * The argument is true if the kernel copied the data anyway (for instance over loopback), in
+     * which case zero-copy brought no gain for that send.
+     */
+    using Completion = std::function<void(bool copied)>;
+
+    /**
+     * @brief Snapshot of the sender activity.
+     */
+    struct Counters
+    {
+        uint64_t zeroCopySends; ///< sendmsg calls made with MSG_ZEROCOPY.
+        uint64_t copiedSends;   ///< Payloads sent through the copying path.
+        uint64_t kernelCopies;  ///< Zero-copy payloads the kernel reported as copied.
+    };
+
+    /**
+     * @brief Construct a new ZeroCopySender object and enable SO_ZEROCOPY on the socket.
+     *
+     * @param connection Connected TCP connection (or listener, together with socket).
+     * @param socket Accepted socket to send through, -1 to use the socket of the connection itself.
+     * @param threshold Smallest payload sent with MSG_ZEROCOPY.
+     */
+    ZeroCopySender(IConnection& connection, int socket = -1, size_t threshold = ZEROCOPY_THRESHOLD);
+
+    ZeroCopySender(const ZeroCopySender&) = delete;
+    ZeroCopySender& operator=(const ZeroCopySender&) = delete;
+
+    /**
+     * @brief Send a whole payload, blocking until the kernel accepted every byte.
+     *
+     * On a non-blocking connection small payloads go through its writeQueue(). Zero-copy payloads
+     * are written to the socket directly, so they are refused while that queue cannot be emptied.
+     *
+     * @param buffer Payload; with zero-copy it must stay valid and unchanged until onComplete runs.
+     * @param onComplete Invoked when the buffer may be reused, possibly before send() returns; never
+     * invoked for a payload that was not sent.
+     * @return true if the payload is successfully sent, false if the write queue is throttled or
+     * still holds bytes.
+     */
+    bool send(std::string_view buffer, Completion onComplete);
+
+    /**
+     * @brief Send a whole payload and get a future ready when the buffer may be reused.
+     *
+     * @param buffer Payload; with zero-copy it must stay valid and unchanged until the future is ready.
+     * @return std::future<bool> Ready once the buffer may be reused; holds true if the kernel copied it,
+     * or a std::runtime_error if the payload was not sent.
+     */
+    std::future<bool> send(std::string_view buffer);
+
+    /**
+     * @brief Read the completions waiting in the error queue and invoke the finished completions.
+     *
+     * @param timeoutMs Time to wait for a completion when none is queued, 0 to only read what is
+     * already there, -1 to wait indefinitely.
+     * @return size_t Number of sends completed.
+     */
+    size_t pollCompletions(int timeoutMs = 0);
+
+    /**
+     * @brief Wait until every zero-copy send has completed.
+     */
+    void flush();
+
+    /**
+     * @brief Check whether the kernel accepted SO_ZEROCOPY on the socket.
+     *
+     * @return true if large payloads are sent with MSG_ZEROCOPY, false if every send copies.
+     */
+    bool enabled() const
+    {
+        return m_enabled;
+    }
+
+    /**
+     * @brief Get the number of sends whose buffer is still owned by the kernel.
+     *
+     * @return size_t Pending zero-copy sends.
+     */
+    size_t pending() const
+    {
+        return m_pending.size();
+    }
+
+    /**
+     * @brief Get a snapshot of the sender activity.
+     *
+     * @return Counters Current counter values.
+     */
+    Counters counters() const
+    {
+        return m_counters;
+    }
+
+private:
+    struct Pending
+    {
+        uint64_t firstId;      ///< First notification id of the send.
+        uint64_t lastId;       ///< Last notification id of the send.
+        uint64_t completedIds; ///< Notification ids of the send reported so far.
+        bool copied;           ///< The kernel reported a copy for part of the send.
+        Completion onComplete; ///< Callback of the send.
+    };
+
+    size_t complete(uint64_t first, uint64_t last, bool copied);
+
+    IConnection& m_connection;     ///< Connection the socket belongs to.
+    int m_socket;                  ///< Socket the payloads are sent through.
+    size_t m_threshold;            ///< Smallest payload sent with MSG_ZEROCOPY.
+    bool m_enabled;                ///< SO_ZEROCOPY is set on the socket.
+    uint64_t m_nextId;             ///< Notification id the kernel gives to the next zero-copy call.
+    std::deque<Pending> m_pending; ///< Sends waiting for their completion, oldest first.
+    Counters m_counters;           ///< Activity counters.
+};
+
+#endif // _ZERO_COPY_SENDER_HPP
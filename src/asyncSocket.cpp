@@ -0,0 +1,408 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "asyncSocket.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief Fire-and-forget coroutine driving a spawned task; its frame frees itself at the end.
+     */
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object()
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    Detached runDetached(AsyncTask<void> task, std::function<void(std::exception_ptr)> onError)
+    {
+        try
+        {
+            co_await task;
+        }
+        catch (...)
+        {
+            if (onError)
+            {
+                onError(std::current_exception());
+            }
+        }
+    }
+
+    /**
+     * @brief Awaiter resuming the coroutine from a timer of the loop.
+     */
+    struct Sleep
+    {
+        EventLoop& loop;                 ///< Loop owning the timer.
+        std::chrono::milliseconds delay; ///< Time to wait.
+
+        bool await_ready() const noexcept
+        {
+            return delay.count() <= 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            loop.addTimer(delay, [handle] { handle.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+} // namespace
+
+void spawn(AsyncTask<void> task, std::function<void(std::exception_ptr)> onError)
+{
+    runDetached(std::move(task), std::move(onError));
+}
+
+AsyncTask<void> asyncSleep(EventLoop& loop, std::chrono::milliseconds delay)
+{
+    co_await Sleep {loop, delay};
+}
+
+/**
+ * @brief Awaiter suspending an operation until the socket is ready, the deadline passes or cancel().
+ */
+class AsyncSocket::Wait
+{
+public:
+    Wait(std::shared_ptr<State> state, bool writable, std::optional<std::chrono::milliseconds> remaining)
+        : m_state(std::move(state))
+        , m_writable(writable)
+        , m_remaining(remaining)
+        , m_waiter {nullptr, 0, Outcome::Ready}
+    {
+    }
+
+    bool await_ready() const
+    {
+        if (m_state->closed)
+        {
+            // No event will come any more: the retried call reports the failure.
+            throw std::runtime_error("Error: connection closed while waiting");
+        }
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        Waiter*& slot = m_writable ? m_state->writer : m_state->reader;
+        if (slot != nullptr)
+        {
+            throw std::logic_error("Error: another operation is already waiting in this direction");
+        }
+
+        m_waiter.handle = handle;
+        slot = &m_waiter;
+        if (m_remaining)
+        {
+            std::shared_ptr<State> state = m_state;
+            bool writable = m_writable;
+            auto onDeadline = [state, writable]
+            {
+                Waiter*& expired = writable ? state->writer : state->reader;
+                if (expired != nullptr)
+                {
+                    expired->timer = 0;
+                    wake(*state, expired, Outcome::TimedOut);
+                }
+            };
+            m_waiter.timer = m_state->loop->addTimer(*m_remaining, onDeadline);
+        }
+    }
+
+    void await_resume() const
+    {
+        if (m_waiter.outcome == Outcome::TimedOut)
+        {
+            throw AsyncTimeoutError();
+        }
+        if (m_waiter.outcome == Outcome::Canceled)
+        {
+            throw AsyncCanceledError();
+        }
+    }
+
+private:
+    std::shared_ptr<State> m_state;                       ///< State of the socket.
+    bool m_writable;                                      ///< Waiting for writability rather than readability.
+    std::optional<std::chrono::milliseconds> m_remaining; ///< Time left before the deadline, if any.
+    Waiter m_waiter;                                      ///< Registration, lives in the coroutine frame.
+};
+
+AsyncSocket::AsyncSocket(EventLoop& loop, IConnection& connection)
+    : AsyncSocket(loop, connection.getSocket(), false)
+{
+    m_connection = &connection;
+}
+
+AsyncSocket::AsyncSocket(EventLoop& loop, int socket, bool owned)
+    : m_state(std::make_shared<State>(State {&loop, nullptr, nullptr, false, false}))
+    , m_connection(nullptr)
+    , m_socket(socket)
+    , m_owned(owned)
+{
+    int flags = fcntl(m_socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(m_socket, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        throw std::runtime_error(std::string("Error: cannot set O_NONBLOCK: ") + strerror(errno));
+    }
+
+    // The handlers hold the state, not the socket: a resumed coroutine may destroy the socket.
+    std::shared_ptr<State> state = m_state;
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [state](int) { wake(*state, state->reader, Outcome::Ready); };
+    handlers.onWritable = [state](int) { wake(*state, state->writer, Outcome::Ready); };
+    handlers.onClosed = [state](int)
+    {
+        state->closed = true;
+        state->registered = false;
+        wake(*state, state->reader, Outcome::Ready);
+        wake(*state, state->writer, Outcome::Ready);
+    };
+    loop.add(m_socket, handlers);
+    m_state->registered = true;
+}
+
+AsyncSocket::~AsyncSocket()
+{
+    if (m_state->registered)
+    {
+        m_state->loop->remove(m_socket);
+    }
+    for (Waiter* waiter : {m_state->reader, m_state->writer})
+    {
+        if (waiter != nullptr && waiter->timer != 0)
+        {
+            m_state->loop->cancelTimer(waiter->timer);
+        }
+    }
+    m_state->reader = nullptr;
+    m_state->writer = nullptr;
+    if (m_owned)
+    {
+        ::close(m_socket);
+    }
+}
+
+void AsyncSocket::wake(State& state, Waiter*& slot, Outcome outcome)
+{
+    Waiter* waiter = std::exchange(slot, nullptr);
+    if (waiter == nullptr)
+    {
+        return;
+    }
+    if (waiter->timer != 0)
+    {
+        state.loop->cancelTimer(waiter->timer);
+        waiter->timer = 0;
+    }
+    waiter->outcome = outcome;
+    waiter->handle.resume();
+}
+
+std::optional<AsyncSocket::Clock::time_point> AsyncSocket::deadlineAfter(std::chrono::milliseconds timeout)
+{
+    if (timeout.count() < 0)
+    {
+        return std::nullopt;
+    }
+    return Clock::now() + timeout;
+}
+
+AsyncSocket::Wait AsyncSocket::wait(bool writable, std::optional<Clock::time_point> deadline)
+{
+    std::optional<std::chrono::milliseconds> remaining;
+    if (deadline)
+    {
+        remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now());
+        if (remaining->count() <= 0)
+        {
+            throw AsyncTimeoutError();
+        }
+    }
+    return Wait(m_state, writable, remaining);
+}
+
+void AsyncSocket::cancel()
+{
+    std::shared_ptr<State> state = m_state;
+    wake(*state, state->reader, Outcome::Canceled);
+    wake(*state, state->writer, Outcome::Canceled);
+}
+
+AsyncTask<void> AsyncSocket::asyncConnect(std::chrono::milliseconds timeout)
+{
+    if (m_connection == nullptr || m_connection->GetEndpoint().length == 0)
+    {
+        throw std::logic_error("Error: no address to connect to");
+    }
+
+    const auto deadline = deadlineAfter(timeout);
+    const ResolvedAddress& endpoint = m_connection->GetEndpoint();
+    if (::connect(m_socket, endpoint.data(), endpoint.length) == 0)
+    {
+        co_return;
+    }
+    if (errno != EINPROGRESS)
+    {
+        throw std::runtime_error(std::string("Error: cannot connect: ") + strerror(errno));
+    }
+
+    co_await wait(true, deadline);
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+    {
+        throw std::runtime_error(std::string("Error: cannot connect: ") + strerror(error));
+    }
+}
+
+AsyncTask<std::unique_ptr<AsyncSocket>> AsyncSocket::asyncAccept(std::chrono::milliseconds timeout)
+{
+    const auto deadline = deadlineAfter(timeout);
+    while (true)
+    {
+        int clientFd = ::accept4(m_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd >= 0)
+        {
+            co_return std::make_unique<AsyncSocket>(*m_state->loop, clientFd, true);
+        }
+        if (errno == EINTR || errno == ECONNABORTED)
+        {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            throw std::runtime_error(std::string("Error: cannot accept connection: ") + strerror(errno));
+        }
+        co_await wait(false, deadline);
+    }
+}
+
+AsyncTask<size_t> AsyncSocket::asyncReceive(std::span<std::byte> buffer, std::chrono::milliseconds timeout)
+{
+    const auto deadline = deadlineAfter(timeout);
+    while (true)
+    {
+        ssize_t bytesReceived = ::recv(m_socket, buffer.data(), buffer.size(), 0);
+        if (bytesReceived >= 0)
+        {
+            co_return static_cast<size_t>(bytesReceived);
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            throw std::runtime_error(std::string("Error: failed to receive message: ") + strerror(errno));
+        }
+        co_await wait(false, deadline);
+    }
+}
+
+AsyncTask<size_t> AsyncSocket::asyncSend(std::string_view data, std::chrono::milliseconds timeout)
+{
+    co_return co_await asyncSend(std::span<const std::string_view>(&data, 1), timeout);
+}
+
+AsyncTask<size_t> AsyncSocket::asyncSend(std::span<const std::string_view> parts, std::chrono::milliseconds timeout)
+{
+    if (parts.size() > IOV_MAX)
+    {
+        throw std::invalid_argument("Error: too many message parts");
+    }
+
+    const auto deadline = deadlineAfter(timeout);
+    std::vector<struct iovec> iov;
+    iov.reserve(parts.size());
+    size_t total = 0;
+    for (const std::string_view& part : parts)
+    {
+        if (!part.empty())
+        {
+            iov.push_back({const_cast<char*>(part.data()), part.size()});
+            total += part.size();
+        }
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+
+    while (msg.msg_iovlen > 0)
+    {
+        ssize_t sentBytes = ::sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+        if (sentBytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                throw std::runtime_error(std::string("Error: message sending failure: ") + strerror(errno));
+            }
+            co_await wait(true, deadline);
+            continue;
+        }
+
+        // Skip the fully written parts and trim the partially written one.
+        size_t written = static_cast<size_t>(sentBytes);
+        while (msg.msg_iovlen > 0 && written >= msg.msg_iov->iov_len)
+        {
+            written -= msg.msg_iov->iov_len;
+            ++msg.msg_iov;
+            --msg.msg_iovlen;
+        }
+        if (msg.msg_iovlen > 0)
+        {
+            msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + written;
+            msg.msg_iov->iov_len -= written;
+        }
+    }
+    co_return total;
+}
@@ -0,0 +1,282 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "bufferPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    std::atomic<uint64_t> nextPoolId {1};
+
+    /**
+     * @brief Registry of live pools, used to hand cached slabs back when a thread exits.
+     */
+    std::mutex& registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    std::unordered_map<uint64_t, BufferPool*>& livePools()
+    {
+        static std::unordered_map<uint64_t, BufferPool*> pools;
+        return pools;
+    }
+} // namespace
+
+/**
+ * @brief Free slabs cached by one thread, one list per pool it used.
+ */
+struct BufferPoolThreadCaches
+{
+    struct Cache
+    {
+        uint64_t poolId;
+        std::vector<std::byte*> slabs;
+    };
+
+    std::vector<Cache> caches;
+
+    ~BufferPoolThreadCaches()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (Cache& cache : caches)
+        {
+            auto it = livePools().find(cache.poolId);
+            if (it != livePools().end())
+            {
+                it->second->drain(cache.slabs);
+            }
+        }
+    }
+
+    std::vector<std::byte*>& find(uint64_t poolId)
+    {
+        for (Cache& cache : caches)
+        {
+            if (cache.poolId == poolId)
+            {
+                return cache.slabs;
+            }
+        }
+        caches.push_back(Cache {poolId, {}});
+        return caches.back().slabs;
+    }
+
+    // Unlike find(), never allocates: nullptr when the thread has no cache for the pool.
+    std::vector<std::byte*>* lookup(uint64_t poolId) noexcept
+    {
+        for (Cache& cache : caches)
+        {
+            if (cache.poolId == poolId)
+            {
+                return &cache.slabs;
+            }
+        }
+        return nullptr;
+    }
+
+    void forget(uint64_t poolId)
+    {
+        caches.erase(std::remove_if(caches.begin(),
+                                    caches.end(),
+                                    [poolId](const Cache& cache) { return cache.poolId == poolId; }),
+                     caches.end());
+    }
+};
+
+namespace
+{
+    thread_local BufferPoolThreadCaches threadCaches;
+} // namespace
+
+PooledBuffer::PooledBuffer() noexcept
+    : m_pool(nullptr)
+    , m_data(nullptr)
+    , m_capacity(0)
+    , m_size(0)
+{
+}
+
+PooledBuffer::PooledBuffer(BufferPool* pool, std::byte* data, size_t capacity) noexcept
+    : m_pool(pool)
+    , m_data(data)
+    , m_capacity(capacity)
+    , m_size(0)
+{
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_data(other.m_data)
+    , m_capacity(other.m_capacity)
+    , m_size(other.m_size)
+{
+    other.m_pool = nullptr;
+    other.m_data = nullptr;
+    other.m_capacity = 0;
+    other.m_size = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        std::swap(m_pool, other.m_pool);
+        std::swap(m_data, other.m_data);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+    }
+    return *this;
+}
+
+PooledBuffer::~PooledBuffer()
+{
+    reset();
+}
+
+void PooledBuffer::reset() noexcept
+{
+    if (m_data != nullptr)
+    {
+        m_pool->release(m_data);
+    }
+    m_pool = nullptr;
+    m_data = nullptr;
+    m_capacity = 0;
+    m_size = 0;
+}
+
+void PooledBuffer::resize(size_t size)
+{
+    if (size > m_capacity)
+    {
+        throw std::out_of_range("Error: size exceeds buffer capacity");
+    }
+    m_size = size;
+}
+
+BufferPool::BufferPool(size_t slabSize, size_t slabsPerChunk, size_t threadCacheSize)
+    : m_id(nextPoolId.fetch_add(1, std::memory_order_relaxed))
+    , m_slabSize(slabSize)
+    , m_slabsPerChunk(slabsPerChunk)
+    , m_threadCacheSize(std::max<size_t>(threadCacheSize, 1))
+    , m_chunkAllocations(0)
+    , m_acquisitions(0)
+    , m_releases(0)
+    , m_cacheHits(0)
+{
+    if (slabSize == 0 || slabsPerChunk == 0)
+    {
+        throw std::invalid_argument("Error: empty buffer pool");
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    livePools().emplace(m_id, this);
+}
+
+BufferPool::~BufferPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        livePools().erase(m_id);
+    }
+    // Caches of other threads still list slabs of this pool; the unique id keeps them from being used.
+    threadCaches.forget(m_id);
+}
+
+PooledBuffer BufferPool::acquire()
+{
+    // Room for a full cache is made here, where throwing is allowed, so release() never grows it.
+    std::vector<std::byte*>& cache = threadCaches.find(m_id);
+    cache.reserve(m_threadCacheSize + 1);
+    if (cache.empty())
+    {
+        refill(cache);
+    }
+    else
+    {
+        m_cacheHits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::byte* slab = cache.back();
+    cache.pop_back();
+    m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return PooledBuffer(this, slab, m_slabSize);
+}
+
+void BufferPool::release(std::byte* slab) noexcept
+{
+    m_releases.fetch_add(1, std::memory_order_relaxed);
+
+    // A thread that never acquired from the pool has no cache to put the slab in; the shared free list
+    // always has room for every slab of the pool.
+    std::vector<std::byte*>* cache = threadCaches.lookup(m_id);
+    if (cache == nullptr || cache->size() == cache->capacity())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(slab);
+        return;
+    }
+    cache->push_back(slab);
+    if (cache->size() > m_threadCacheSize)
+    {
+        drain(*cache);
+    }
+}
+
+void BufferPool::refill(std::vector<std::byte*>& cache)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty())
+    {
+        // Sized for every slab, so slabs coming back in release() and drain() never make it grow.
+        m_free.reserve((m_chunks.size() + 1) * m_slabsPerChunk);
+        m_chunks.push_back(std::make_unique<std::byte[]>(m_slabSize * m_slabsPerChunk));
+        m_chunkAllocations.fetch_add(1, std::memory_order_relaxed);
+        std::byte* chunk = m_chunks.back().get();
+        for (size_t i = 0; i < m_slabsPerChunk; ++i)
+        {
+            m_free.push_back(chunk + i * m_slabSize);
+        }
+    }
+
+    // Move half a cache worth of slabs so the next acquisitions stay lock-free.
+    size_t count = std::min(m_free.size(), m_threadCacheSize / 2 + 1);
+    cache.insert(cache.end(), m_free.end() - static_cast<std::ptrdiff_t>(count), m_free.end());
+    m_free.resize(m_free.size() - count);
+}
+
+void BufferPool::drain(std::vector<std::byte*>& cache) noexcept
+{
+    // Keep half of the cache for this thread, give the rest back to the other threads.
+    size_t keep = cache.size() > m_threadCacheSize ? m_threadCacheSize / 2 : 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.insert(m_free.end(), cache.begin() + static_cast<std::ptrdiff_t>(keep), cache.end());
+    cache.resize(keep);
+}
+
+BufferPool::Counters BufferPool::counters() const
+{
+    return Counters {m_chunkAllocations.load(std::memory_order_relaxed),
+                     m_acquisitions.load(std::memory_order_relaxed),
+                     m_releases.load(std::memory_order_relaxed),
+                     m_cacheHits.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,215 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "connectionMetrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    constexpr uint64_t SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS; // Buckets per power of two.
+
+    /**
+     * @brief Append one sample line, "name{labels} value", to an exposition text.
+     */
+    void appendSample(std::string& out, const std::string& name, std::string_view labels, double value)
+    {
+        char number[32];
+        snprintf(number, sizeof(number), "%.9g", value);
+        out += name;
+        if (!labels.empty())
+        {
+            out += '{';
+            out += labels;
+            out += '}';
+        }
+        out += ' ';
+        out += number;
+        out += '\n';
+    }
+
+    void appendCounter(std::string& out, std::string_view prefix, std::string_view labels, const char* name,
+                       uint64_t value)
+    {
+        std::string metric = std::string(prefix) + "_" + name + "_total";
+        out += "# TYPE " + metric + " counter\n";
+        appendSample(out, metric, labels, static_cast<double>(value));
+    }
+
+    void appendSummary(std::string& out, std::string_view prefix, std::string_view labels, const char* name,
+                       const HistogramSnapshot& histogram)
+    {
+        std::string metric = std::string(prefix) + "_" + name + "_seconds";
+        out += "# TYPE " + metric + " summary\n";
+        for (double quantile : {0.5, 0.9, 0.99, 0.999})
+        {
+            char quantileLabel[32];
+            snprintf(quantileLabel, sizeof(quantileLabel), "quantile=\"%g\"", quantile);
+            std::string quantileLabels = labels.empty() ? quantileLabel : std::string(labels) + "," + quantileLabel;
+            appendSample(out, metric, quantileLabels, static_cast<double>(histogram.percentile(quantile)) / 1e9);
+        }
+        appendSample(out, metric + "_sum", labels, static_cast<double>(histogram.sum) / 1e9);
+        appendSample(out, metric + "_count", labels, static_cast<double>(histogram.count));
+    }
+} // namespace
+
+uint64_t HistogramSnapshot::percentile(double quantile) const
+{
+    uint64_t total = 0;
+    for (uint64_t bucket : buckets)
+    {
+        total += bucket;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the sample, counted from 1, so that quantile 1 is the largest sample.
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            return std::min(LatencyHistogram::bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+HistogramSnapshot& HistogramSnapshot::operator+=(const HistogramSnapshot& other)
+{
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+    return *this;
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<size_t>(value);
+    }
+    // Keep the highest HISTOGRAM_SUB_BUCKET_BITS + 1 bits: the leading one picks the power of two.
+    const int shift = std::bit_width(value) - 1 - HISTOGRAM_SUB_BUCKET_BITS;
+    const uint64_t subBucket = (value >> shift) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((static_cast<uint64_t>(shift + 1) << HISTOGRAM_SUB_BUCKET_BITS) + subBucket);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+    const size_t shift = (index >> HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    const uint64_t subBucket = index & (SUB_BUCKETS - 1);
+    // Wraps to the largest value for the very last bucket.
+    return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < m_buckets.size(); ++i)
+    {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<uint64_t>& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+MetricsSnapshot& MetricsSnapshot::operator+=(const MetricsSnapshot& other)
+{
+    bytesSent += other.bytesSent;
+    bytesReceived += other.bytesReceived;
+    messagesSent += other.messagesSent;
+    messagesReceived += other.messagesReceived;
+    syscalls += other.syscalls;
+    wouldBlock += other.wouldBlock;
+    partialWrites += other.partialWrites;
+    errors += other.errors;
+    sendLatency += other.sendLatency;
+    receiveLatency += other.receiveLatency;
+    return *this;
+}
+
+std::string MetricsSnapshot::toPrometheus(std::string_view prefix, std::string_view labels) const
+{
+    std::string out;
+    appendCounter(out, prefix, labels, "bytes_sent", bytesSent);
+    appendCounter(out, prefix, labels, "bytes_received", bytesReceived);
+    appendCounter(out, prefix, labels, "messages_sent", messagesSent);
+    appendCounter(out, prefix, labels, "messages_received", messagesReceived);
+    appendCounter(out, prefix, labels, "syscalls", syscalls);
+    appendCounter(out, prefix, labels, "would_block", wouldBlock);
+    appendCounter(out, prefix, labels, "partial_writes", partialWrites);
+    appendCounter(out, prefix, labels, "errors", errors);
+    appendSummary(out, prefix, labels, "send_latency", sendLatency);
+    appendSummary(out, prefix, labels, "receive_latency", receiveLatency);
+    return out;
+}
+
+MetricsSnapshot ConnectionMetrics::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    snapshot.bytesSent = bytesSent.load(std::memory_order_relaxed);
+    snapshot.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+    snapshot.messagesSent = messagesSent.load(std::memory_order_relaxed);
+    snapshot.messagesReceived = messagesReceived.load(std::memory_order_relaxed);
+    snapshot.syscalls = syscalls.load(std::memory_order_relaxed);
+    snapshot.wouldBlock = wouldBlock.load(std::memory_order_relaxed);
+    snapshot.partialWrites = partialWrites.load(std::memory_order_relaxed);
+    snapshot.errors = errors.load(std::memory_order_relaxed);
+    snapshot.sendLatency = sendLatency.snapshot();
+    snapshot.receiveLatency = receiveLatency.snapshot();
+    return snapshot;
+}
+
+void ConnectionMetrics::reset()
+{
+    for (std::atomic<uint64_t>* counter :
+         {&bytesSent, &bytesReceived, &messagesSent, &messagesReceived, &syscalls, &wouldBlock, &partialWrites,
+          &errors})
+    {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    sendLatency.reset();
+    receiveLatency.reset();
+}
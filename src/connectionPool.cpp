@@ -0,0 +1,242 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "connectionPool.hpp"
+
+#include <poll.h>
+
+ConnectionPool::ConnectionPool(size_t maxPerEndpoint, std::chrono::milliseconds idleTimeout, bool isBlocking)
+    : m_maxPerEndpoint(maxPerEndpoint)
+    , m_idleTimeout(idleTimeout)
+    , m_isBlocking(isBlocking)
+    , m_counters {0, 0, 0, 0}
+{
+    if (maxPerEndpoint == 0)
+    {
+        throw std::invalid_argument("Error: connection pool needs at least one connection per endpoint");
+    }
+}
+
+ConnectionPool::~ConnectionPool() {}
+
+ConnectionPool::Lease ConnectionPool::acquire(const std::string& address,
+                                              const std::string& port,
+                                              int protocolMacro,
+                                              std::chrono::milliseconds timeout)
+{
+    const Clock::time_point deadline = Clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Endpoint& endpoint = m_endpoints[EndpointKey {address, port, protocolMacro}];
+
+    while (true)
+    {
+        evictExpired(endpoint, Clock::now());
+
+        // Most recently used first: it is the least likely to have been closed by the server.
+        while (!endpoint.idle.empty())
+        {
+            std::unique_ptr<IConnection> connection = std::move(endpoint.idle.back().connection);
+            endpoint.idle.pop_back();
+            ++endpoint.leased;
+            lock.unlock();
+
+            const bool healthy = isHealthy(*connection);
+            if (!healthy)
+            {
+                connection.reset();
+            }
+
+            lock.lock();
+            if (healthy)
+            {
+                ++m_counters.reused;
+                return Lease(this, &endpoint, std::move(connection));
+            }
+            --endpoint.leased;
+            ++m_counters.failedChecks;
+        }
+
+        if (endpoint.leased < m_maxPerEndpoint)
+        {
+            // The slot is reserved before the lock is released so concurrent callers respect the limit.
+            ++endpoint.leased;
+            lock.unlock();
+
+            std::unique_ptr<IConnection> connection;
+            try
+            {
+                connection = createConnection(address, port, m_isBlocking, protocolMacro);
+                connection->connect();
+            }
+            catch (...)
+            {
+                lock.lock();
+                --endpoint.leased;
+                lock.unlock();
+                m_released.notify_all();
+                throw;
+            }
+
+            lock.lock();
+            ++m_counters.created;
+            return Lease(this, &endpoint, std::move(connection));
+        }
+
+        if (timeout.count() < 0)
+        {
+            m_released.wait(lock);
+        }
+        else if (m_released.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            throw std::runtime_error("Error: no connection available for " + address + ":" + port);
+        }
+    }
+}
+
+void ConnectionPool::release(Endpoint& endpoint, std::unique_ptr<IConnection> connection, bool reusable)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --endpoint.leased;
+        if (reusable)
+        {
+            endpoint.idle.push_back(Idle {std::move(connection), Clock::now()});
+        }
+    }
+    m_released.notify_all();
+    // A discarded connection is closed here, outside the lock.
+}
+
+size_t ConnectionPool::evictExpired(Endpoint& endpoint, Clock::time_point now)
+{
+    // Idle connections are ordered by return time, so the expired ones are at the front.
+    auto firstKept = endpoint.idle.begin();
+    while (firstKept != endpoint.idle.end() && now - firstKept->lastUsed >= m_idleTimeout)
+    {
+        ++firstKept;
+    }
+
+    const auto evicted = static_cast<size_t>(firstKept - endpoint.idle.begin());
+    endpoint.idle.erase(endpoint.idle.begin(), firstKept);
+    m_counters.evicted += evicted;
+    return evicted;
+}
+
+size_t ConnectionPool::evictIdle()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Clock::time_point now = Clock::now();
+
+    size_t evicted = 0;
+    for (auto& [key, endpoint] : m_endpoints)
+    {
+        evicted += evictExpired(endpoint, now);
+    }
+    return evicted;
+}
+
+size_t ConnectionPool::idleCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t idle = 0;
+    for (const auto& [key, endpoint] : m_endpoints)
+    {
+        idle += endpoint.idle.size();
+    }
+    return idle;
+}
+
+ConnectionPool::Counters ConnectionPool::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+bool ConnectionPool::isHealthy(IConnection& connection)
+{
+    struct pollfd descriptor;
+    descriptor.fd = connection.getSocket();
+    descriptor.events = POLLIN | POLLRDHUP;
+    descriptor.revents = 0;
+
+    int ready = ::poll(&descriptor, 1, 0);
+    if (ready == 0)
+    {
+        return true;
+    }
+    // An idle connection must have nothing to report: readable means the peer closed it or left bytes
+    // from a previous exchange unread, and reusing it would hand them to the next request.
+    return ready < 0 && errno == EINTR;
+}
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool, Endpoint* endpoint, std::unique_ptr<IConnection> connection)
+    : m_pool(pool)
+    , m_endpoint(endpoint)
+    , m_connection(std::move(connection))
+{
+}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_endpoint(other.m_endpoint)
+    , m_connection(std::move(other.m_connection))
+{
+    other.m_pool = nullptr;
+    other.m_endpoint = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_pool = other.m_pool;
+        m_endpoint = other.m_endpoint;
+        m_connection = std::move(other.m_connection);
+        other.m_pool = nullptr;
+        other.m_endpoint = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+void ConnectionPool::Lease::release()
+{
+    if (m_connection)
+    {
+        // Bytes still queued by a non-blocking connection would reach the next borrower's peer late.
+        const bool drained = m_connection->writeQueue() == nullptr || m_connection->writeQueue()->pending() == 0;
+        m_pool->release(*m_endpoint, std::move(m_connection), drained);
+    }
+    m_pool = nullptr;
+    m_endpoint = nullptr;
+}
+
+void ConnectionPool::Lease::discard()
+{
+    if (m_connection)
+    {
+        m_pool->release(*m_endpoint, std::move(m_connection), false);
+    }
+    m_pool = nullptr;
+    m_endpoint = nullptr;
+}
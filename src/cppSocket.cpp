@@ -16,6 +16,16 @@
 
 #include "cppSocket.hpp"
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <utility>
+
 IConnection::IConnection(const std::string& address, const std::string& port, bool isBlocking)
     : m_address(address)
     , m_port(port)
@@ -25,345 +35,833 @@ IConnection::IConnection(const std::string& address, const std::string& port, bo
 
 IConnection::~IConnection() {}
 
-TCPv4Connection::TCPv4Connection(const std::string& address, const std::string& port, bool isBlocking)
-    : IConnection(address, port, isBlocking)
+namespace
 {
-    m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    // Never reported by epoll itself; marks sockets whose error queue, not the socket, has an error.
+    constexpr uint32_t EPOLL_ERROR_QUEUE = EPOLLMSG;
 
-    if (m_socket < 0)
+    /**
+     * @brief Check whether a socket is in blocking mode, where EAGAIN means SO_RCVTIMEO or SO_SNDTIMEO expired.
+     */
+    bool isBlockingSocket(int socket)
     {
-        throw std::runtime_error("Error creating socket");
+        return (fcntl(socket, F_GETFL, 0) & O_NONBLOCK) == 0;
     }
 
-    if (port.empty())
+    /**
+     * @brief Handle a failed receive call from its errno.
+     *
+     * @return ssize_t ERROR when a non-blocking socket has no data. A blocking socket whose receive
+     * timeout expires throws TimeoutError; any other failure throws std::runtime_error.
+     */
+    ssize_t receiveFailure(int socket, ConnectionMetrics* metrics)
     {
-        autoSelectPort = true;
-        socklen_t addr_len = sizeof(addrinfo4);
-        memset((char*)&addrinfo4, 0, addr_len);
-        addrinfo4.sin_family = AF_INET;
-        addrinfo4.sin_port = htons(0); // 0 will automatically select an available port.
-        addrinfo4.sin_addr.s_addr = INADDR_ANY;
-        return;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::wouldBlock);
+            if (isBlockingSocket(socket))
+            {
+                throw TimeoutError("Error: receive timed out");
+            }
+            return ERROR;
+        }
+        ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+        throw std::runtime_error(std::string("Error: failed to receive message: ") + strerror(errno));
     }
-    m_port = std::string(port);
 
-    struct addrinfo hints;
-    hints.ai_flags = 0;
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+    /**
+     * @brief Read once from a socket into a buffer.
+     *
+     * @return ssize_t Number of bytes read, 0 on orderly shutdown, ERROR when a non-blocking socket has
+     * no data. A blocking socket whose receive timeout expires throws TimeoutError; any other failure
+     * throws std::runtime_error.
+     */
+    ssize_t receiveInto(int socket, void* data, size_t size, ConnectionMetrics* metrics)
+    {
+        LatencyHistogram::Scope timer(metrics != nullptr ? &metrics->receiveLatency : nullptr);
+        ssize_t bytesReceived;
+        do
+        {
+            bytesReceived = ::recv(socket, data, size, 0);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+        } while (bytesReceived < 0 && errno == EINTR);
+
+        if (bytesReceived < 0)
+        {
+            return receiveFailure(socket, metrics);
+        }
+        if (bytesReceived > 0)
+        {
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::messagesReceived);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesReceived, static_cast<uint64_t>(bytesReceived));
+        }
+        return bytesReceived;
+    }
 
-    if (address.empty())
+    /**
+     * @brief Read once from a socket into a per-thread scratch buffer and copy the bytes into a string.
+     *
+     * @param closedMessage Message of the exception thrown when the peer closed the connection.
+     */
+    std::string receiveMessage(int socket, const char* closedMessage, ConnectionMetrics* metrics)
     {
-        // for listening connections
-        hints.ai_flags = AI_PASSIVE; // ANY_ADDRESS
+        thread_local std::vector<char> scratch(MAX_MESSAGE_LENGTH);
+
+        ssize_t bytesReceived = receiveInto(socket, scratch.data(), scratch.size(), metrics);
+        if (bytesReceived == ERROR)
+        {
+            throw std::runtime_error("Error: failed to receive message");
+        }
+        else if (bytesReceived == 0)
+        {
+            throw std::runtime_error(closedMessage);
+        }
+
+        return std::string(scratch.data(), static_cast<size_t>(bytesReceived));
     }
 
-    addrinfo* raw_addrinfo = nullptr;
-    int resultAddrInfo = getaddrinfo(address.empty() ? nullptr : address.c_str(), port.c_str(), &hints, &raw_addrinfo);
+    /**
+     * @brief Wait until a non-blocking socket that took part of a message can take more.
+     *
+     * The rest of a message cannot be dropped without breaking the stream, so the wait is bounded by
+     * SEND_STALL_TIMEOUT_MS and a socket that failed meanwhile is reported instead of retried.
+     */
+    void waitWritable(int socket, ConnectionMetrics* metrics)
+    {
+        struct pollfd pollFd = {socket, POLLOUT, 0};
+        int ready;
+        do
+        {
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+            ready = ::poll(&pollFd, 1, SEND_STALL_TIMEOUT_MS);
+        } while (ready < 0 && errno == EINTR);
+
+        if (ready == 0)
+        {
+            throw TimeoutError("Error: send timed out with the message partly written");
+        }
+        if (ready < 0 || (pollFd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+        {
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+            throw std::runtime_error("Error: socket failed with the message partly written");
+        }
+    }
 
-    if (resultAddrInfo != 0)
+    /**
+     * @brief Write every part of a message with sendmsg, resuming after partial writes.
+     *
+     * A non-blocking socket that cannot take any byte leaves the message unsent and false is returned,
+     * so an event loop is never held by a slow reader. Once part of it is written, the rest is waited
+     * for with waitWritable(). A blocking socket whose send timeout expires throws TimeoutError.
+     */
+    bool sendParts(int socket, std::span<const std::string_view> parts, ConnectionMetrics* metrics)
     {
-        throw std::runtime_error(gai_strerror(resultAddrInfo));
+        LatencyHistogram::Scope timer(metrics != nullptr ? &metrics->sendLatency : nullptr);
+        if (parts.size() > IOV_MAX)
+        {
+            throw std::invalid_argument("Error: too many message parts");
+        }
+
+        std::array<struct iovec, SEND_PARTS_INLINE> inlineIov;
+        std::vector<struct iovec> heapIov;
+        struct iovec* iov = inlineIov.data();
+        if (parts.size() > inlineIov.size())
+        {
+            heapIov.resize(parts.size());
+            iov = heapIov.data();
+        }
+
+        size_t count = 0;
+        for (const std::string_view& part : parts)
+        {
+            if (!part.empty())
+            {
+                iov[count++] = {const_cast<char*>(part.data()), part.size()};
+            }
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        bool started = false;
+        while (msg.msg_iovlen > 0)
+        {
+            ssize_t sentBytes = ::sendmsg(socket, &msg, 0);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+            if (sentBytes < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    ConnectionMetrics::add(metrics, &ConnectionMetrics::wouldBlock);
+                    if (isBlockingSocket(socket))
+                    {
+                        throw TimeoutError("Error: send timed out");
+                    }
+                    if (!started)
+                    {
+                        return false;
+                    }
+                    waitWritable(socket, metrics);
+                    continue;
+                }
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+                throw std::runtime_error("Error: message sending failure");
+            }
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesSent, static_cast<uint64_t>(sentBytes));
+            started = true;
+
+            // Skip the fully written parts and trim the partially written one.
+            size_t written = static_cast<size_t>(sentBytes);
+            while (msg.msg_iovlen > 0 && written >= msg.msg_iov->iov_len)
+            {
+                written -= msg.msg_iov->iov_len;
+                ++msg.msg_iov;
+                --msg.msg_iovlen;
+            }
+            if (msg.msg_iovlen > 0)
+            {
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::partialWrites);
+                msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + written;
+                msg.msg_iov->iov_len -= written;
+            }
+        }
+        ConnectionMetrics::add(metrics, &ConnectionMetrics::messagesSent);
+        return true;
     }
 
-    m_addrinfo = std::unique_ptr<addrinfo>(raw_addrinfo);
-}
+    /**
+     * @brief Write a message to a Unix domain socket with file descriptors attached to its first byte.
+     *
+     * Full sockets and partial writes are handled like in sendParts(); the descriptors only go with the
+     * first sendmsg.
+     */
+    bool sendWithFds(int socket, std::string_view message, std::span<const int> fds, ConnectionMetrics* metrics)
+    {
+        if (message.empty())
+        {
+            throw std::invalid_argument("Error: descriptors need a message of at least one byte");
+        }
+        if (fds.size() > UNIX_MAX_FDS)
+        {
+            throw std::invalid_argument("Error: too many descriptors");
+        }
 
-TCPv4Connection::~TCPv4Connection()
-{
-    ::close(m_socket);
-}
+        LatencyHistogram::Scope timer(metrics != nullptr ? &metrics->sendLatency : nullptr);
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * UNIX_MAX_FDS)];
+        struct iovec iov = {const_cast<char*>(message.data()), message.size()};
 
-bool TCPv4Connection::bind()
-{
-    if (!autoSelectPort)
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (!fds.empty())
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+        }
+
+        while (iov.iov_len > 0)
+        {
+            ssize_t sentBytes = ::sendmsg(socket, &msg, 0);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+            if (sentBytes < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    ConnectionMetrics::add(metrics, &ConnectionMetrics::wouldBlock);
+                    if (isBlockingSocket(socket))
+                    {
+                        throw TimeoutError("Error: send timed out");
+                    }
+                    if (msg.msg_control != nullptr)
+                    {
+                        return false;
+                    }
+                    waitWritable(socket, metrics);
+                    continue;
+                }
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+                throw std::runtime_error(std::string("Error: descriptor sending failure: ") + strerror(errno));
+            }
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesSent, static_cast<uint64_t>(sentBytes));
+
+            msg.msg_control = nullptr;
+            msg.msg_controllen = 0;
+            iov.iov_base = static_cast<char*>(iov.iov_base) + sentBytes;
+            iov.iov_len -= static_cast<size_t>(sentBytes);
+            if (iov.iov_len > 0)
+            {
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::partialWrites);
+            }
+        }
+        ConnectionMetrics::add(metrics, &ConnectionMetrics::messagesSent);
+        return true;
+    }
+
+    /**
+     * @brief Read once from a Unix domain socket, collecting the file descriptors passed with the bytes.
+     *
+     * @return ssize_t Same as receiveInto(). Descriptors are appended to fds, close-on-exec; when the
+     * sender passed more than fit, the ones received are closed and std::runtime_error is thrown.
+     */
+    ssize_t receiveWithFds(int socket, std::span<std::byte> buffer, std::vector<int>& fds, ConnectionMetrics* metrics)
     {
-        if (::bind(m_socket, m_addrinfo->ai_addr, m_addrinfo->ai_addrlen) < 0)
+        LatencyHistogram::Scope timer(metrics != nullptr ? &metrics->receiveLatency : nullptr);
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * UNIX_MAX_FDS)];
+        struct iovec iov = {buffer.data(), buffer.size()};
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t bytesReceived;
+        do
         {
-            throw std::runtime_error("Error: cannot bind socket");
+            bytesReceived = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+        } while (bytesReceived < 0 && errno == EINTR);
+
+        if (bytesReceived < 0)
+        {
+            return receiveFailure(socket, metrics);
+        }
+
+        const size_t firstNew = fds.size();
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                fds.resize(fds.size() + count);
+                memcpy(fds.data() + fds.size() - count, CMSG_DATA(cmsg), count * sizeof(int));
+            }
+        }
+        if (msg.msg_flags & MSG_CTRUNC)
+        {
+            for (size_t i = firstNew; i < fds.size(); ++i)
+            {
+                ::close(fds[i]);
+            }
+            fds.resize(firstNew);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+            throw std::runtime_error("Error: received descriptors were truncated");
+        }
+
+        if (bytesReceived > 0)
+        {
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::messagesReceived);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesReceived, static_cast<uint64_t>(bytesReceived));
         }
+        return bytesReceived;
     }
-    else
+
+    /**
+     * @brief Check whether a Unix domain socket file is left over from a listener that no longer runs.
+     *
+     * A live listener answers a non-blocking connect (or refuses it with EAGAIN when its backlog is full);
+     * only ECONNREFUSED on an existing socket file means nobody serves the path anymore.
+     */
+    bool isStaleSocketFile(const ResolvedAddress& endpoint)
     {
-        socklen_t addr_len = sizeof(addrinfo4);
-        if (::bind(m_socket, (struct sockaddr*)&addrinfo4, addr_len) < 0)
+        const auto* unixAddress = reinterpret_cast<const struct sockaddr_un*>(&endpoint.address);
+        struct stat status;
+        if (unixAddress->sun_path[0] == '\0' || lstat(unixAddress->sun_path, &status) < 0 ||
+            !S_ISSOCK(status.st_mode))
         {
-            std::cout << "A" << std::endl;
-            throw std::runtime_error("Error: cannot bind socket");
+            return false;
+        }
+
+        int probe = ::socket(AF_UNIX, endpoint.socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (probe < 0)
+        {
+            return false;
         }
-        ::getsockname(m_socket, (struct sockaddr*)&addrinfo4, &addr_len);
-        m_port = std::to_string(ntohs(addrinfo4.sin_port));
+        const bool refused = ::connect(probe, endpoint.data(), endpoint.length) < 0 && errno == ECONNREFUSED;
+        ::close(probe);
+        return refused;
     }
 
-    int resultListen = ::listen(m_socket, TCP_BACKLOG); // Escuchar conexiones entrantes
-    if (resultListen < 0)
+    /**
+     * @brief Move file bytes to a socket with sendfile (regular files) or splice (pipes).
+     *
+     * @return size_t Bytes sent; fewer than length when the file ends or a non-blocking socket is full.
+     */
+    size_t sendFileBytes(int socket, int fd, off_t offset, size_t length, ConnectionMetrics* metrics)
     {
-        throw std::runtime_error("Error: cannot listen on socket");
+        LatencyHistogram::Scope timer(metrics != nullptr ? &metrics->sendLatency : nullptr);
+        struct stat status;
+        if (fstat(fd, &status) < 0)
+        {
+            throw std::runtime_error(std::string("Error: cannot stat file: ") + strerror(errno));
+        }
+        const bool isPipe = S_ISFIFO(status.st_mode);
+        if (isPipe && offset != 0)
+        {
+            throw std::invalid_argument("Error: pipes cannot be sent from an offset");
+        }
+        // A non-blocking socket must not end up waiting on the pipe either.
+        const bool nonBlocking = (fcntl(socket, F_GETFL, 0) & O_NONBLOCK) != 0;
+
+        size_t sent = 0;
+        while (sent < length)
+        {
+            // Both calls move at most 0x7ffff000 bytes at a time.
+            const size_t chunk = std::min<size_t>(length - sent, 0x7ffff000);
+            ssize_t moved;
+            if (isPipe)
+            {
+                unsigned int flags = SPLICE_F_MOVE | (nonBlocking ? SPLICE_F_NONBLOCK : 0);
+                if (sent + chunk < length)
+                {
+                    flags |= SPLICE_F_MORE;
+                }
+                moved = ::splice(fd, nullptr, socket, nullptr, chunk, flags);
+            }
+            else
+            {
+                off_t position = offset + static_cast<off_t>(sent);
+                moved = ::sendfile(socket, fd, &position, chunk);
+            }
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+
+            if (moved < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    ConnectionMetrics::add(metrics, &ConnectionMetrics::wouldBlock);
+                    break;
+                }
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+                throw std::runtime_error(std::string("Error: file sending failure: ") + strerror(errno));
+            }
+            if (moved == 0)
+            {
+                // End of the file, or the writer closed the pipe.
+                break;
+            }
+            sent += static_cast<size_t>(moved);
+        }
+        ConnectionMetrics::add(metrics, &ConnectionMetrics::messagesSent);
+        ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesSent, sent);
+        return sent;
     }
 
-    binded = true;
+    /**
+     * @brief Put a socket in non-blocking mode.
+     */
+    void setNonBlocking(int socket)
+    {
+        int flags = fcntl(socket, F_GETFL, 0);
+        if (flags < 0 || fcntl(socket, F_SETFL, flags | O_NONBLOCK) < 0)
+        {
+            throw std::runtime_error(std::string("Error: cannot set O_NONBLOCK: ") + strerror(errno));
+        }
+    }
 
-    return true;
-}
+    /**
+     * @brief Fill a ResolvedAddress with the address returned by accept4() or recvfrom().
+     */
+    ResolvedAddress toResolvedAddress(const struct sockaddr_storage& address, socklen_t length, int socktype)
+    {
+        ResolvedAddress resolved {};
+        resolved.address = address;
+        resolved.length = length;
+        resolved.family = address.ss_family;
+        resolved.socktype = socktype;
+        return resolved;
+    }
 
-int TCPv4Connection::connect()
-{
-    if (binded)
+    /**
+     * @brief Accept a client of a listening socket; clients of a non-blocking listener are non-blocking.
+     *
+     * Clients are created close-on-exec by accept4(), without extra fcntl() calls. Connections reset
+     * while queued are skipped.
+     *
+     * @param peer Filled with the address of the client, nullptr to discard it.
+     * @return int File descriptor of the client, ERROR if a non-blocking listener has none waiting.
+     */
+    int acceptClient(int listenFd, bool isBlocking, ResolvedAddress* peer = nullptr)
     {
-        // for server accept new connection
-        int clientFd = ::accept(m_socket, NULL, NULL); // Aceptar una conexión entrante
+        const int flags = (isBlocking ? 0 : SOCK_NONBLOCK) | SOCK_CLOEXEC;
+        struct sockaddr_storage address {};
+        socklen_t length;
+        int clientFd;
+        do
+        {
+            length = sizeof(address);
+            clientFd = ::accept4(listenFd, reinterpret_cast<struct sockaddr*>(&address), &length, flags);
+        } while (clientFd < 0 && (errno == EINTR || errno == ECONNABORTED));
+
         if (clientFd < 0)
         {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if (isBlocking)
+                {
+                    throw TimeoutError("Error: accept timed out");
+                }
+                return ERROR;
+            }
             throw std::runtime_error("Error: cannot accept connection");
         }
-
+        if (peer != nullptr)
+        {
+            *peer = toResolvedAddress(address, length, SOCK_STREAM);
+        }
         return clientFd;
     }
 
-    // connect client
-    if (::connect(m_socket, m_addrinfo->ai_addr, m_addrinfo->ai_addrlen) == -1)
+    /**
+     * @brief Connect a socket, waiting for the handshake of a non-blocking one to finish.
+     *
+     * With a timeout, a blocking socket is switched to non-blocking mode for the handshake so that the
+     * wait can be bounded with poll; TimeoutError is thrown when it expires.
+     */
+    void connectSocket(int socket, const ResolvedAddress& endpoint, std::chrono::milliseconds timeout)
     {
-        throw std::runtime_error("Error: cannot connect");
-    }
+        using Clock = std::chrono::steady_clock;
+        const int flags = fcntl(socket, F_GETFL, 0);
+        const bool restoreBlocking = timeout.count() > 0 && (flags & O_NONBLOCK) == 0;
+        if (restoreBlocking)
+        {
+            setNonBlocking(socket);
+        }
 
-    return true;
-}
+        // 1 when connected or failed at once, 0 when the handshake did not finish in time.
+        int ready = 1;
+        const bool connected = ::connect(socket, endpoint.data(), endpoint.length) == 0;
+        const bool pending = !connected && (errno == EINPROGRESS || errno == EINTR);
+        if (pending)
+        {
+            const auto deadline = Clock::now() + timeout;
+            struct pollfd pollFd = {socket, POLLOUT, 0};
+            do
+            {
+                int waitMs = -1;
+                if (timeout.count() > 0)
+                {
+                    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                    waitMs = static_cast<int>(std::max<int64_t>(left, 0));
+                }
+                ready = ::poll(&pollFd, 1, waitMs);
+            } while (ready < 0 && errno == EINTR);
+        }
+
+        if (restoreBlocking)
+        {
+            fcntl(socket, F_SETFL, flags);
+        }
+        if (connected)
+        {
+            return;
+        }
+        if (!pending)
+        {
+            throw std::runtime_error("Error: cannot connect");
+        }
+        if (ready == 0)
+        {
+            throw TimeoutError("Error: connect timed out");
+        }
+
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+        {
+            throw std::runtime_error("Error: cannot connect");
+        }
+    }
+} // namespace
 
-bool TCPv4Connection::send(const std::string& message)
+bool IConnection::send(std::span<const std::string_view> parts)
 {
-    int numberBytes = ::send(m_socket, message.c_str(), message.size(), 0); // contesta al cliente mediante el mismo fd
-    if (numberBytes < 0)
+    if (m_writeQueue)
     {
-        throw std::runtime_error("Error: message sending failure");
+        LatencyHistogram::Scope timer(m_metrics ? &m_metrics->sendLatency : nullptr);
+        return m_writeQueue->write(parts);
     }
-    return true;
+    return sendParts(m_socket, parts, m_metrics.get());
+}
+
+bool IConnection::sendto(std::span<const std::string_view> parts, int fdDestiny)
+{
+    return sendParts(fdDestiny, parts, m_metrics.get());
+}
+
+size_t IConnection::flush()
+{
+    return m_writeQueue ? m_writeQueue->flush() : 0;
 }
 
-bool TCPv4Connection::sendto(const std::string& message, int fdDestiny)
+ConnectionMetrics& IConnection::enableMetrics()
 {
-    int numberBytes = ::send(fdDestiny, message.c_str(), message.size(), 0); // contesta al cliente mediante el mismo fd
-    if (numberBytes < 0)
+    if (!m_metrics)
     {
-        throw std::runtime_error("Error: message sending failure");
+        m_metrics = std::make_unique<ConnectionMetrics>();
+        if (m_writeQueue)
+        {
+            m_writeQueue->setMetrics(m_metrics.get());
+        }
     }
-    return true;
+    return *m_metrics;
 }
 
-std::string TCPv4Connection::receiveFrom(int socket)
+ssize_t IConnection::receive(std::span<std::byte> buffer)
 {
-    std::vector<char> recvMessage;
-    recvMessage.resize(MAX_MESSAGE_LENGTH);
+    return receiveFrom(m_socket, buffer);
+}
 
-    int bytesReceived = ::recv(socket, recvMessage.data(), recvMessage.size(), 0);
-    if (bytesReceived < 0)
+ssize_t IConnection::receiveFrom(int socket, std::span<std::byte> buffer)
+{
+    return receiveInto(socket, buffer.data(), buffer.size(), m_metrics.get());
+}
+
+std::string_view IConnection::receiveView()
+{
+    return receiveViewFrom(m_socket);
+}
+
+std::string_view IConnection::receiveViewFrom(int socket)
+{
+    if (!m_viewBuffer)
     {
-        throw std::runtime_error("Error: failed to receive message");
+        m_viewBuffer = std::make_unique<std::byte[]>(MAX_MESSAGE_LENGTH);
     }
-    else if (bytesReceived == 0)
+
+    ssize_t bytesReceived = receiveFrom(socket, std::span<std::byte>(m_viewBuffer.get(), MAX_MESSAGE_LENGTH));
+    if (bytesReceived <= 0)
     {
-        throw std::runtime_error("Connection closed by peer receiveFrom");
+        return {};
     }
-
-    recvMessage.resize(bytesReceived);
-    return std::string(recvMessage.begin(), recvMessage.end());
+    return std::string_view(reinterpret_cast<const char*>(m_viewBuffer.get()), static_cast<size_t>(bytesReceived));
 }
 
-std::string TCPv4Connection::receive()
+size_t IConnection::acceptAll(std::vector<AcceptedSocket>& clients, size_t maxClients)
 {
-    std::vector<char> recvMessage;
-    recvMessage.resize(MAX_MESSAGE_LENGTH);
+    int socktype = SOCK_STREAM;
+    socklen_t length = sizeof(socktype);
+    getsockopt(m_socket, SOL_SOCKET, SO_TYPE, &socktype, &length);
 
-    int bytesReceived = ::recv(m_socket, recvMessage.data(), recvMessage.size(), 0);
-    if (bytesReceived < 0)
-    {
-        throw std::runtime_error("Error: failed to receive message");
-    }
-    else if (bytesReceived == 0)
+    size_t accepted = 0;
+    while (accepted < maxClients)
     {
-        throw std::runtime_error("Connection closed by peer receive");
+        // After the first client a blocking listener only takes the ones already in the backlog.
+        if (m_isBlocking && accepted > 0)
+        {
+            struct pollfd pollFd = {m_socket, POLLIN, 0};
+            if (::poll(&pollFd, 1, 0) <= 0)
+            {
+                break;
+            }
+        }
+
+        AcceptedSocket client {};
+        client.socket = acceptClient(m_socket, m_isBlocking, &client.peer);
+        if (client.socket == ERROR)
+        {
+            break;
+        }
+        client.peer.socktype = socktype;
+        clients.push_back(client);
+        ++accepted;
     }
+    return accepted;
+}
 
-    recvMessage.resize(bytesReceived);
-    return std::string(recvMessage.begin(), recvMessage.end());
+bool IConnection::changeOptions(const SocketOptions& options)
+{
+    options.apply(m_socket);
+    return true;
 }
 
-bool TCPv4Connection::changeOptions()
+void IConnection::setReusePort(bool enable)
 {
-    throw std::runtime_error("Not implemented.");
+    SocketOptions options;
+    options.reusePort = enable;
+    changeOptions(options);
 }
 
-int TCPv4Connection::getSocket()
+PooledBuffer IConnection::receivePooled(BufferPool& pool)
 {
-    return m_socket;
+    return receivePooledFrom(m_socket, pool);
 }
 
-TCPv6Connection::TCPv6Connection(const std::string& address, const std::string& port, bool isBlocking)
-    : IConnection(address, port, isBlocking)
+PooledBuffer IConnection::receivePooledFrom(int socket, BufferPool& pool)
 {
-    m_socket = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
-    if (m_socket < 0)
+    PooledBuffer buffer = pool.acquire();
+    ssize_t bytesReceived = receiveFrom(socket, std::span<std::byte>(buffer.data(), buffer.capacity()));
+    if (bytesReceived <= 0)
     {
-        throw std::runtime_error("Error creating socket");
+        return {};
     }
+    buffer.resize(static_cast<size_t>(bytesReceived));
+    return buffer;
+}
 
-    if (port.empty())
+template <typename Family>
+TCPConnection<Family>::TCPConnection(const std::string& address, const std::string& port, bool isBlocking)
+    : IConnection(address, port, isBlocking)
+    , m_stream(isBlocking)
+{
+    m_socket = m_stream.fd();
+    if (!isBlocking)
     {
-        socklen_t addr_len = sizeof(addrinfo6);
-        memset((char*)&addrinfo6, 0, addr_len);
-        addrinfo6.sin6_family = AF_INET6;
-        addrinfo6.sin6_port = htons(0); // 0 will automatically select an available port.
-        addrinfo6.sin6_addr = in6addr_any;
-        return;
+        m_writeQueue = std::make_unique<WriteQueue>(m_socket);
     }
 
-    struct addrinfo hints;
-    hints.ai_flags = 0;
-    hints.ai_family = AF_INET6; // IPv6
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-
-    if (address.empty())
+    if (port.empty())
     {
-        // for listening connections
-        hints.ai_flags = AI_PASSIVE; // ANY_ADDRESS
+        autoSelectPort = true;
+        return;
     }
 
-    int resultAddrInfo = getaddrinfo(address.empty() ? nullptr : address.c_str(), port.c_str(), &hints, &addrinfo);
+    // An empty address resolves to the wildcard address, for listening connections.
+    m_endpoint = Resolver::instance().resolve(address, port, Family::domain, SOCK_STREAM).front();
+}
 
-    if (resultAddrInfo != 0)
+template <typename Family>
+TCPConnection<Family>::TCPConnection(const ResolvedAddress& endpoint, bool isBlocking)
+    : IConnection(endpoint.host(), endpoint.port(), isBlocking)
+    , m_stream(isBlocking)
+{
+    m_endpoint = endpoint;
+    m_socket = m_stream.fd();
+    if (!isBlocking)
     {
-        throw std::runtime_error(gai_strerror(resultAddrInfo));
+        m_writeQueue = std::make_unique<WriteQueue>(m_socket);
     }
 }
 
-TCPv6Connection::~TCPv6Connection()
+template <typename Family>
+TCPConnection<Family>::TCPConnection(Socket<Tcp, Family>&& stream, const ResolvedAddress& endpoint)
+    : IConnection(endpoint.host(), endpoint.port(), stream.isBlocking())
+    , m_stream(std::move(stream))
+    , connected(true)
 {
-    close(m_socket);
-    if (addrinfo != NULL)
+    m_endpoint = endpoint;
+    m_socket = m_stream.fd();
+    if (!m_isBlocking)
     {
-        freeaddrinfo(addrinfo);
+        m_writeQueue = std::make_unique<WriteQueue>(m_socket);
     }
 }
 
-bool TCPv6Connection::bind()
+template <typename Family>
+bool TCPConnection<Family>::bind()
 {
-    if (addrinfo != nullptr)
+    if (autoSelectPort)
     {
-        if (::bind(m_socket, addrinfo->ai_addr, addrinfo->ai_addrlen) < 0)
-        {
-            throw std::runtime_error("Error: cannot bind socket");
-        }
-        m_port = std::to_string(ntohs(((struct sockaddr_in6*)addrinfo)->sin6_port));
+        m_stream.bindAny(); // Port 0 lets the kernel pick an available one.
+        m_port = std::to_string(m_stream.localPort());
     }
     else
     {
-        socklen_t addr_len = sizeof(addrinfo6);
-        if (::bind(m_socket, (struct sockaddr*)&addrinfo6, addr_len) < 0)
-        {
-            throw std::runtime_error("Error: cannot bind socket");
-        }
-        ::getsockname(m_socket, (struct sockaddr*)&addrinfo6, &addr_len);
-        m_port = std::to_string(ntohs(addrinfo6.sin6_port));
+        m_stream.bind(m_endpoint);
+        m_port = m_endpoint.port();
     }
 
-    int resultListen = ::listen(m_socket, TCP_BACKLOG); // Listen for incoming connections.
-    if (resultListen < 0)
-    {
-        throw std::runtime_error("Error: cannot listen on socket");
-    }
+    m_stream.listen();
     binded = true;
 
     return true;
 }
 
-int TCPv6Connection::connect()
+template <typename Family>
+int TCPConnection<Family>::connect()
 {
     if (binded)
     {
-        int clientFd = ::accept(m_socket, NULL, NULL);
-        if (clientFd < 0)
-        {
-            throw std::runtime_error("Error: cannot accept connection");
-        }
-        return clientFd;
+        // for server accept new connection
+        return acceptClient(m_socket, m_isBlocking);
     }
 
-    if (::connect(m_socket, addrinfo->ai_addr, addrinfo->ai_addrlen) == -1)
+    // connect client
+    if (!connected)
     {
-        throw std::runtime_error("Error: cannot connect");
+        m_stream.connect(m_endpoint, m_connectTimeout);
+        connected = true;
     }
+
     return true;
 }
 
-bool TCPv6Connection::send(const std::string& message)
+template <typename Family>
+bool TCPConnection<Family>::send(const std::string& message)
 {
-    int numberBytes = ::send(m_socket, message.c_str(), message.size(), 0);
-    if (numberBytes < 0)
-    {
-        throw std::runtime_error("Error: message sending failure");
-    }
-    return true;
+    std::string_view part = message;
+    return IConnection::send(std::span<const std::string_view>(&part, 1));
 }
 
-bool TCPv6Connection::sendto(const std::string& message, int fdDestiny)
+template <typename Family>
+bool TCPConnection<Family>::sendto(const std::string& message, int fdDestiny)
 {
-    int numberBytes = ::send(fdDestiny, message.c_str(), message.size(), 0); // contesta al cliente mediante el mismo fd
-    if (numberBytes < 0)
-    {
-        throw std::runtime_error("Error: message sending failure");
-    }
-    return true;
+    std::string_view part = message;
+    return sendParts(fdDestiny, std::span<const std::string_view>(&part, 1), m_metrics.get());
 }
 
-std::string TCPv6Connection::receiveFrom(int socket)
+template <typename Family>
+size_t TCPConnection<Family>::sendFile(int fd, off_t offset, size_t length)
 {
-    std::vector<char> recvMessage;
-    recvMessage.resize(MAX_MESSAGE_LENGTH);
-
-    int bytesReceived = ::recv(socket, recvMessage.data(), recvMessage.size(), 0);
-    if (bytesReceived < 0)
-    {
-        throw std::runtime_error("Error: failed to receive message");
-    }
-    else if (bytesReceived == 0)
+    if (m_writeQueue)
     {
-        throw std::runtime_error("Connection closed by peer");
+        m_writeQueue->flush();
+        if (m_writeQueue->pending() > 0)
+        {
+            return 0;
+        }
     }
-
-    recvMessage.resize(bytesReceived);
-    return std::string(recvMessage.begin(), recvMessage.end());
+    return sendFileBytes(m_socket, fd, offset, length, m_metrics.get());
 }
 
-std::string TCPv6Connection::receive()
+template <typename Family>
+size_t TCPConnection<Family>::sendFileTo(int fdDestiny, int fd, off_t offset, size_t length)
 {
-    std::vector<char> recvMessage;
-    recvMessage.resize(MAX_MESSAGE_LENGTH);
-
-    int bytesReceived = ::recv(m_socket, recvMessage.data(), recvMessage.size(), 0);
-    if (bytesReceived < 0)
-    {
-        throw std::runtime_error("Error: failed to receive message");
-    }
-    else if (bytesReceived == 0)
-    {
-        throw std::runtime_error("Connection closed by peer");
-    }
+    return sendFileBytes(fdDestiny, fd, offset, length, m_metrics.get());
+}
 
-    recvMessage.resize(bytesReceived);
-    return std::string(recvMessage.begin(), recvMessage.end());
+template <typename Family>
+std::string TCPConnection<Family>::receiveFrom(int socket)
+{
+    return receiveMessage(socket, "Connection closed by peer receiveFrom", m_metrics.get());
 }
 
-bool TCPv6Connection::changeOptions()
+template <typename Family>
+std::string TCPConnection<Family>::receive()
 {
-    throw std::runtime_error("Not implemented.");
+    return receiveMessage(m_socket, "Connection closed by peer receive", m_metrics.get());
 }
 
-int TCPv6Connection::getSocket()
+template <typename Family>
+int TCPConnection<Family>::getSocket()
 {
     return m_socket;
 }
 
+template class TCPConnection<IPv4>;
+template class TCPConnection<IPv6>;
+
 UDPConnection::UDPConnection(const std::string& address, const std::string& port, bool isBlocking, bool IPv6)
     : IConnection(address, port, isBlocking)
 {
@@ -385,53 +883,59 @@ UDPConnection::UDPConnection(const std::string& address, const std::string& port
         autoSelectPort = true;
         if (IPv6)
         {
-            memset((char*)&address, 0, sizeof(address));
+            memset((char*)&address6, 0, sizeof(address6));
             address6.sin6_family = AF_INET6;
             address6.sin6_port = htons(0);
             address6.sin6_addr = in6addr_any;
         }
         else
         {
-            memset((char*)&address, 0, sizeof(address));
+            memset((char*)&address4, 0, sizeof(address4));
             address4.sin_family = AF_INET;
             address4.sin_port = htons(0);
             address4.sin_addr.s_addr = INADDR_ANY;
         }
     }
     m_port = port;
-
-    struct addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-
-    if (IPv6)
+    if (autoSelectPort)
     {
-        hints.ai_family = AF_INET6;
+        return;
     }
-    else
+
+    try
     {
-        hints.ai_family = AF_INET;
+        // An empty address resolves to the wildcard address, for listening connections.
+        m_endpoint = Resolver::instance().resolve(address, port, IPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM).front();
     }
-    hints.ai_socktype = SOCK_DGRAM;
-    hints.ai_protocol = 0;
-
-    if (address.empty())
+    catch (const std::exception& error)
     {
-        hints.ai_flags = AI_PASSIVE;
+        ::close(m_socket);
+        throw std::runtime_error(std::string("Error getting address: ") + error.what());
     }
+}
 
-    addrinfo* rawAddrinfo = nullptr; // Raw pointer to store the result of getaddrinfo
+UDPConnection::UDPConnection(const ResolvedAddress& endpoint, bool isBlocking)
+    : IConnection(endpoint.host(), endpoint.port(), isBlocking)
+{
+    m_endpoint = endpoint;
+    isIPv6 = endpoint.family == AF_INET6;
+    m_socket = socket(endpoint.family, SOCK_DGRAM, IPPROTO_UDP);
 
-    const auto resultAddrInfo =
-        getaddrinfo(address.empty() ? nullptr : address.c_str(), port.c_str(), &hints, &rawAddrinfo);
-    if (resultAddrInfo != 0)
+    if (m_socket < 0)
     {
-        throw std::runtime_error("Error getting address");
+        throw std::runtime_error("Error creating socket");
+    }
+    if (!isBlocking)
+    {
+        int flags = fcntl(m_socket, F_GETFL, 0);
+        fcntl(m_socket, F_SETFL, flags | O_NONBLOCK);
     }
-
-    m_addrinfo = std::unique_ptr<addrinfo>(rawAddrinfo); // Wrap raw pointer in the smart pointer
 }
 
-UDPConnection::~UDPConnection() {}
+UDPConnection::~UDPConnection()
+{
+    ::close(m_socket);
+}
 
 int UDPConnection::getSocket()
 {
@@ -444,7 +948,7 @@ bool UDPConnection::bind()
 
     if (!autoSelectPort)
     {
-        if (::bind(m_socket, m_addrinfo->ai_addr, m_addrinfo->ai_addrlen) < 0)
+        if (::bind(m_socket, m_endpoint.data(), m_endpoint.length) < 0)
         {
             throw std::runtime_error("Error binding socket to address: ");
         }
@@ -474,7 +978,7 @@ bool UDPConnection::bind()
 int UDPConnection::connect()
 {
     // Connect socket to address
-    if (::connect(m_socket, m_addrinfo->ai_addr, m_addrinfo->ai_addrlen) < 0)
+    if (::connect(m_socket, m_endpoint.data(), m_endpoint.length) < 0)
     {
         throw std::runtime_error("Error in conection");
     }
@@ -484,70 +988,1149 @@ int UDPConnection::connect()
 
 bool UDPConnection::send(const std::string& message)
 {
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->sendLatency : nullptr);
     ssize_t sentBytes = ::send(m_socket, message.c_str(), message.size(), 0);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
     if (sentBytes == ERROR)
     {
+        ConnectionMetrics::add(m_metrics.get(),
+                               errno == EAGAIN || errno == EWOULDBLOCK ? &ConnectionMetrics::wouldBlock
+                                                                       : &ConnectionMetrics::errors);
         std::cout << "Error sending data: " << strerror(errno) << std::endl;
         return false;
     }
     else if (static_cast<size_t>(sentBytes) != message.size())
     {
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::partialWrites);
         std::cout << "Incomplete data sent" << std::endl;
         return false;
     }
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesSent);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesSent, static_cast<uint64_t>(sentBytes));
     return true;
 }
 
 std::string UDPConnection::receive()
 {
-    std::vector<char> recvMessage;
-
-    recvMessage.reserve(MAX_MESSAGE_LENGTH);
+    thread_local std::vector<char> recvMessage(MAX_MESSAGE_LENGTH);
 
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->receiveLatency : nullptr);
     int bytesReceived = ::recv(m_socket, recvMessage.data(), recvMessage.size(), 0);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
 
     if (bytesReceived < 0)
     {
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
         const auto errorMessage = std::string("Error receiving data: ") + strerror(errno);
         throw std::runtime_error(errorMessage);
     }
-    recvMessage.resize(bytesReceived);
 
-    return std::string(recvMessage.begin(), recvMessage.end());
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesReceived);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesReceived, static_cast<uint64_t>(bytesReceived));
+    return std::string(recvMessage.data(), static_cast<size_t>(bytesReceived));
 }
-bool UDPConnection::changeOptions()
+
+DatagramBatch::DatagramBatch(size_t capacity, size_t datagramSize)
+    : m_count(0)
+    , m_datagramSize(datagramSize)
+    , m_arena(capacity * datagramSize)
+    , m_iov(capacity)
+    , m_sources(capacity)
+    , m_headers(capacity)
 {
-    throw std::runtime_error("Not implemented");
+    if (capacity == 0 || datagramSize == 0)
+    {
+        throw std::invalid_argument("Error: empty datagram batch");
+    }
+
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        m_iov[i].iov_base = m_arena.data() + i * datagramSize;
+        m_iov[i].iov_len = datagramSize;
+        memset(&m_headers[i], 0, sizeof(m_headers[i]));
+        m_headers[i].msg_hdr.msg_iov = &m_iov[i];
+        m_headers[i].msg_hdr.msg_iovlen = 1;
+        m_headers[i].msg_hdr.msg_name = &m_sources[i];
+    }
 }
 
-std::unique_ptr<IConnection>
-createConnection(const std::string& address, const std::string& port, bool isBlocking, int protocolMacro)
+DatagramBatch::DatagramBatch(DatagramBatch&& other) noexcept
+    : m_count(std::exchange(other.m_count, 0))
+    , m_datagramSize(other.m_datagramSize)
+    , m_arena(std::move(other.m_arena))
+    , m_iov(std::move(other.m_iov))
+    , m_sources(std::move(other.m_sources))
+    , m_headers(std::move(other.m_headers))
 {
-    Protocol protocol;
+}
 
-    // Determinar si la dirección es IPv4 o IPv6
-    bool isIPv6 = address.find(':') != std::string::npos;
+DatagramBatch& DatagramBatch::operator=(DatagramBatch&& other) noexcept
+{
+    m_count = std::exchange(other.m_count, 0);
+    m_datagramSize = other.m_datagramSize;
+    m_arena = std::move(other.m_arena);
+    m_iov = std::move(other.m_iov);
+    m_sources = std::move(other.m_sources);
+    m_headers = std::move(other.m_headers);
+    return *this;
+}
 
-    // Determinar el protocolo basándose en el macro
-    if (protocolMacro == TCP)
-    {
-        protocol = isIPv6 ? Protocol::TCPv6 : Protocol::TCPv4;
-    }
-    else if (protocolMacro == UDP)
+DatagramBatch::Datagram DatagramBatch::operator[](size_t index) const
+{
+    if (index >= m_count)
     {
-        protocol = isIPv6 ? Protocol::UDPv6 : Protocol::UDPv4;
+        throw std::out_of_range("Error: datagram index out of range");
+    }
+
+    const struct msghdr& header = m_headers[index].msg_hdr;
+    size_t length = std::min<size_t>(m_headers[index].msg_len, m_datagramSize);
+    return Datagram {std::string_view(m_arena.data() + index * m_datagramSize, length),
+                     m_sources[index],
+                     (header.msg_flags & MSG_TRUNC) != 0};
+}
+
+std::string DatagramBatch::Datagram::sourceAddress() const
+{
+    char text[INET6_ADDRSTRLEN] = {};
+    if (source.ss_family == AF_INET6)
+    {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6&>(source).sin6_addr, text, sizeof(text));
+    }
+    else
+    {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in&>(source).sin_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+std::string DatagramBatch::Datagram::sourcePort() const
+{
+    if (source.ss_family == AF_INET6)
+    {
+        return std::to_string(ntohs(reinterpret_cast<const struct sockaddr_in6&>(source).sin6_port));
+    }
+    return std::to_string(ntohs(reinterpret_cast<const struct sockaddr_in&>(source).sin_port));
+}
+
+size_t UDPConnection::receiveBatch(DatagramBatch& batch)
+{
+    // The name length is an in/out field and has to be reset before every call.
+    for (struct mmsghdr& header : batch.m_headers)
+    {
+        header.msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        header.msg_hdr.msg_flags = 0;
+    }
+
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->receiveLatency : nullptr);
+    int received;
+    do
+    {
+        received = ::recvmmsg(m_socket,
+                              batch.m_headers.data(),
+                              static_cast<unsigned>(batch.m_headers.size()),
+                              MSG_WAITFORONE,
+                              nullptr);
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
+    } while (received < 0 && errno == EINTR);
+
+    if (received < 0)
+    {
+        batch.m_count = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+            return 0;
+        }
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
+        const auto errorMessage = std::string("Error receiving data: ") + strerror(errno);
+        throw std::runtime_error(errorMessage);
+    }
+
+    batch.m_count = static_cast<size_t>(received);
+    if (m_metrics)
+    {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < batch.m_count; ++i)
+        {
+            bytes += batch.m_headers[i].msg_len;
+        }
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesReceived, batch.m_count);
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesReceived, bytes);
+    }
+    return batch.m_count;
+}
+
+bool UDPConnection::sendSegmented(std::string_view buffer, uint16_t segmentSize)
+{
+    if (segmentSize == 0 || buffer.size() > UDP_MAX_PAYLOAD ||
+        (buffer.size() + segmentSize - 1) / segmentSize > UDP_MAX_SEGMENTS)
+    {
+        throw std::invalid_argument("Error: invalid segmentation request");
+    }
+
+    struct iovec iov = {const_cast<char*>(buffer.data()), buffer.size()};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->sendLatency : nullptr);
+    ssize_t sentBytes;
+    do
+    {
+        sentBytes = ::sendmsg(m_socket, &msg, 0);
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
+    } while (sentBytes < 0 && errno == EINTR);
+
+    if (sentBytes < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+            return false;
+        }
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
+        throw std::runtime_error(std::string("Error sending data: ") + strerror(errno));
+    }
+    ConnectionMetrics::add(m_metrics.get(),
+                           &ConnectionMetrics::messagesSent,
+                           (buffer.size() + segmentSize - 1) / segmentSize);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesSent, static_cast<uint64_t>(sentBytes));
+    return true;
+}
+
+void UDPConnection::enableReceiveOffload(bool enable)
+{
+    int value = enable ? 1 : 0;
+    if (setsockopt(m_socket, SOL_UDP, UDP_GRO, &value, sizeof(value)) < 0)
+    {
+        throw std::runtime_error(std::string("Error: cannot set UDP_GRO: ") + strerror(errno));
+    }
+}
+
+CoalescedDatagrams UDPConnection::receiveCoalesced(std::span<std::byte> buffer)
+{
+    struct iovec iov = {buffer.data(), buffer.size()};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->receiveLatency : nullptr);
+    ssize_t bytesReceived;
+    do
+    {
+        bytesReceived = ::recvmsg(m_socket, &msg, 0);
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
+    } while (bytesReceived < 0 && errno == EINTR);
+
+    if (bytesReceived < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+            return {};
+        }
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
+        throw std::runtime_error(std::string("Error receiving data: ") + strerror(errno));
+    }
+
+    size_t segmentSize = static_cast<size_t>(bytesReceived);
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            int gsoSize;
+            memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof(gsoSize));
+            segmentSize = static_cast<size_t>(gsoSize);
+        }
+    }
+
+    ConnectionMetrics::add(m_metrics.get(),
+                           &ConnectionMetrics::messagesReceived,
+                           segmentSize > 0 ? (static_cast<size_t>(bytesReceived) + segmentSize - 1) / segmentSize : 0);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesReceived, static_cast<uint64_t>(bytesReceived));
+    return CoalescedDatagrams {
+        std::string_view(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(bytesReceived)),
+        segmentSize};
+}
+
+size_t UDPConnection::sendBatch(std::span<const std::string_view> datagrams)
+{
+    return sendBatchImpl(datagrams, nullptr);
+}
+
+size_t UDPConnection::sendBatchTo(std::span<const std::string_view> datagrams, const DatagramBatch& destinations)
+{
+    if (datagrams.size() > destinations.size())
+    {
+        throw std::invalid_argument("Error: more datagrams than destinations");
+    }
+    return sendBatchImpl(datagrams, &destinations);
+}
+
+size_t UDPConnection::sendBatchImpl(std::span<const std::string_view> datagrams, const DatagramBatch* destinations)
+{
+    std::array<struct mmsghdr, UDP_SEND_BATCH> headers;
+    std::array<struct iovec, UDP_SEND_BATCH> iov;
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->sendLatency : nullptr);
+
+    size_t sent = 0;
+    while (sent < datagrams.size())
+    {
+        size_t count = std::min<size_t>(datagrams.size() - sent, UDP_SEND_BATCH);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::string_view& datagram = datagrams[sent + i];
+            iov[i] = {const_cast<char*>(datagram.data()), datagram.size()};
+            memset(&headers[i], 0, sizeof(headers[i]));
+            headers[i].msg_hdr.msg_iov = &iov[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+            if (destinations != nullptr)
+            {
+                const struct sockaddr_storage& destination = destinations->m_sources[sent + i];
+                headers[i].msg_hdr.msg_name = const_cast<struct sockaddr_storage*>(&destination);
+                headers[i].msg_hdr.msg_namelen = destinations->m_headers[sent + i].msg_hdr.msg_namelen;
+            }
+        }
+
+        int result = ::sendmmsg(m_socket, headers.data(), static_cast<unsigned>(count), 0);
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::syscalls);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+                break;
+            }
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
+            throw std::runtime_error(std::string("Error sending data: ") + strerror(errno));
+        }
+
+        if (m_metrics)
+        {
+            uint64_t bytes = 0;
+            for (int i = 0; i < result; ++i)
+            {
+                bytes += headers[i].msg_len;
+            }
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesSent, static_cast<uint64_t>(result));
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesSent, bytes);
+        }
+        sent += static_cast<size_t>(result);
+        if (static_cast<size_t>(result) < count)
+        {
+            // The kernel stops at the first datagram it cannot queue.
+            break;
+        }
+    }
+
+    return sent;
+}
+
+UnixConnection::UnixConnection(const std::string& path, bool isBlocking, bool seqPacket)
+    : IConnection(path, "", isBlocking)
+{
+    m_endpoint = makeEndpoint(path, seqPacket ? SOCK_SEQPACKET : SOCK_STREAM);
+    open(isBlocking);
+}
+
+UnixConnection::UnixConnection(const ResolvedAddress& endpoint, bool isBlocking)
+    : IConnection(endpoint.host(), "", isBlocking)
+{
+    if (endpoint.family != AF_UNIX || (endpoint.socktype != SOCK_STREAM && endpoint.socktype != SOCK_SEQPACKET))
+    {
+        throw std::invalid_argument("Error: not a Unix domain stream or sequenced-packet address");
+    }
+    m_endpoint = endpoint;
+    open(isBlocking);
+}
+
+UnixConnection::~UnixConnection()
+{
+    ::close(m_socket);
+    if (binded && !m_address.empty() && m_address[0] != '@')
+    {
+        ::unlink(m_address.c_str());
+    }
+}
+
+void UnixConnection::open(bool isBlocking)
+{
+    m_socket = socket(AF_UNIX, m_endpoint.socktype, 0);
+
+    if (m_socket < 0)
+    {
+        throw std::runtime_error("Error creating socket");
+    }
+    if (!isBlocking)
+    {
+        setNonBlocking(m_socket);
+        // Queued chunks are gathered into one write, which would merge the messages of a SOCK_SEQPACKET.
+        if (m_endpoint.socktype == SOCK_STREAM)
+        {
+            m_writeQueue = std::make_unique<WriteQueue>(m_socket);
+        }
+    }
+}
+
+ResolvedAddress UnixConnection::makeEndpoint(const std::string& path, int socketType)
+{
+    if (socketType != SOCK_STREAM && socketType != SOCK_SEQPACKET)
+    {
+        throw std::invalid_argument("Error: Unix domain sockets must be SOCK_STREAM or SOCK_SEQPACKET");
+    }
+
+    ResolvedAddress endpoint {};
+    auto* unixAddress = reinterpret_cast<struct sockaddr_un*>(&endpoint.address);
+    unixAddress->sun_family = AF_UNIX;
+    endpoint.family = AF_UNIX;
+    endpoint.socktype = socketType;
+    endpoint.protocol = 0;
+    endpoint.length = offsetof(struct sockaddr_un, sun_path);
+    if (path.empty())
+    {
+        // An address made of the family alone asks bind() for a free abstract name.
+        return endpoint;
+    }
+
+    // Abstract names start with a null byte instead of '@' and are not null-terminated.
+    const bool isAbstract = path[0] == '@';
+    const size_t pathLength = path.size() + (isAbstract ? 0 : 1);
+    if (pathLength > sizeof(unixAddress->sun_path))
+    {
+        throw std::invalid_argument("Error: Unix domain socket path too long");
+    }
+    memcpy(unixAddress->sun_path, path.data(), path.size());
+    if (isAbstract)
+    {
+        unixAddress->sun_path[0] = '\0';
+    }
+    endpoint.length += static_cast<socklen_t>(pathLength);
+    return endpoint;
+}
+
+bool UnixConnection::bind()
+{
+    if (::bind(m_socket, m_endpoint.data(), m_endpoint.length) < 0)
+    {
+        if (errno != EADDRINUSE || !isStaleSocketFile(m_endpoint) || ::unlink(m_address.c_str()) < 0 ||
+            ::bind(m_socket, m_endpoint.data(), m_endpoint.length) < 0)
+        {
+            throw std::runtime_error("Error: cannot bind socket");
+        }
+    }
+    if (m_address.empty())
+    {
+        m_endpoint.length = sizeof(m_endpoint.address);
+        ::getsockname(m_socket, reinterpret_cast<struct sockaddr*>(&m_endpoint.address), &m_endpoint.length);
+        m_address = m_endpoint.host();
+    }
+
+    if (::listen(m_socket, TCP_BACKLOG) < 0)
+    {
+        throw std::runtime_error("Error: cannot listen on socket");
+    }
+
+    binded = true;
+
+    return true;
+}
+
+int UnixConnection::connect()
+{
+    if (binded)
+    {
+        return acceptClient(m_socket, m_isBlocking);
+    }
+
+    connectSocket(m_socket, m_endpoint, m_connectTimeout);
+
+    return true;
+}
+
+bool UnixConnection::send(const std::string& message)
+{
+    std::string_view part = message;
+    return IConnection::send(std::span<const std::string_view>(&part, 1));
+}
+
+bool UnixConnection::sendto(const std::string& message, int fdDestiny)
+{
+    std::string_view part = message;
+    return sendParts(fdDestiny, std::span<const std::string_view>(&part, 1), m_metrics.get());
+}
+
+bool UnixConnection::sendFds(std::string_view message, std::span<const int> fds)
+{
+    if (m_writeQueue)
+    {
+        m_writeQueue->flush();
+        if (m_writeQueue->pending() > 0)
+        {
+            return false;
+        }
+    }
+    return sendWithFds(m_socket, message, fds, m_metrics.get());
+}
+
+bool UnixConnection::sendFdsTo(int fdDestiny, std::string_view message, std::span<const int> fds)
+{
+    return sendWithFds(fdDestiny, message, fds, m_metrics.get());
+}
+
+ssize_t UnixConnection::receiveFds(std::span<std::byte> buffer, std::vector<int>& fds)
+{
+    return receiveWithFds(m_socket, buffer, fds, m_metrics.get());
+}
+
+ssize_t UnixConnection::receiveFdsFrom(int socket, std::span<std::byte> buffer, std::vector<int>& fds)
+{
+    return receiveWithFds(socket, buffer, fds, m_metrics.get());
+}
+
+std::string UnixConnection::receiveFrom(int socket)
+{
+    return receiveMessage(socket, "Connection closed by peer receiveFrom", m_metrics.get());
+}
+
+std::string UnixConnection::receive()
+{
+    return receiveMessage(m_socket, "Connection closed by peer receive", m_metrics.get());
+}
+
+int UnixConnection::getSocket()
+{
+    return m_socket;
+}
+
+std::unique_ptr<IConnection> createConnection(const std::string& address,
+                                              const std::string& port,
+                                              bool isBlocking,
+                                              int protocolMacro,
+                                              const SocketOptions& options)
+{
+    Protocol protocol;
+
+    // Determinar si la dirección es IPv4 o IPv6
+    bool isIPv6 = address.find(':') != std::string::npos;
+
+    // Determinar el protocolo basándose en el macro
+    if (protocolMacro == TCP)
+    {
+        protocol = isIPv6 ? Protocol::TCPv6 : Protocol::TCPv4;
+    }
+    else if (protocolMacro == UDP)
+    {
+        protocol = isIPv6 ? Protocol::UDPv6 : Protocol::UDPv4;
+    }
+    else if (protocolMacro == UNIX_STREAM)
+    {
+        protocol = Protocol::UnixStream;
+    }
+    else if (protocolMacro == UNIX_SEQPACKET)
+    {
+        protocol = Protocol::UnixSeqPacket;
     }
     else
     {
         throw std::invalid_argument("Unsupported protocol macro");
     }
 
+    std::unique_ptr<IConnection> connection;
     switch (protocol)
     {
-        case Protocol::TCPv4: return std::make_unique<TCPv4Connection>(address, port, isBlocking); break;
-        case Protocol::TCPv6: return std::make_unique<TCPv6Connection>(address, port, isBlocking); break;
-        case Protocol::UDPv4: return std::make_unique<UDPConnection>(address, port, isBlocking, false); break;
-        case Protocol::UDPv6: return std::make_unique<UDPConnection>(address, port, isBlocking, true); break;
+        case Protocol::TCPv4: connection = std::make_unique<TCPv4Connection>(address, port, isBlocking); break;
+        case Protocol::TCPv6: connection = std::make_unique<TCPv6Connection>(address, port, isBlocking); break;
+        case Protocol::UDPv4: connection = std::make_unique<UDPConnection>(address, port, isBlocking, false); break;
+        case Protocol::UDPv6: connection = std::make_unique<UDPConnection>(address, port, isBlocking, true); break;
+        case Protocol::UnixStream: connection = std::make_unique<UnixConnection>(address, isBlocking); break;
+        case Protocol::UnixSeqPacket: connection = std::make_unique<UnixConnection>(address, isBlocking, true); break;
         default: throw std::invalid_argument("Unsupported protocol");
     }
+    connection->changeOptions(options);
+    return connection;
+}
+
+std::unique_ptr<IConnection> createConnection(const ResolvedAddress& endpoint,
+                                              bool isBlocking,
+                                              int protocolMacro,
+                                              const SocketOptions& options)
+{
+    const bool isIPv6 = endpoint.family == AF_INET6;
+
+    std::unique_ptr<IConnection> connection;
+    if ((protocolMacro == UNIX_STREAM || protocolMacro == UNIX_SEQPACKET) && endpoint.family == AF_UNIX)
+    {
+        ResolvedAddress unixEndpoint = endpoint;
+        unixEndpoint.socktype = protocolMacro == UNIX_SEQPACKET ? SOCK_SEQPACKET : SOCK_STREAM;
+        connection = std::make_unique<UnixConnection>(unixEndpoint, isBlocking);
+    }
+    else if (protocolMacro == TCP && isIPv6)
+    {
+        connection = std::make_unique<TCPv6Connection>(endpoint, isBlocking);
+    }
+    else if (protocolMacro == TCP)
+    {
+        connection = std::make_unique<TCPv4Connection>(endpoint, isBlocking);
+    }
+    else if (protocolMacro == UDP)
+    {
+        connection = std::make_unique<UDPConnection>(endpoint, isBlocking);
+    }
+    else
+    {
+        throw std::invalid_argument("Unsupported protocol macro");
+    }
+    connection->changeOptions(options);
+    return connection;
+}
+
+EventLoop::EventLoop()
+    : m_stopRequested(false)
+    , m_nextGeneration(0)
+    , m_events(EPOLL_BATCH_SIZE)
+    , m_executor(nullptr)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+    {
+        throw std::runtime_error("Error creating epoll instance");
+    }
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+    {
+        ::close(m_epollFd);
+        throw std::runtime_error("Error creating eventfd");
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event) < 0)
+    {
+        ::close(m_wakeFd);
+        ::close(m_epollFd);
+        throw std::runtime_error("Error registering eventfd");
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    for (const auto& [fd, entry] : m_entries)
+    {
+        if (entry.owned)
+        {
+            ::close(fd);
+        }
+    }
+    ::close(m_wakeFd);
+    ::close(m_epollFd);
+}
+
+void EventLoop::registerEntry(int fd, Entry entry)
+{
+    if (m_entries.count(fd) != 0)
+    {
+        throw std::invalid_argument("Error: socket already registered");
+    }
+
+    entry.generation = ++m_nextGeneration;
+    if (m_executor != nullptr && !entry.listening)
+    {
+        entry.strand = std::make_shared<Strand>();
+        entry.strand->fd = fd;
+        entry.strand->handlers = entry.handlers;
+        entry.strand->events = 0;
+        entry.strand->scheduled = false;
+        entry.strand->closeOnIdle = false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = entry.listening ? (EPOLLIN | EPOLLET) : (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+    // The generation travels with the event so a stale event never reaches a reused descriptor.
+    event.data.u64 = (static_cast<uint64_t>(entry.generation) << 32) | static_cast<uint32_t>(fd);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        throw std::runtime_error(std::string("Error: cannot register socket in epoll: ") + strerror(errno));
+    }
+
+    m_entries.emplace(fd, std::move(entry));
+}
+
+void EventLoop::add(int fd, Handlers handlers)
+{
+    registerEntry(fd, Entry {std::move(handlers), {}, nullptr, 0, false, false, nullptr});
+}
+
+void EventLoop::remove(int fd)
+{
+    auto it = m_entries.find(fd);
+    if (it == m_entries.end())
+    {
+        return;
+    }
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    if (it->second.idleTimer != 0)
+    {
+        m_timers.cancel(it->second.idleTimer);
+    }
+    if (it->second.acceptTimer != 0)
+    {
+        m_timers.cancel(it->second.acceptTimer);
+    }
+    if (it->second.owned)
+    {
+        bool closeNow = true;
+        if (it->second.strand)
+        {
+            // A handler may still be using the socket in the pool; its task closes it when done.
+            std::lock_guard<std::mutex> lock(it->second.strand->mutex);
+            closeNow = !it->second.strand->scheduled;
+            it->second.strand->closeOnIdle = !closeNow;
+        }
+        if (closeNow)
+        {
+            ::close(fd);
+        }
+    }
+    m_entries.erase(it);
+}
+
+void EventLoop::listen(IConnection& listener, Handlers clientHandlers, Callback onAccept)
+{
+    AcceptCallback withPeer;
+    if (onAccept)
+    {
+        withPeer = [onAccept = std::move(onAccept)](int fd, const ResolvedAddress&) { onAccept(fd); };
+    }
+    listen(listener, std::move(clientHandlers), std::move(withPeer));
+}
+
+void EventLoop::listen(IConnection& listener, Handlers clientHandlers, AcceptCallback onAccept)
+{
+    int listenFd = listener.getSocket();
+
+    int flags = fcntl(listenFd, F_GETFL, 0);
+    fcntl(listenFd, F_SETFL, flags | O_NONBLOCK);
+
+    registerEntry(listenFd, Entry {{}, std::move(clientHandlers), std::move(onAccept), 0, false, true, nullptr});
+}
+
+void EventLoop::acceptConnections(int listenFd)
+{
+    const uint32_t generation = m_entries.at(listenFd).generation;
+
+    // Edge-triggered: drain the whole backlog, the listener will not be reported again until then.
+    while (isCurrent(listenFd, generation))
+    {
+        struct sockaddr_storage address {};
+        socklen_t length = sizeof(address);
+        int clientFd =
+            ::accept4(listenFd, reinterpret_cast<struct sockaddr*>(&address), &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return;
+            }
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO || errno == EPERM)
+            {
+                continue;
+            }
+            // Out of descriptors or memory: the backlog stays queued, but edge-triggered the listener
+            // is not reported again until another client connects, so retry after a pause.
+            retryAccept(listenFd, generation, std::string("Error: cannot accept connection: ") + strerror(errno));
+            return;
+        }
+
+        const Entry& listenEntry = m_entries.at(listenFd);
+        AcceptCallback onAccept = listenEntry.onAccept;
+        try
+        {
+            registerEntry(clientFd, Entry {listenEntry.clientHandlers, {}, nullptr, 0, true, false, nullptr});
+        }
+        catch (const std::exception& error)
+        {
+            ::close(clientFd);
+            if (m_onAcceptError)
+            {
+                m_onAcceptError(listenFd, error.what());
+            }
+            continue;
+        }
+
+        if (onAccept)
+        {
+            onAccept(clientFd, toResolvedAddress(address, length, SOCK_STREAM));
+        }
+    }
+}
+
+void EventLoop::retryAccept(int listenFd, uint32_t generation, const std::string& reason)
+{
+    Entry& entry = m_entries.at(listenFd);
+    if (entry.acceptTimer == 0)
+    {
+        entry.acceptTimer = m_timers.schedule(std::chrono::milliseconds(ACCEPT_RETRY_MS),
+                                              [this, listenFd, generation]
+                                              {
+                                                  if (isCurrent(listenFd, generation))
+                                                  {
+                                                      m_entries.at(listenFd).acceptTimer = 0;
+                                                      acceptConnections(listenFd);
+                                                  }
+                                              });
+    }
+    if (m_onAcceptError)
+    {
+        m_onAcceptError(listenFd, reason);
+    }
+}
+
+bool EventLoop::isCurrent(int fd, uint32_t generation) const
+{
+    auto it = m_entries.find(fd);
+    return it != m_entries.end() && it->second.generation == generation;
+}
+
+void EventLoop::dispatch(int fd, uint32_t generation, uint32_t events)
+{
+    if (!isCurrent(fd, generation))
+    {
+        return;
+    }
+
+    if (m_entries.at(fd).listening)
+    {
+        acceptConnections(fd);
+        return;
+    }
+
+    // Any activity pushes the idle deadline back.
+    Entry& entry = m_entries.at(fd);
+    if (entry.idleTimer != 0)
+    {
+        m_timers.reschedule(entry.idleTimer, entry.idleTimeout);
+    }
+
+    // A half-close only ends the input: the handler reads EOF and may still send its reply.
+    if ((events & EPOLLRDHUP) != 0)
+    {
+        events = (events & ~EPOLLRDHUP) | EPOLLIN;
+    }
+
+    if ((events & EPOLLERR) != 0 && (events & EPOLLHUP) == 0)
+    {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+        {
+            // Only the error queue has entries: a notification, not a failure of the socket.
+            events = (events & ~EPOLLERR) | EPOLL_ERROR_QUEUE;
+        }
+    }
+
+    if (m_entries.at(fd).strand)
+    {
+        schedule(fd, generation, events);
+        return;
+    }
+
+    // Callbacks are copied before being called because they may remove their own socket.
+    if ((events & EPOLLIN) != 0)
+    {
+        Callback onReadable = m_entries.at(fd).handlers.onReadable;
+        if (onReadable)
+        {
+            onReadable(fd);
+        }
+    }
+
+    if ((events & EPOLLOUT) != 0 && isCurrent(fd, generation))
+    {
+        Callback onWritable = m_entries.at(fd).handlers.onWritable;
+        if (onWritable)
+        {
+            onWritable(fd);
+        }
+    }
+
+    if ((events & EPOLL_ERROR_QUEUE) != 0 && isCurrent(fd, generation))
+    {
+        Callback onErrorQueue = m_entries.at(fd).handlers.onErrorQueue;
+        if (onErrorQueue)
+        {
+            onErrorQueue(fd);
+        }
+    }
+
+    if ((events & (EPOLLHUP | EPOLLERR)) != 0 && isCurrent(fd, generation))
+    {
+        Callback onClosed = m_entries.at(fd).handlers.onClosed;
+        if (onClosed)
+        {
+            onClosed(fd);
+        }
+        if (isCurrent(fd, generation))
+        {
+            remove(fd);
+        }
+    }
+}
+
+int EventLoop::runOnce(int timeoutMs)
+{
+    int ready = epoll_wait(m_epollFd, m_events.data(), static_cast<int>(m_events.size()), waitTimeout(timeoutMs));
+    if (ready < 0)
+    {
+        if (errno == EINTR)
+        {
+            return runTimers();
+        }
+        throw std::runtime_error("Error: epoll_wait failed");
+    }
+
+    int dispatched = 0;
+    for (int i = 0; i < ready; ++i)
+    {
+        const struct epoll_event& event = m_events[i];
+        if (event.data.fd == m_wakeFd && (event.data.u64 >> 32) == 0)
+        {
+            uint64_t value;
+            while (::read(m_wakeFd, &value, sizeof(value)) > 0)
+            {
+            }
+            runPosted();
+            continue;
+        }
+
+        int fd = static_cast<int>(event.data.u64 & 0xffffffff);
+        uint32_t generation = static_cast<uint32_t>(event.data.u64 >> 32);
+        dispatch(fd, generation, event.events);
+        ++dispatched;
+    }
+
+    return dispatched + runTimers();
+}
+
+uint64_t EventLoop::addTimer(std::chrono::milliseconds delay, Task task)
+{
+    return m_timers.schedule(delay, std::move(task));
+}
+
+bool EventLoop::cancelTimer(uint64_t id)
+{
+    return m_timers.cancel(id);
+}
+
+bool EventLoop::restartTimer(uint64_t id, std::chrono::milliseconds delay)
+{
+    return m_timers.reschedule(id, delay);
+}
+
+void EventLoop::setIdleTimeout(int fd, std::chrono::milliseconds timeout)
+{
+    auto it = m_entries.find(fd);
+    if (it == m_entries.end() || it->second.listening)
+    {
+        throw std::invalid_argument("Error: idle timeout on a socket that is not a registered connection");
+    }
+
+    Entry& entry = it->second;
+    if (timeout.count() <= 0)
+    {
+        m_timers.cancel(entry.idleTimer);
+        entry.idleTimer = 0;
+        return;
+    }
+
+    entry.idleTimeout = timeout;
+    if (entry.idleTimer != 0 && m_timers.reschedule(entry.idleTimer, timeout))
+    {
+        return;
+    }
+    const uint32_t generation = entry.generation;
+    entry.idleTimer = m_timers.schedule(timeout,
+                                        [this, fd, generation]
+                                        {
+                                            if (!isCurrent(fd, generation))
+                                            {
+                                                return;
+                                            }
+                                            // Reported like a hang-up: onClosed runs, then the socket is removed.
+                                            m_entries.at(fd).idleTimer = 0;
+                                            dispatch(fd, generation, EPOLLHUP);
+                                        });
+}
+
+int EventLoop::waitTimeout(int timeoutMs) const
+{
+    const int untilTimer = m_timers.timeoutMs();
+    if (untilTimer < 0)
+    {
+        return timeoutMs;
+    }
+    return timeoutMs < 0 ? untilTimer : std::min(timeoutMs, untilTimer);
+}
+
+int EventLoop::runTimers()
+{
+    return static_cast<int>(m_timers.advance());
+}
+
+void EventLoop::schedule(int fd, uint32_t generation, uint32_t events)
+{
+    std::shared_ptr<Strand> strand = m_entries.at(fd).strand;
+    if ((events & (EPOLLHUP | EPOLLERR)) != 0)
+    {
+        // No further events: the task reports the closure and posts the removal back to the loop.
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    bool submit;
+    {
+        std::lock_guard<std::mutex> lock(strand->mutex);
+        strand->events |= events;
+        submit = !strand->scheduled;
+        strand->scheduled = true;
+    }
+
+    if (submit)
+    {
+        m_executor->submit([this, strand, generation] { runStrand(strand, generation); });
+    }
+}
+
+void EventLoop::runStrand(const std::shared_ptr<Strand>& strand, uint32_t generation)
+{
+    const int fd = strand->fd;
+    std::exception_ptr error;
+    while (true)
+    {
+        uint32_t events;
+        {
+            std::lock_guard<std::mutex> lock(strand->mutex);
+            events = strand->events;
+            strand->events = 0;
+            if (events == 0)
+            {
+                strand->scheduled = false;
+                if (strand->closeOnIdle)
+                {
+                    ::close(fd);
+                }
+                break;
+            }
+        }
+
+        // A throwing handler drops its connection; the exception goes on to the pool once the strand is idle.
+        bool failed = false;
+        try
+        {
+            if ((events & EPOLLIN) != 0 && strand->handlers.onReadable)
+            {
+                strand->handlers.onReadable(fd);
+            }
+            if ((events & EPOLLOUT) != 0 && strand->handlers.onWritable)
+            {
+                strand->handlers.onWritable(fd);
+            }
+            if ((events & EPOLL_ERROR_QUEUE) != 0 && strand->handlers.onErrorQueue)
+            {
+                strand->handlers.onErrorQueue(fd);
+            }
+            if ((events & (EPOLLHUP | EPOLLERR)) != 0 && strand->handlers.onClosed)
+            {
+                strand->handlers.onClosed(fd);
+            }
+        }
+        catch (...)
+        {
+            error = error ? error : std::current_exception();
+            failed = true;
+        }
+        if (failed || (events & (EPOLLHUP | EPOLLERR)) != 0)
+        {
+            post(
+                [this, fd, generation]
+                {
+                    if (isCurrent(fd, generation))
+                    {
+                        remove(fd);
+                    }
+                });
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void EventLoop::post(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_postMutex);
+        m_posted.push_back(std::move(task));
+    }
+    uint64_t value = 1;
+    if (::write(m_wakeFd, &value, sizeof(value)) < 0)
+    {
+        // The counter is already non-zero, the loop will wake up anyway.
+    }
+}
+
+void EventLoop::runPosted()
+{
+    std::vector<Task> posted;
+    {
+        std::lock_guard<std::mutex> lock(m_postMutex);
+        posted.swap(m_posted);
+    }
+    for (Task& task : posted)
+    {
+        task();
+    }
+}
+
+void EventLoop::run()
+{
+    while (!m_stopRequested)
+    {
+        runOnce(-1);
+    }
+    m_stopRequested = false;
+}
+
+void EventLoop::stop()
+{
+    m_stopRequested = true;
+    uint64_t value = 1;
+    if (::write(m_wakeFd, &value, sizeof(value)) < 0)
+    {
+        // The counter is already non-zero, the loop will wake up anyway.
+    }
 }
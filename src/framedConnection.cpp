@@ -0,0 +1,204 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "framedConnection.hpp"
+
+#include <array>
+
+FramedConnection::FramedConnection(IConnection& connection, FramePrefix prefix, int socket, size_t maxFrameSize)
+    : m_connection(connection)
+    , m_prefix(prefix)
+    , m_socket(socket)
+    , m_maxFrameSize(maxFrameSize)
+    , m_begin(0)
+    , m_end(0)
+    , m_closed(false)
+{
+    if (prefix == FramePrefix::FixedU32 && maxFrameSize > UINT32_MAX)
+    {
+        throw std::invalid_argument("Error: frame size does not fit a 32-bit prefix");
+    }
+}
+
+size_t FramedConnection::encodePrefix(FramePrefix prefix, uint64_t length, uint8_t* out)
+{
+    if (prefix == FramePrefix::FixedU32)
+    {
+        if (length > UINT32_MAX)
+        {
+            throw std::invalid_argument("Error: frame too large for a 32-bit prefix");
+        }
+        out[0] = static_cast<uint8_t>(length >> 24);
+        out[1] = static_cast<uint8_t>(length >> 16);
+        out[2] = static_cast<uint8_t>(length >> 8);
+        out[3] = static_cast<uint8_t>(length);
+        return 4;
+    }
+
+    size_t size = 0;
+    do
+    {
+        uint8_t byte = length & 0x7f;
+        length >>= 7;
+        out[size++] = length != 0 ? (byte | 0x80) : byte;
+    } while (length != 0);
+    return size;
+}
+
+bool FramedConnection::sendFrame(std::string_view payload)
+{
+    if (payload.size() > m_maxFrameSize)
+    {
+        throw std::invalid_argument("Error: frame exceeds maximum size");
+    }
+
+    uint8_t prefix[FRAME_MAX_PREFIX];
+    size_t prefixSize = encodePrefix(m_prefix, payload.size(), prefix);
+
+    std::array<std::string_view, 2> parts = {std::string_view(reinterpret_cast<const char*>(prefix), prefixSize),
+                                             payload};
+    return m_socket < 0 ? m_connection.send(parts) : m_connection.sendto(parts, m_socket);
+}
+
+std::optional<std::string_view> FramedConnection::receiveFrame()
+{
+    while (true)
+    {
+        if (auto frame = parseFrame())
+        {
+            return frame;
+        }
+        if (!fill())
+        {
+            return std::nullopt;
+        }
+    }
+}
+
+std::optional<std::string_view> FramedConnection::nextFrame()
+{
+    return parseFrame();
+}
+
+void FramedConnection::feed(std::string_view bytes)
+{
+    reserve(m_end - m_begin + bytes.size());
+    memcpy(m_buffer.data() + m_end, bytes.data(), bytes.size());
+    m_end += bytes.size();
+}
+
+void FramedConnection::reserve(size_t bytes)
+{
+    if (m_buffer.size() - m_begin >= bytes)
+    {
+        return;
+    }
+
+    // Move the unconsumed bytes to the front; previously returned views are no longer in use.
+    if (m_begin > 0)
+    {
+        memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    if (m_buffer.size() < bytes)
+    {
+        m_buffer.resize(bytes);
+    }
+}
+
+bool FramedConnection::fill()
+{
+    if (m_begin == m_end)
+    {
+        m_begin = 0;
+        m_end = 0;
+    }
+    if (m_buffer.size() - m_end < FRAME_READ_SIZE / 4)
+    {
+        reserve(m_end - m_begin + FRAME_READ_SIZE);
+    }
+
+    std::span<std::byte> free(reinterpret_cast<std::byte*>(m_buffer.data() + m_end), m_buffer.size() - m_end);
+    ssize_t bytesReceived = m_socket < 0 ? m_connection.receive(free) : m_connection.receiveFrom(m_socket, free);
+    if (bytesReceived == 0)
+    {
+        m_closed = true;
+        return false;
+    }
+    if (bytesReceived == ERROR)
+    {
+        return false;
+    }
+
+    m_end += static_cast<size_t>(bytesReceived);
+    return true;
+}
+
+std::optional<std::string_view> FramedConnection::parseFrame()
+{
+    const size_t available = m_end - m_begin;
+    const auto* data = reinterpret_cast<const uint8_t*>(m_buffer.data() + m_begin);
+
+    uint64_t length = 0;
+    size_t prefixSize = 0;
+    if (m_prefix == FramePrefix::FixedU32)
+    {
+        if (available < 4)
+        {
+            return std::nullopt;
+        }
+        length = (static_cast<uint64_t>(data[0]) << 24) | (static_cast<uint64_t>(data[1]) << 16) |
+                 (static_cast<uint64_t>(data[2]) << 8) | static_cast<uint64_t>(data[3]);
+        prefixSize = 4;
+    }
+    else
+    {
+        for (size_t i = 0; i < available && i < FRAME_MAX_PREFIX; ++i)
+        {
+            length |= static_cast<uint64_t>(data[i] & 0x7f) << (7 * i);
+            if ((data[i] & 0x80) == 0)
+            {
+                prefixSize = i + 1;
+                break;
+            }
+        }
+        if (prefixSize == 0)
+        {
+            if (available >= FRAME_MAX_PREFIX)
+            {
+                throw std::runtime_error("Error: malformed frame length");
+            }
+            return std::nullopt;
+        }
+    }
+
+    if (length > m_maxFrameSize)
+    {
+        throw std::runtime_error("Error: frame exceeds maximum size");
+    }
+
+    if (available < prefixSize + length)
+    {
+        // Make room for the whole frame so it can be completed in place.
+        reserve(prefixSize + length);
+        return std::nullopt;
+    }
+
+    std::string_view frame(m_buffer.data() + m_begin + prefixSize, length);
+    m_begin += prefixSize + length;
+    return frame;
+}
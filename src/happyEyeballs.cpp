@@ -0,0 +1,262 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "happyEyeballs.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <poll.h>
+#include <type_traits>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Connection attempt still waiting for its handshake.
+     */
+    struct Attempt
+    {
+        int socket;   ///< Non-blocking socket of the attempt.
+        size_t index; ///< Position of its address in the ordered list.
+    };
+
+    // Start a non-blocking connect; returns the socket, or -1 when it failed at once.
+    int startAttempt(const ResolvedAddress& endpoint, const SocketOptions& options, bool& connected)
+    {
+        const int socket = ::socket(endpoint.family, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+        if (socket < 0)
+        {
+            return -1;
+        }
+        try
+        {
+            options.apply(socket);
+        }
+        catch (...)
+        {
+            ::close(socket);
+            throw;
+        }
+
+        connected = ::connect(socket, endpoint.data(), endpoint.length) == 0;
+        if (!connected && errno != EINPROGRESS && errno != EINTR)
+        {
+            ::close(socket);
+            return -1;
+        }
+        return socket;
+    }
+
+    // Milliseconds to poll before the earliest of two instants, -1 when neither is set.
+    int pollTimeout(std::optional<Clock::time_point> first, std::optional<Clock::time_point> second)
+    {
+        std::optional<Clock::time_point> until = first;
+        if (second && (!until || *second < *until))
+        {
+            until = second;
+        }
+        if (!until)
+        {
+            return -1;
+        }
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(*until - Clock::now()).count();
+        return static_cast<int>(std::max<int64_t>(left, 0));
+    }
+
+    // Race the attempts and return the connected socket, with the index of its address in winner.
+    int race(std::span<const ResolvedAddress> ordered, const HappyEyeballsOptions& options, size_t& winner)
+    {
+        std::vector<Attempt> attempts;
+        std::vector<struct pollfd> pollFds;
+        auto closeAll = [&attempts]
+        {
+            for (const Attempt& attempt : attempts)
+            {
+                ::close(attempt.socket);
+            }
+        };
+
+        std::optional<Clock::time_point> deadline;
+        if (options.timeout.count() > 0)
+        {
+            deadline = Clock::now() + options.timeout;
+        }
+
+        size_t next = 0;
+        Clock::time_point nextStart = Clock::now();
+        while (true)
+        {
+            // A new attempt starts once the delay elapsed, or right away when nothing is in flight.
+            if (next < ordered.size() && (attempts.empty() || Clock::now() >= nextStart))
+            {
+                bool connected = false;
+                int socket;
+                try
+                {
+                    socket = startAttempt(ordered[next], options.socketOptions, connected);
+                }
+                catch (...)
+                {
+                    closeAll();
+                    throw;
+                }
+                if (connected)
+                {
+                    closeAll();
+                    winner = next;
+                    return socket;
+                }
+                if (socket >= 0)
+                {
+                    attempts.push_back({socket, next});
+                    nextStart = Clock::now() + options.attemptDelay;
+                }
+                else
+                {
+                    nextStart = Clock::now();
+                }
+                ++next;
+                continue;
+            }
+            if (attempts.empty())
+            {
+                throw std::runtime_error("Error: cannot connect to any address");
+            }
+            if (deadline && Clock::now() >= *deadline)
+            {
+                closeAll();
+                throw TimeoutError("Error: connect timed out");
+            }
+
+            pollFds.clear();
+            for (const Attempt& attempt : attempts)
+            {
+                pollFds.push_back({attempt.socket, POLLOUT, 0});
+            }
+            std::optional<Clock::time_point> startAt;
+            if (next < ordered.size())
+            {
+                startAt = nextStart;
+            }
+            const int ready = ::poll(pollFds.data(), pollFds.size(), pollTimeout(startAt, deadline));
+            if (ready <= 0)
+            {
+                continue;
+            }
+
+            // Collect finished handshakes from the back, so erasing keeps the indexes of the others.
+            for (size_t i = pollFds.size(); i-- > 0;)
+            {
+                if (pollFds[i].revents == 0)
+                {
+                    continue;
+                }
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (getsockopt(attempts[i].socket, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+                {
+                    const Attempt won = attempts[i];
+                    attempts.erase(attempts.begin() + static_cast<ptrdiff_t>(i));
+                    closeAll();
+                    winner = won.index;
+                    return won.socket;
+                }
+                ::close(attempts[i].socket);
+                attempts.erase(attempts.begin() + static_cast<ptrdiff_t>(i));
+                // A failed attempt hands over to the next address without waiting for the delay.
+                nextStart = Clock::now();
+            }
+        }
+    }
+
+    template <typename Family>
+    std::unique_ptr<IConnection> adopt(int socket, const ResolvedAddress& endpoint, bool isBlocking)
+    {
+        if (isBlocking)
+        {
+            fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) & ~O_NONBLOCK);
+        }
+        auto stream = Socket<Tcp, Family>::fromDescriptor(socket, isBlocking);
+        if constexpr (std::is_same_v<Family, IPv6>)
+        {
+            return std::make_unique<TCPv6Connection>(std::move(stream), endpoint);
+        }
+        else
+        {
+            return std::make_unique<TCPv4Connection>(std::move(stream), endpoint);
+        }
+    }
+} // namespace
+
+std::vector<ResolvedAddress> interleaveAddresses(std::span<const ResolvedAddress> addresses, size_t firstFamilyCount)
+{
+    std::vector<ResolvedAddress> preferred;
+    std::vector<ResolvedAddress> other;
+    for (const ResolvedAddress& address : addresses)
+    {
+        (address.family == addresses.front().family ? preferred : other).push_back(address);
+    }
+
+    std::vector<ResolvedAddress> ordered;
+    ordered.reserve(addresses.size());
+    size_t p = 0;
+    size_t o = 0;
+    while (p < preferred.size() && p < std::max<size_t>(firstFamilyCount, 1))
+    {
+        ordered.push_back(preferred[p++]);
+    }
+    while (p < preferred.size() || o < other.size())
+    {
+        if (o < other.size())
+        {
+            ordered.push_back(other[o++]);
+        }
+        if (p < preferred.size())
+        {
+            ordered.push_back(preferred[p++]);
+        }
+    }
+    return ordered;
+}
+
+std::unique_ptr<IConnection> connectHappyEyeballs(std::span<const ResolvedAddress> addresses,
+                                                  bool isBlocking,
+                                                  const HappyEyeballsOptions& options)
+{
+    if (addresses.empty())
+    {
+        throw std::invalid_argument("Error: no address to connect to");
+    }
+    const std::vector<ResolvedAddress> ordered = interleaveAddresses(addresses, options.firstFamilyCount);
+
+    size_t winner = 0;
+    const int socket = race(ordered, options, winner);
+    if (ordered[winner].family == AF_INET6)
+    {
+        return adopt<IPv6>(socket, ordered[winner], isBlocking);
+    }
+    return adopt<IPv4>(socket, ordered[winner], isBlocking);
+}
+
+std::unique_ptr<IConnection> connectHappyEyeballs(const std::string& host,
+                                                  const std::string& port,
+                                                  bool isBlocking,
+                                                  const HappyEyeballsOptions& options)
+{
+    const std::vector<ResolvedAddress> addresses = Resolver::instance().resolve(host, port, AF_UNSPEC, SOCK_STREAM);
+    return connectHappyEyeballs(addresses, isBlocking, options);
+}
@@ -0,0 +1,250 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "resolver.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstddef>
+#include <cstring>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <sys/un.h>
+
+std::string ResolvedAddress::host() const
+{
+    char text[INET6_ADDRSTRLEN] = {};
+    if (family == AF_UNIX)
+    {
+        const auto* unixAddress = reinterpret_cast<const struct sockaddr_un*>(&address);
+        const size_t pathLength = length > offsetof(struct sockaddr_un, sun_path)
+                                      ? length - offsetof(struct sockaddr_un, sun_path)
+                                      : 0;
+        if (pathLength == 0)
+        {
+            return "";
+        }
+        if (unixAddress->sun_path[0] == '\0')
+        {
+            return "@" + std::string(unixAddress->sun_path + 1, pathLength - 1);
+        }
+        return std::string(unixAddress->sun_path, strnlen(unixAddress->sun_path, pathLength));
+    }
+    if (family == AF_INET6)
+    {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(&address)->sin6_addr, text, sizeof(text));
+    }
+    else
+    {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(&address)->sin_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+std::string ResolvedAddress::port() const
+{
+    if (family == AF_UNIX)
+    {
+        return "";
+    }
+    const uint16_t port = family == AF_INET6 ? reinterpret_cast<const struct sockaddr_in6*>(&address)->sin6_port
+                                             : reinterpret_cast<const struct sockaddr_in*>(&address)->sin_port;
+    return std::to_string(ntohs(port));
+}
+
+Resolution SystemResolverBackend::lookup(const std::string& host, const std::string& port, const struct addrinfo& hints)
+{
+    struct addrinfo* list = nullptr;
+    int result = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &list);
+    if (result != 0)
+    {
+        throw std::runtime_error(gai_strerror(result));
+    }
+
+    Resolution resolution {{}, std::chrono::milliseconds(-1)};
+    for (struct addrinfo* info = list; info != nullptr; info = info->ai_next)
+    {
+        ResolvedAddress resolved;
+        memset(&resolved.address, 0, sizeof(resolved.address));
+        memcpy(&resolved.address, info->ai_addr, info->ai_addrlen);
+        resolved.length = info->ai_addrlen;
+        resolved.family = info->ai_family;
+        resolved.socktype = info->ai_socktype;
+        resolved.protocol = info->ai_protocol;
+        resolution.addresses.push_back(resolved);
+    }
+    freeaddrinfo(list);
+    return resolution;
+}
+
+Resolver::Resolver(std::shared_ptr<ResolverBackend> backend,
+                   std::chrono::milliseconds defaultTtl,
+                   size_t capacity,
+                   size_t threads)
+    : m_backend(backend ? std::move(backend) : std::make_shared<SystemResolverBackend>())
+    , m_defaultTtl(defaultTtl)
+    , m_capacity(std::max<size_t>(capacity, 1))
+    , m_nextGeneration(0)
+    , m_counters {0, 0, 0}
+    , m_pool(threads)
+{
+}
+
+std::shared_future<std::vector<ResolvedAddress>>
+Resolver::resolveAsync(const std::string& host, const std::string& port, int family, int socktype)
+{
+    Key key {host, port, family, socktype};
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_cache.find(key);
+    if (it != m_cache.end())
+    {
+        m_recent.splice(m_recent.begin(), m_recent, it->second.recent);
+        if (!it->second.done)
+        {
+            ++m_counters.coalesced;
+            return it->second.result;
+        }
+        if (Clock::now() < it->second.expires)
+        {
+            ++m_counters.hits;
+            return it->second.result;
+        }
+        erase(it);
+    }
+
+    auto promise = std::make_shared<std::promise<std::vector<ResolvedAddress>>>();
+    std::shared_future<std::vector<ResolvedAddress>> result = promise->get_future().share();
+    const uint64_t generation = ++m_nextGeneration;
+    makeRoom();
+    m_recent.push_front(key);
+    m_cache.emplace(key, Entry {result, Clock::time_point::max(), false, generation, m_recent.begin()});
+    ++m_counters.lookups;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = socktype;
+    hints.ai_flags = host.empty() ? AI_PASSIVE : 0;
+
+    m_pool.submit(
+        [this, key, generation, hints, promise, backend = m_backend]
+        {
+            try
+            {
+                Resolution resolution = backend->lookup(std::get<0>(key), std::get<1>(key), hints);
+                if (resolution.addresses.empty())
+                {
+                    throw std::runtime_error("Error: no address found for " + std::get<0>(key));
+                }
+                complete(key, generation, resolution.ttl);
+                promise->set_value(std::move(resolution.addresses));
+            }
+            catch (...)
+            {
+                fail(key, generation);
+                promise->set_exception(std::current_exception());
+            }
+        });
+    return result;
+}
+
+std::vector<ResolvedAddress>
+Resolver::resolve(const std::string& host, const std::string& port, int family, int socktype)
+{
+    return resolveAsync(host, port, family, socktype).get();
+}
+
+void Resolver::complete(const Key& key, uint64_t generation, std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_cache.find(key);
+    if (it != m_cache.end() && it->second.generation == generation)
+    {
+        it->second.done = true;
+        it->second.expires = Clock::now() + (ttl.count() < 0 ? m_defaultTtl : ttl);
+    }
+}
+
+void Resolver::fail(const Key& key, uint64_t generation)
+{
+    // Failures are not cached: the next request queries the backend again.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_cache.find(key);
+    if (it != m_cache.end() && it->second.generation == generation)
+    {
+        erase(it);
+    }
+}
+
+void Resolver::makeRoom()
+{
+    const Clock::time_point now = Clock::now();
+    for (auto it = m_cache.begin(); it != m_cache.end();)
+    {
+        auto next = std::next(it);
+        if (it->second.done && it->second.expires <= now)
+        {
+            erase(it);
+        }
+        it = next;
+    }
+
+    // Evicting a pending lookup is safe: its callers hold the future, and its completion finds no entry.
+    while (m_cache.size() >= m_capacity)
+    {
+        erase(m_cache.find(m_recent.back()));
+    }
+}
+
+void Resolver::erase(std::map<Key, Entry>::iterator it)
+{
+    m_recent.erase(it->second.recent);
+    m_cache.erase(it);
+}
+
+void Resolver::setBackend(std::shared_ptr<ResolverBackend> backend)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_backend = backend ? std::move(backend) : std::make_shared<SystemResolverBackend>();
+    m_cache.clear();
+    m_recent.clear();
+}
+
+void Resolver::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cache.clear();
+    m_recent.clear();
+}
+
+size_t Resolver::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cache.size();
+}
+
+Resolver::Counters Resolver::counters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counters;
+}
+
+Resolver& Resolver::instance()
+{
+    static Resolver resolver;
+    return resolver;
+}
@@ -0,0 +1,149 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "shardedListener.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+ShardedListener::ShardedListener(const std::string& address,
+                                 const std::string& port,
+                                 int protocolMacro,
+                                 size_t shards,
+                                 bool pinThreads,
+                                 SocketOptions options)
+    : m_pinThreads(pinThreads)
+    , m_started(0)
+{
+    if (shards == 0)
+    {
+        shards = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    options.reusePort = true;
+    std::string shardPort = port;
+    for (size_t i = 0; i < shards; ++i)
+    {
+        auto listener = createConnection(address, shardPort, false, protocolMacro, options);
+        listener->bind();
+        // The first shard may have picked the port; the others join it.
+        shardPort = listener->GetPort();
+        m_listeners.push_back(std::move(listener));
+    }
+}
+
+ShardedListener::~ShardedListener()
+{
+    stop();
+}
+
+void ShardedListener::start(Setup setup)
+{
+    if (!m_workers.empty())
+    {
+        throw std::runtime_error("Error: sharded listener already started");
+    }
+
+    m_started = 0;
+    m_setupError = nullptr;
+    for (size_t i = 0; i < m_listeners.size(); ++i)
+    {
+        m_loops.push_back(std::make_unique<EventLoop>());
+    }
+    for (size_t i = 0; i < m_listeners.size(); ++i)
+    {
+        m_workers.emplace_back([this, i, setup] { work(i, setup); });
+    }
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock, [this] { return m_started == m_listeners.size(); });
+        error = m_setupError;
+    }
+
+    if (error)
+    {
+        stop();
+        std::rethrow_exception(error);
+    }
+}
+
+void ShardedListener::work(size_t shard, const Setup& setup)
+{
+    if (m_pinThreads)
+    {
+        // Best effort: a restricted affinity mask only costs the locality, not correctness.
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    EventLoop& loop = *m_loops[shard];
+    bool ready = true;
+    try
+    {
+        setup(loop, *m_listeners[shard], shard);
+    }
+    catch (...)
+    {
+        ready = false;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_setupError)
+        {
+            m_setupError = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_started;
+    }
+    m_ready.notify_one();
+
+    if (ready)
+    {
+        loop.run();
+    }
+}
+
+MetricsSnapshot ShardedListener::metrics()
+{
+    MetricsSnapshot total;
+    for (auto& listener : m_listeners)
+    {
+        if (ConnectionMetrics* metrics = listener->metrics())
+        {
+            total += metrics->snapshot();
+        }
+    }
+    return total;
+}
+
+void ShardedListener::stop()
+{
+    for (auto& loop : m_loops)
+    {
+        loop->stop();
+    }
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    m_loops.clear();
+}
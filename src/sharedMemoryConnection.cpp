@@ -0,0 +1,609 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "sharedMemoryConnection.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utility>
+
+namespace
+{
+    constexpr auto HANDSHAKE_FDS = 5; // memfd, then the readable and writable eventfds of both rings.
+    constexpr auto SPIN_BATCH = 64;   // Ring polls between two clock reads while spinning.
+    constexpr auto RECORD_ALIGN = 8;  // Every record starts 8-byte aligned, like its length field.
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters must be shareable between processes");
+    static_assert(sizeof(SharedMemoryRing::Header) <= 4096, "ring header must fit in a page");
+
+    size_t pageSize()
+    {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    // A ring needs a power of two multiple of the page, and both views of it must fit in a mapping.
+    bool validCapacity(uint64_t capacity)
+    {
+        const size_t page = pageSize();
+        return capacity >= page && capacity % page == 0 && (capacity & (capacity - 1)) == 0 &&
+               capacity <= (std::numeric_limits<size_t>::max() - page) / 2;
+    }
+
+    uint64_t recordSize(uint64_t length)
+    {
+        return (SHM_RECORD_HEADER + length + RECORD_ALIGN - 1) & ~static_cast<uint64_t>(RECORD_ALIGN - 1);
+    }
+
+    void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    void wake(int fd)
+    {
+        const uint64_t one = 1;
+        while (::write(fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    void drain(int fd)
+    {
+        uint64_t value;
+        while (::read(fd, &value, sizeof(value)) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    bool peerClosed(int socket)
+    {
+        char byte;
+        return ::recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+    }
+} // namespace
+
+SharedMemoryRing::SharedMemoryRing(int memfd, off_t offset, size_t capacity, int readableFd, int writableFd)
+    : m_mapping(MAP_FAILED)
+    , m_mappingSize(0)
+    , m_header(nullptr)
+    , m_data(nullptr)
+    , m_capacity(capacity)
+    , m_readableFd(readableFd)
+    , m_writableFd(writableFd)
+    , m_tail(0)
+    , m_cachedHead(0)
+    , m_head(0)
+    , m_cachedTail(0)
+    , m_peeked(0)
+    , m_armed(false)
+{
+    const size_t page = pageSize();
+    if (!validCapacity(capacity))
+    {
+        ::close(readableFd);
+        ::close(writableFd);
+        throw std::invalid_argument("Error: ring capacity must be a power of two multiple of the page size");
+    }
+
+    // Reserve the whole range first, so that the second view of the data area lands right after the first.
+    m_mappingSize = page + 2 * capacity;
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    auto* base = static_cast<std::byte*>(m_mapping);
+    const int protection = PROT_READ | PROT_WRITE;
+    if (m_mapping == MAP_FAILED ||
+        mmap(base, page + capacity, protection, MAP_SHARED | MAP_FIXED, memfd, offset) == MAP_FAILED ||
+        mmap(base + page + capacity, capacity, protection, MAP_SHARED | MAP_FIXED, memfd,
+             offset + static_cast<off_t>(page)) == MAP_FAILED)
+    {
+        const std::string reason = strerror(errno);
+        if (m_mapping != MAP_FAILED)
+        {
+            munmap(m_mapping, m_mappingSize);
+        }
+        ::close(readableFd);
+        ::close(writableFd);
+        throw std::runtime_error("Error: cannot map shared memory ring: " + reason);
+    }
+
+    m_header = reinterpret_cast<Header*>(base);
+    m_data = base + page;
+    m_tail = m_cachedTail = m_header->tail.load(std::memory_order_acquire);
+    m_head = m_cachedHead = m_header->head.load(std::memory_order_acquire);
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+    munmap(m_mapping, m_mappingSize);
+    ::close(m_readableFd);
+    ::close(m_writableFd);
+}
+
+size_t SharedMemoryRing::segmentSize(size_t capacity)
+{
+    return pageSize() + capacity;
+}
+
+bool SharedMemoryRing::tryWrite(std::span<const std::string_view> parts)
+{
+    size_t length = 0;
+    for (const std::string_view& part : parts)
+    {
+        length += part.size();
+    }
+    if (length > maxMessage())
+    {
+        throw std::invalid_argument("Error: message larger than the shared memory ring");
+    }
+
+    const uint64_t size = recordSize(length);
+    if (!writable(size))
+    {
+        return false;
+    }
+
+    std::byte* record = m_data + (m_tail & (m_capacity - 1));
+    const uint64_t header = length;
+    memcpy(record, &header, SHM_RECORD_HEADER);
+    size_t position = SHM_RECORD_HEADER;
+    for (const std::string_view& part : parts)
+    {
+        memcpy(record + position, part.data(), part.size());
+        position += part.size();
+    }
+
+    m_tail += size;
+    m_header->tail.store(m_tail, std::memory_order_release);
+    // Pairs with the fence in wait(): either the consumer sees the new tail or we see its flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_header->consumerWaiting.load(std::memory_order_relaxed) != 0)
+    {
+        wake(m_readableFd);
+    }
+    return true;
+}
+
+std::optional<std::string_view> SharedMemoryRing::peek()
+{
+    if (m_peeked == 0 && !readable())
+    {
+        return std::nullopt;
+    }
+
+    const std::byte* record = m_data + (m_head & (m_capacity - 1));
+    uint64_t length;
+    memcpy(&length, record, SHM_RECORD_HEADER);
+    // The peer process writes the ring, so its lengths are checked before they are trusted.
+    if (length > maxMessage() || recordSize(length) > m_cachedTail - m_head)
+    {
+        throw std::runtime_error("Error: corrupted shared memory ring");
+    }
+    m_peeked = recordSize(length);
+
+    if (m_armed)
+    {
+        m_header->consumerWaiting.store(0, std::memory_order_relaxed);
+        m_armed = false;
+    }
+    return std::string_view(reinterpret_cast<const char*>(record + SHM_RECORD_HEADER), length);
+}
+
+void SharedMemoryRing::release()
+{
+    if (m_peeked == 0)
+    {
+        return;
+    }
+
+    m_head += m_peeked;
+    m_peeked = 0;
+    m_header->head.store(m_head, std::memory_order_release);
+    // Pairs with the fence in wait(): either the producer sees the new head or we see its flag.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_header->producerWaiting.load(std::memory_order_relaxed) != 0)
+    {
+        wake(m_writableFd);
+    }
+}
+
+bool SharedMemoryRing::waitReadable(int peer, std::chrono::microseconds spin)
+{
+    return wait(m_header->consumerWaiting, m_readableFd, peer, spin, [this] { return m_peeked != 0 || readable(); });
+}
+
+bool SharedMemoryRing::waitWritable(size_t length, int peer, std::chrono::microseconds spin)
+{
+    const uint64_t size = recordSize(length);
+    return wait(m_header->producerWaiting, m_writableFd, peer, spin, [this, size] { return writable(size); });
+}
+
+bool SharedMemoryRing::armReadable()
+{
+    drain(m_readableFd);
+    m_header->consumerWaiting.store(1, std::memory_order_relaxed);
+    m_armed = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return !readable();
+}
+
+bool SharedMemoryRing::readable()
+{
+    if (m_head != m_cachedTail)
+    {
+        return true;
+    }
+    m_cachedTail = m_header->tail.load(std::memory_order_acquire);
+    return m_head != m_cachedTail;
+}
+
+bool SharedMemoryRing::writable(uint64_t size)
+{
+    if (m_tail + size - m_cachedHead <= m_capacity)
+    {
+        return true;
+    }
+    m_cachedHead = m_header->head.load(std::memory_order_acquire);
+    return m_tail + size - m_cachedHead <= m_capacity;
+}
+
+template <typename Ready>
+bool SharedMemoryRing::wait(std::atomic<uint32_t>& flag, int fd, int peer, std::chrono::microseconds spin, Ready ready)
+{
+    if (ready())
+    {
+        return true;
+    }
+    if (spin.count() > 0)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + spin;
+        do
+        {
+            for (int i = 0; i < SPIN_BATCH; ++i)
+            {
+                if (ready())
+                {
+                    return true;
+                }
+                cpuRelax();
+            }
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    struct pollfd pollFds[2] = {{fd, POLLIN, 0}, {peer, POLLIN, 0}};
+    bool isReady = false;
+    while (true)
+    {
+        flag.store(1, std::memory_order_relaxed);
+        // Pairs with the fence after the other side moves its counter: either it sees the flag or we see the move.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((isReady = ready()))
+        {
+            break;
+        }
+        if (::poll(pollFds, peer >= 0 ? 2 : 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            flag.store(0, std::memory_order_relaxed);
+            throw std::runtime_error(std::string("Error: cannot wait on the shared memory ring: ") + strerror(errno));
+        }
+        drain(fd);
+        // Nothing is sent on the handshake socket anymore: it only becomes readable when the peer hangs up.
+        if (pollFds[1].revents != 0)
+        {
+            isReady = ready();
+            break;
+        }
+    }
+    flag.store(0, std::memory_order_relaxed);
+    return isReady;
+}
+
+SharedMemoryConnection::SharedMemoryConnection(const std::string& path, bool isBlocking, size_t capacity)
+    : IConnection(path, "", isBlocking)
+    , m_control(path, isBlocking)
+    , m_capacity(capacity)
+{
+    m_socket = m_control.getSocket();
+}
+
+SharedMemoryConnection::~SharedMemoryConnection()
+{
+    // The client channel shares the socket of m_control, which closes it.
+    for (auto& [socket, channel] : m_channels)
+    {
+        if (socket != m_socket)
+        {
+            ::close(socket);
+        }
+    }
+}
+
+bool SharedMemoryConnection::bind()
+{
+    m_control.bind();
+    m_address = m_control.GetPath();
+    m_listening = true;
+    return true;
+}
+
+int SharedMemoryConnection::connect()
+{
+    if (m_listening)
+    {
+        const int client = m_control.connect();
+        if (client == ERROR)
+        {
+            return ERROR;
+        }
+
+        std::array<int, HANDSHAKE_FDS> fds;
+        fds.fill(-1);
+        try
+        {
+            fds[0] = memfd_create("cppSocket-shm", MFD_CLOEXEC);
+            if (fds[0] < 0 || ftruncate(fds[0], static_cast<off_t>(2 * SharedMemoryRing::segmentSize(m_capacity))) < 0)
+            {
+                throw std::runtime_error(std::string("Error: cannot create shared memory: ") + strerror(errno));
+            }
+            for (size_t i = 1; i < fds.size(); ++i)
+            {
+                fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (fds[i] < 0)
+                {
+                    throw std::runtime_error("Error creating eventfd");
+                }
+            }
+
+            const uint64_t capacity = m_capacity;
+            const std::string_view handshake(reinterpret_cast<const char*>(&capacity), sizeof(capacity));
+            if (!m_control.sendFdsTo(client, handshake, fds))
+            {
+                throw std::runtime_error("Error: cannot send the shared memory handshake");
+            }
+
+            // The first ring carries messages to the client, the second one messages from it.
+            const auto second = static_cast<off_t>(SharedMemoryRing::segmentSize(m_capacity));
+            auto channel = std::make_unique<Channel>();
+            channel->socket = client;
+            channel->out = std::make_unique<SharedMemoryRing>(fds[0], 0, m_capacity, std::exchange(fds[1], -1),
+                                                              std::exchange(fds[2], -1));
+            channel->in = std::make_unique<SharedMemoryRing>(fds[0], second, m_capacity, std::exchange(fds[3], -1),
+                                                             std::exchange(fds[4], -1));
+            ::close(std::exchange(fds[0], -1));
+            m_channels[client] = std::move(channel);
+        }
+        catch (...)
+        {
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+            }
+            ::close(client);
+            throw;
+        }
+        return client;
+    }
+
+    m_control.connect();
+
+    uint64_t capacity = 0;
+    std::vector<int> fds;
+    ssize_t bytesReceived;
+    while ((bytesReceived = m_control.receiveFds(std::as_writable_bytes(std::span(&capacity, 1)), fds)) == ERROR)
+    {
+        struct pollfd pollFd = {m_socket, POLLIN, 0};
+        ::poll(&pollFd, 1, -1);
+    }
+
+    struct stat status;
+    const bool valid = bytesReceived == sizeof(capacity) && fds.size() == HANDSHAKE_FDS && validCapacity(capacity) &&
+                       fstat(fds[0], &status) == 0 &&
+                       static_cast<uint64_t>(status.st_size) >= 2 * SharedMemoryRing::segmentSize(capacity);
+    if (!valid)
+    {
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        throw std::runtime_error("Error: invalid shared memory handshake");
+    }
+
+    m_capacity = capacity;
+    const auto second = static_cast<off_t>(SharedMemoryRing::segmentSize(m_capacity));
+    auto channel = std::make_unique<Channel>();
+    channel->socket = m_socket;
+    // Each ring owns its eventfds from the moment it is constructed, even when the constructor throws.
+    try
+    {
+        channel->in = std::make_unique<SharedMemoryRing>(fds[0], 0, m_capacity, std::exchange(fds[1], -1),
+                                                         std::exchange(fds[2], -1));
+        channel->out = std::make_unique<SharedMemoryRing>(fds[0], second, m_capacity, std::exchange(fds[3], -1),
+                                                          std::exchange(fds[4], -1));
+    }
+    catch (...)
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+        throw;
+    }
+    ::close(fds[0]);
+    m_channels[m_socket] = std::move(channel);
+
+    return true;
+}
+
+bool SharedMemoryConnection::send(const std::string& message)
+{
+    std::string_view part = message;
+    return sendto(std::span<const std::string_view>(&part, 1), m_socket);
+}
+
+bool SharedMemoryConnection::sendto(const std::string& message, int fdDestiny)
+{
+    std::string_view part = message;
+    return sendto(std::span<const std::string_view>(&part, 1), fdDestiny);
+}
+
+bool SharedMemoryConnection::send(std::span<const std::string_view> parts)
+{
+    return sendto(parts, m_socket);
+}
+
+bool SharedMemoryConnection::sendto(std::span<const std::string_view> parts, int fdDestiny)
+{
+    Channel& peer = channel(fdDestiny);
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->sendLatency : nullptr);
+
+    size_t length = 0;
+    for (const std::string_view& part : parts)
+    {
+        length += part.size();
+    }
+
+    while (!peer.out->tryWrite(parts))
+    {
+        ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+        if (!m_isBlocking)
+        {
+            return false;
+        }
+        if (!peer.out->waitWritable(length, peer.socket, m_spin))
+        {
+            ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::errors);
+            throw std::runtime_error("Error: connection closed by peer");
+        }
+    }
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesSent);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesSent, length);
+    return true;
+}
+
+ssize_t SharedMemoryConnection::awaitMessage(Channel& peer)
+{
+    if (peer.in->peek())
+    {
+        return 1;
+    }
+
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::wouldBlock);
+    if (m_isBlocking)
+    {
+        return peer.in->waitReadable(peer.socket, m_spin) ? 1 : 0;
+    }
+    if (!peer.in->armReadable())
+    {
+        return 1;
+    }
+    return peerClosed(peer.socket) ? 0 : ERROR;
+}
+
+std::string SharedMemoryConnection::receive()
+{
+    return receiveFrom(m_socket);
+}
+
+std::string SharedMemoryConnection::receiveFrom(int socket)
+{
+    Channel& peer = channel(socket);
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->receiveLatency : nullptr);
+
+    const ssize_t status = awaitMessage(peer);
+    if (status == ERROR)
+    {
+        throw std::runtime_error("Error: failed to receive message");
+    }
+    else if (status == 0)
+    {
+        throw std::runtime_error("Connection closed by peer receiveFrom");
+    }
+
+    std::string message(*peer.in->peek());
+    peer.in->release();
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesReceived);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesReceived, message.size());
+    return message;
+}
+
+ssize_t SharedMemoryConnection::receiveFrom(int socket, std::span<std::byte> buffer)
+{
+    Channel& peer = channel(socket);
+    LatencyHistogram::Scope timer(m_metrics ? &m_metrics->receiveLatency : nullptr);
+
+    const ssize_t status = awaitMessage(peer);
+    if (status <= 0)
+    {
+        return status;
+    }
+
+    const std::string_view message = *peer.in->peek();
+    const size_t length = std::min(message.size(), buffer.size());
+    memcpy(buffer.data(), message.data(), length);
+    peer.in->release();
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::messagesReceived);
+    ConnectionMetrics::add(m_metrics.get(), &ConnectionMetrics::bytesReceived, length);
+    return static_cast<ssize_t>(length);
+}
+
+int SharedMemoryConnection::getSocket()
+{
+    return m_socket;
+}
+
+int SharedMemoryConnection::notifyFd(int socket)
+{
+    return channel(socket).in->readableFd();
+}
+
+void SharedMemoryConnection::disconnect(int socket)
+{
+    auto it = m_channels.find(socket);
+    if (it == m_channels.end() || socket == m_socket)
+    {
+        throw std::invalid_argument("Error: not an accepted shared memory client");
+    }
+    m_channels.erase(it);
+    ::close(socket);
+}
+
+SharedMemoryConnection::Channel& SharedMemoryConnection::channel(int socket)
+{
+    auto it = m_channels.find(socket);
+    if (it == m_channels.end())
+    {
+        throw std::invalid_argument("Error: no shared memory rings for this socket");
+    }
+    return *it->second;
+}
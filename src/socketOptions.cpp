@@ -0,0 +1,129 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "socketOptions.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+namespace
+{
+    constexpr auto LOW_LATENCY_NOTSENT_LOWAT = 16384;  // Unsent bytes kept by the low-latency preset.
+    constexpr auto LOW_LATENCY_PRIORITY = 6;           // TC_PRIO_INTERACTIVE, the highest unprivileged value.
+    constexpr auto BULK_BUFFER_SIZE = 4 * 1024 * 1024; // Kernel buffers requested by the bulk preset.
+
+    void setOption(int socket, int level, int name, int value, const char* label)
+    {
+        if (setsockopt(socket, level, name, &value, sizeof(value)) < 0)
+        {
+            throw std::runtime_error(std::string("Error: cannot set ") + label + ": " + strerror(errno));
+        }
+    }
+
+    void setOption(int socket, int level, int name, const std::optional<int>& value, const char* label)
+    {
+        if (value)
+        {
+            setOption(socket, level, name, *value, label);
+        }
+    }
+
+    void setOption(int socket, int level, int name, const std::optional<bool>& value, const char* label)
+    {
+        if (value)
+        {
+            setOption(socket, level, name, *value ? 1 : 0, label);
+        }
+    }
+
+    void setOption(int socket, int name, const std::optional<std::chrono::milliseconds>& value, const char* label)
+    {
+        if (!value)
+        {
+            return;
+        }
+        const auto milliseconds = std::max<int64_t>(value->count(), 0);
+        struct timeval timeout = {static_cast<time_t>(milliseconds / 1000),
+                                  static_cast<suseconds_t>(milliseconds % 1000 * 1000)};
+        if (setsockopt(socket, SOL_SOCKET, name, &timeout, sizeof(timeout)) < 0)
+        {
+            throw std::runtime_error(std::string("Error: cannot set ") + label + ": " + strerror(errno));
+        }
+    }
+
+    bool isTcpSocket(int socket)
+    {
+        int type = 0;
+        socklen_t typeLength = sizeof(type);
+        int protocol = 0;
+        socklen_t protocolLength = sizeof(protocol);
+        return getsockopt(socket, SOL_SOCKET, SO_TYPE, &type, &typeLength) == 0 && type == SOCK_STREAM &&
+               getsockopt(socket, SOL_SOCKET, SO_PROTOCOL, &protocol, &protocolLength) == 0 &&
+               protocol == IPPROTO_TCP;
+    }
+} // namespace
+
+SocketOptions SocketOptions::lowLatency()
+{
+    SocketOptions options;
+    options.noDelay = true;
+    options.quickAck = true;
+    options.notSentLowat = LOW_LATENCY_NOTSENT_LOWAT;
+    options.priority = LOW_LATENCY_PRIORITY;
+    return options;
+}
+
+SocketOptions SocketOptions::bulkThroughput()
+{
+    SocketOptions options;
+    options.noDelay = false;
+    options.sendBuffer = BULK_BUFFER_SIZE;
+    options.receiveBuffer = BULK_BUFFER_SIZE;
+    return options;
+}
+
+void SocketOptions::apply(int socket) const
+{
+    setOption(socket, SOL_SOCKET, SO_REUSEADDR, reuseAddress, "SO_REUSEADDR");
+    setOption(socket, SOL_SOCKET, SO_REUSEPORT, reusePort, "SO_REUSEPORT");
+    setOption(socket, SOL_SOCKET, SO_SNDBUF, sendBuffer, "SO_SNDBUF");
+    setOption(socket, SOL_SOCKET, SO_RCVBUF, receiveBuffer, "SO_RCVBUF");
+    setOption(socket, SOL_SOCKET, SO_BUSY_POLL, busyPoll, "SO_BUSY_POLL");
+    setOption(socket, SOL_SOCKET, SO_PRIORITY, priority, "SO_PRIORITY");
+    setOption(socket, SOL_SOCKET, SO_KEEPALIVE, keepAlive, "SO_KEEPALIVE");
+    setOption(socket, SO_RCVTIMEO, receiveTimeout, "SO_RCVTIMEO");
+    setOption(socket, SO_SNDTIMEO, sendTimeout, "SO_SNDTIMEO");
+
+    if (!isTcpSocket(socket))
+    {
+        return;
+    }
+
+    setOption(socket, IPPROTO_TCP, TCP_NODELAY, noDelay, "TCP_NODELAY");
+    setOption(socket, IPPROTO_TCP, TCP_CORK, cork, "TCP_CORK");
+    setOption(socket, IPPROTO_TCP, TCP_QUICKACK, quickAck, "TCP_QUICKACK");
+    setOption(socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, notSentLowat, "TCP_NOTSENT_LOWAT");
+    setOption(socket, IPPROTO_TCP, TCP_KEEPIDLE, keepAliveIdle, "TCP_KEEPIDLE");
+    setOption(socket, IPPROTO_TCP, TCP_KEEPINTVL, keepAliveInterval, "TCP_KEEPINTVL");
+    setOption(socket, IPPROTO_TCP, TCP_KEEPCNT, keepAliveCount, "TCP_KEEPCNT");
+}
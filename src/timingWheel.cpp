@@ -0,0 +1,252 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "timingWheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <stdexcept>
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, size_t slots)
+    : m_start(Clock::now())
+    , m_tick(tick)
+    , m_mask(slots - 1)
+    , m_current(0)
+    , m_pending(0)
+    , m_free(-1)
+    , m_heads(slots, -1)
+    , m_tails(slots, -1)
+    , m_occupied(slots / 64, 0)
+{
+    if (tick.count() <= 0 || slots < 64 || !std::has_single_bit(slots))
+    {
+        throw std::invalid_argument("Error: invalid timing wheel geometry");
+    }
+}
+
+uint64_t TimingWheel::schedule(std::chrono::milliseconds delay, Task task)
+{
+    int32_t index = m_free;
+    if (index >= 0)
+    {
+        m_free = m_nodes[index].next;
+    }
+    else
+    {
+        if (m_nodes.size() > INT32_MAX)
+        {
+            throw std::runtime_error("Error: too many timers");
+        }
+        index = static_cast<int32_t>(m_nodes.size());
+        m_nodes.push_back(Node {nullptr, 0, 0, -1, -1, State::Free});
+    }
+
+    Node& node = m_nodes[index];
+    node.task = std::move(task);
+    // Generation 0 is skipped so that no identifier is ever 0.
+    if (++node.generation == 0)
+    {
+        node.generation = 1;
+    }
+    ++m_pending;
+    arm(index, delay);
+    return (static_cast<uint64_t>(node.generation) << 32) | static_cast<uint32_t>(index);
+}
+
+bool TimingWheel::reschedule(uint64_t id, std::chrono::milliseconds delay)
+{
+    Node* node = find(id);
+    if (node == nullptr)
+    {
+        return false;
+    }
+    const auto index = static_cast<int32_t>(id & 0xffffffff);
+    if (node->state == State::Armed)
+    {
+        unlink(index);
+    }
+    arm(index, delay);
+    return true;
+}
+
+bool TimingWheel::cancel(uint64_t id)
+{
+    Node* node = find(id);
+    if (node == nullptr)
+    {
+        return false;
+    }
+    const auto index = static_cast<int32_t>(id & 0xffffffff);
+    if (node->state == State::Armed)
+    {
+        unlink(index);
+    }
+    release(index);
+    return true;
+}
+
+size_t TimingWheel::advance(Clock::time_point now)
+{
+    const uint64_t target = ticksAt(now);
+    size_t fired = 0;
+    while (m_current < target)
+    {
+        if (m_pending == 0)
+        {
+            m_current = target;
+            break;
+        }
+
+        ++m_current;
+        const size_t slot = m_current & m_mask;
+        m_due.clear();
+        for (int32_t index = m_heads[slot]; index >= 0;)
+        {
+            Node& node = m_nodes[index];
+            const int32_t next = node.next;
+            // Timers of a later turn stay in the slot.
+            if (node.expiry <= m_current)
+            {
+                unlink(index);
+                node.state = State::Due;
+                m_due.push_back((static_cast<uint64_t>(node.generation) << 32) | static_cast<uint32_t>(index));
+            }
+            index = next;
+        }
+
+        // A task may cancel or re-arm a timer of the same batch; such timers are no longer due.
+        for (size_t i = 0; i < m_due.size(); ++i)
+        {
+            Node* node = find(m_due[i]);
+            if (node == nullptr || node->state != State::Due)
+            {
+                continue;
+            }
+            Task task = std::move(node->task);
+            release(static_cast<int32_t>(m_due[i] & 0xffffffff));
+            task();
+            ++fired;
+        }
+    }
+    return fired;
+}
+
+int TimingWheel::timeoutMs(Clock::time_point now) const
+{
+    if (m_pending == 0)
+    {
+        return -1;
+    }
+
+    // First occupied slot after the current tick, wrapping around once.
+    const size_t start = (m_current + 1) & m_mask;
+    const size_t words = m_occupied.size();
+    for (size_t n = 0; n <= words; ++n)
+    {
+        const size_t word = (start / 64 + n) % words;
+        uint64_t bits = m_occupied[word];
+        if (n == 0)
+        {
+            bits &= ~0ull << (start % 64);
+        }
+        else if (n == words)
+        {
+            bits &= (1ull << (start % 64)) - 1;
+        }
+        if (bits == 0)
+        {
+            continue;
+        }
+
+        const size_t slot = word * 64 + static_cast<size_t>(std::countr_zero(bits));
+        const uint64_t ticks = ((slot - start) & m_mask) + 1;
+        const auto deadline = m_start + m_tick * static_cast<int64_t>(m_current + ticks);
+        // Rounded up, so the caller never wakes up just before the tick and spins.
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+        return static_cast<int>(std::clamp<decltype(wait)>(wait, 0, INT32_MAX));
+    }
+    return 0;
+}
+
+uint64_t TimingWheel::ticksAt(Clock::time_point now) const
+{
+    return now <= m_start ? 0 : static_cast<uint64_t>((now - m_start) / m_tick);
+}
+
+TimingWheel::Node* TimingWheel::find(uint64_t id)
+{
+    const uint64_t index = id & 0xffffffff;
+    if (index >= m_nodes.size())
+    {
+        return nullptr;
+    }
+    Node& node = m_nodes[index];
+    return node.state != State::Free && node.generation == (id >> 32) ? &node : nullptr;
+}
+
+void TimingWheel::arm(int32_t index, std::chrono::milliseconds delay)
+{
+    // One extra tick, since the current one has partly elapsed: the timer never fires early.
+    const auto span = std::chrono::duration_cast<Clock::duration>(std::max(delay, std::chrono::milliseconds(0)));
+    const auto ticks = static_cast<uint64_t>((span + m_tick - Clock::duration(1)) / m_tick);
+    Node& node = m_nodes[index];
+    node.expiry = std::max(ticksAt(Clock::now()), m_current) + ticks + 1;
+    node.state = State::Armed;
+    link(index);
+}
+
+void TimingWheel::link(int32_t index)
+{
+    Node& node = m_nodes[index];
+    const size_t slot = node.expiry & m_mask;
+    node.prev = m_tails[slot];
+    node.next = -1;
+    if (node.prev >= 0)
+    {
+        m_nodes[node.prev].next = index;
+    }
+    else
+    {
+        m_heads[slot] = index;
+        m_occupied[slot / 64] |= 1ull << (slot % 64);
+    }
+    m_tails[slot] = index;
+}
+
+void TimingWheel::unlink(int32_t index)
+{
+    Node& node = m_nodes[index];
+    const size_t slot = node.expiry & m_mask;
+    (node.prev >= 0 ? m_nodes[node.prev].next : m_heads[slot]) = node.next;
+    (node.next >= 0 ? m_nodes[node.next].prev : m_tails[slot]) = node.prev;
+    if (m_heads[slot] < 0)
+    {
+        m_occupied[slot / 64] &= ~(1ull << (slot % 64));
+    }
+    node.prev = -1;
+    node.next = -1;
+}
+
+void TimingWheel::release(int32_t index)
+{
+    Node& node = m_nodes[index];
+    node.task = nullptr;
+    node.state = State::Free;
+    node.next = m_free;
+    m_free = index;
+    --m_pending;
+}
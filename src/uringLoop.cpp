@@ -0,0 +1,732 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "uringLoop.hpp"
+
+#include <csignal>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace
+{
+    int ioUringSetup(unsigned entries, struct io_uring_params* params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argSize));
+    }
+
+    int ioUringRegister(int ringFd, unsigned opcode, const void* arg, unsigned count)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+    }
+
+    constexpr uint64_t OPERATION_MASK = 0x7; // Connections are 8-byte aligned, the low bits carry the operation.
+} // namespace
+
+UringLoop::UringLoop(unsigned entries, unsigned bufferCount, unsigned bufferSize, unsigned maxFiles)
+    : m_ringFd(-1)
+    , m_wakeFd(-1)
+    , m_wakeValue(0)
+    , m_stopRequested(false)
+    , m_sqRing(MAP_FAILED)
+    , m_sqRingSize(0)
+    , m_cqRing(MAP_FAILED)
+    , m_cqRingSize(0)
+    , m_sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED))
+    , m_sqesSize(0)
+    , m_sqLocalTail(0)
+    , m_unsubmitted(0)
+    , m_bufferCount(bufferCount)
+    , m_bufferSize(bufferSize)
+    , m_bufferRing(MAP_FAILED)
+    , m_bufferRingSize(0)
+    , m_bufferTail(0)
+    , m_maxFiles(maxFiles)
+{
+    if (bufferCount == 0 || (bufferCount & (bufferCount - 1)) != 0 || bufferCount > 32768)
+    {
+        throw std::invalid_argument("Error: buffer count must be a power of two up to 32768");
+    }
+
+    try
+    {
+        setupRings(entries);
+        setupBuffers();
+        setupFiles();
+
+        m_wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (m_wakeFd < 0)
+        {
+            throw std::runtime_error("Error creating eventfd");
+        }
+        submitWake();
+    }
+    catch (...)
+    {
+        releaseRings();
+        throw;
+    }
+}
+
+UringLoop::~UringLoop()
+{
+    for (const auto& [fd, connection] : m_connections)
+    {
+        if (connection->owned)
+        {
+            ::close(fd);
+        }
+    }
+    releaseRings();
+}
+
+void UringLoop::releaseRings()
+{
+    // Closing the ring cancels every request still in flight before the buffers are released.
+    if (m_ringFd >= 0)
+    {
+        ::close(m_ringFd);
+        m_ringFd = -1;
+    }
+    if (m_wakeFd >= 0)
+    {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    if (m_bufferRing != MAP_FAILED)
+    {
+        munmap(m_bufferRing, m_bufferRingSize);
+        m_bufferRing = MAP_FAILED;
+    }
+    if (m_sqes != MAP_FAILED)
+    {
+        munmap(m_sqes, m_sqesSize);
+        m_sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    }
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+    {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = MAP_FAILED;
+    if (m_sqRing != MAP_FAILED)
+    {
+        munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = MAP_FAILED;
+    }
+}
+
+bool UringLoop::isSupported()
+{
+    try
+    {
+        UringLoop probe(8, 8, 64, 8);
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+void UringLoop::setupRings(unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+
+    m_ringFd = ioUringSetup(entries, &params);
+    if (m_ringFd < 0 && errno == EINVAL)
+    {
+        // Older kernels reject the optional setup flags, they are only an optimization.
+        memset(&params, 0, sizeof(params));
+        m_ringFd = ioUringSetup(entries, &params);
+    }
+    if (m_ringFd < 0)
+    {
+        throw std::runtime_error(std::string("Error creating io_uring: ") + strerror(errno));
+    }
+    if ((params.features & IORING_FEAT_EXT_ARG) == 0 || (params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        throw std::runtime_error("Error: io_uring lacks required features");
+    }
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    m_sqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    m_cqRingSize = m_sqRingSize;
+
+    m_sqRing =
+        mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED)
+    {
+        throw std::runtime_error("Error mapping io_uring rings");
+    }
+    m_cqRing = m_sqRing;
+
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = static_cast<struct io_uring_sqe*>(
+        mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES));
+    if (m_sqes == MAP_FAILED)
+    {
+        throw std::runtime_error("Error mapping io_uring submission entries");
+    }
+
+    char* sq = static_cast<char*>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqLocalTail = *m_sqTail;
+
+    // The indirection array is filled once with the identity, entries are then used in ring order.
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < m_sqEntries; ++i)
+    {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+void UringLoop::setupBuffers()
+{
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    m_bufferRingSize = (m_bufferCount * sizeof(struct io_uring_buf) + pageSize - 1) / pageSize * pageSize;
+    m_bufferRing = mmap(nullptr, m_bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m_bufferRing == MAP_FAILED)
+    {
+        throw std::runtime_error("Error allocating provided buffer ring");
+    }
+
+    struct io_uring_buf_reg registration;
+    memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64_t>(m_bufferRing);
+    registration.ring_entries = m_bufferCount;
+    registration.bgid = 0;
+    if (ioUringRegister(m_ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+    {
+        throw std::runtime_error(std::string("Error registering provided buffer ring: ") + strerror(errno));
+    }
+
+    m_buffers.resize(static_cast<size_t>(m_bufferCount) * m_bufferSize);
+    for (unsigned bufferId = 0; bufferId < m_bufferCount; ++bufferId)
+    {
+        recycleBuffer(static_cast<uint16_t>(bufferId));
+    }
+}
+
+void UringLoop::setupFiles()
+{
+    std::vector<int> sparse(m_maxFiles, -1);
+    if (ioUringRegister(m_ringFd, IORING_REGISTER_FILES, sparse.data(), m_maxFiles) < 0)
+    {
+        throw std::runtime_error(std::string("Error registering file table: ") + strerror(errno));
+    }
+
+    m_freeSlots.reserve(m_maxFiles);
+    for (unsigned slot = m_maxFiles; slot > 0; --slot)
+    {
+        m_freeSlots.push_back(static_cast<int>(slot - 1));
+    }
+}
+
+void UringLoop::recycleBuffer(uint16_t bufferId)
+{
+    auto* ring = static_cast<struct io_uring_buf*>(m_bufferRing);
+    struct io_uring_buf& buffer = ring[m_bufferTail & (m_bufferCount - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(m_buffers.data() + static_cast<size_t>(bufferId) * m_bufferSize);
+    buffer.len = m_bufferSize;
+    buffer.bid = bufferId;
+
+    // The ring tail overlays the reserved field of the first entry.
+    ++m_bufferTail;
+    __atomic_store_n(&ring[0].resv, m_bufferTail, __ATOMIC_RELEASE);
+}
+
+struct io_uring_sqe* UringLoop::nextSqe()
+{
+    unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (m_sqLocalTail - head >= m_sqEntries)
+    {
+        // Ring full: hand what is queued to the kernel without waiting.
+        enter(0, 0, false);
+        head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        if (m_sqLocalTail - head >= m_sqEntries)
+        {
+            throw std::runtime_error("Error: io_uring submission queue is full");
+        }
+    }
+
+    struct io_uring_sqe* sqe = &m_sqes[m_sqLocalTail & m_sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    ++m_sqLocalTail;
+    ++m_unsubmitted;
+    __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+void UringLoop::prepare(struct io_uring_sqe* sqe, Connection& connection, uint8_t opcode, Operation operation)
+{
+    sqe->opcode = opcode;
+    if (connection.slot >= 0)
+    {
+        sqe->fd = connection.slot;
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    else
+    {
+        sqe->fd = connection.fd;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(&connection) | static_cast<uint64_t>(operation);
+    ++connection.outstanding;
+}
+
+void UringLoop::submitAccept(Connection& connection)
+{
+    struct io_uring_sqe* sqe = nextSqe();
+    prepare(sqe, connection, IORING_OP_ACCEPT, Operation::Accept);
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void UringLoop::submitRecv(Connection& connection)
+{
+    struct io_uring_sqe* sqe = nextSqe();
+    prepare(sqe, connection, IORING_OP_RECV, Operation::Recv);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+}
+
+void UringLoop::submitSend(Connection& connection)
+{
+    if (connection.iov.empty())
+    {
+        // Gather the next batch of queued messages into a single sendmsg.
+        connection.inFlight.clear();
+        while (!connection.pending.empty() && connection.inFlight.size() < URING_MAX_SEND_BATCH)
+        {
+            connection.inFlight.push_back(std::move(connection.pending.front()));
+            connection.pending.pop_front();
+        }
+        for (std::string& message : connection.inFlight)
+        {
+            connection.iov.push_back({message.data(), message.size()});
+        }
+    }
+
+    memset(&connection.msg, 0, sizeof(connection.msg));
+    connection.msg.msg_iov = connection.iov.data();
+    connection.msg.msg_iovlen = connection.iov.size();
+
+    struct io_uring_sqe* sqe = nextSqe();
+    prepare(sqe, connection, IORING_OP_SENDMSG, Operation::Send);
+    sqe->addr = reinterpret_cast<uint64_t>(&connection.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    connection.sending = true;
+}
+
+void UringLoop::submitWake()
+{
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = m_wakeFd;
+    sqe->addr = reinterpret_cast<uint64_t>(&m_wakeValue);
+    sqe->len = sizeof(m_wakeValue);
+    sqe->user_data = static_cast<uint64_t>(Operation::Wake);
+}
+
+void UringLoop::submitCancel(Connection& connection)
+{
+    // Cancels the multishot accept or recv of the connection; a pending send is left to complete.
+    uint64_t target = reinterpret_cast<uint64_t>(&connection) |
+                      static_cast<uint64_t>(connection.listening ? Operation::Accept : Operation::Recv);
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = static_cast<uint64_t>(Operation::Cancel);
+}
+
+UringLoop::Connection& UringLoop::registerConnection(int fd, bool owned, bool listening)
+{
+    if (m_connections.count(fd) != 0)
+    {
+        throw std::invalid_argument("Error: socket already registered");
+    }
+
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->slot = -1;
+    connection->owned = owned;
+    connection->listening = listening;
+    connection->closed = false;
+    connection->sending = false;
+    connection->draining = false;
+    connection->outstanding = 0;
+
+    if (!m_freeSlots.empty())
+    {
+        int slot = m_freeSlots.back();
+        struct io_uring_files_update update;
+        memset(&update, 0, sizeof(update));
+        update.offset = static_cast<uint32_t>(slot);
+        update.fds = reinterpret_cast<uint64_t>(&fd);
+        if (ioUringRegister(m_ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1)
+        {
+            m_freeSlots.pop_back();
+            connection->slot = slot;
+        }
+    }
+
+    Connection& result = *connection;
+    m_connections.emplace(fd, std::move(connection));
+    return result;
+}
+
+void UringLoop::add(int fd, Handlers handlers)
+{
+    Connection& connection = registerConnection(fd, false, false);
+    connection.handlers = std::move(handlers);
+    submitRecv(connection);
+}
+
+void UringLoop::listen(IConnection& listener, Handlers clientHandlers, Callback onAccept)
+{
+    Connection& connection = registerConnection(listener.getSocket(), false, true);
+    connection.clientHandlers = std::move(clientHandlers);
+    connection.onAccept = std::move(onAccept);
+    submitAccept(connection);
+}
+
+bool UringLoop::send(int fd, std::string message)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end() || it->second->listening || it->second->draining)
+    {
+        return false;
+    }
+
+    Connection& connection = *it->second;
+    connection.pending.push_back(std::move(message));
+    ++m_stats.messages;
+    if (!connection.sending)
+    {
+        submitSend(connection);
+    }
+    return true;
+}
+
+void UringLoop::remove(int fd)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+    {
+        return;
+    }
+    // A reply queued just before the removal, typically after end of input, still reaches the peer.
+    Connection& connection = *it->second;
+    if (connection.sending || !connection.pending.empty())
+    {
+        connection.draining = true;
+        return;
+    }
+    closeConnection(connection, false);
+}
+
+void UringLoop::closeConnection(Connection& connection, bool notify)
+{
+    if (connection.closed)
+    {
+        return;
+    }
+    connection.closed = true;
+
+    if (notify && connection.handlers.onClosed)
+    {
+        connection.handlers.onClosed(connection.fd);
+    }
+
+    if (connection.outstanding > 0)
+    {
+        submitCancel(connection);
+    }
+
+    if (connection.slot >= 0)
+    {
+        // In-flight requests keep their own reference to the file, the slot can be reused right away.
+        int unused = -1;
+        struct io_uring_files_update update;
+        memset(&update, 0, sizeof(update));
+        update.offset = static_cast<uint32_t>(connection.slot);
+        update.fds = reinterpret_cast<uint64_t>(&unused);
+        ioUringRegister(m_ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+        m_freeSlots.push_back(connection.slot);
+        connection.slot = -1;
+    }
+
+    if (connection.owned)
+    {
+        ::close(connection.fd);
+    }
+
+    auto it = m_connections.find(connection.fd);
+    if (it != m_connections.end() && it->second.get() == &connection)
+    {
+        std::unique_ptr<Connection> retired = std::move(it->second);
+        m_connections.erase(it);
+        if (retired->outstanding > 0)
+        {
+            m_retired.emplace(retired.get(), std::move(retired));
+        }
+    }
+}
+
+void UringLoop::release(Connection& connection)
+{
+    --connection.outstanding;
+    if (connection.closed && connection.outstanding == 0)
+    {
+        m_retired.erase(&connection);
+    }
+}
+
+void UringLoop::handleAccept(Connection& connection, const struct io_uring_cqe& cqe)
+{
+    if (cqe.res >= 0 && !connection.closed)
+    {
+        int clientFd = cqe.res;
+        Connection& client = registerConnection(clientFd, true, false);
+        client.handlers = connection.clientHandlers;
+        submitRecv(client);
+        if (connection.onAccept)
+        {
+            connection.onAccept(clientFd);
+        }
+    }
+    else if (cqe.res >= 0)
+    {
+        ::close(cqe.res);
+    }
+
+    if ((cqe.flags & IORING_CQE_F_MORE) == 0 && !connection.closed)
+    {
+        submitAccept(connection);
+    }
+}
+
+void UringLoop::handleRecv(Connection& connection, const struct io_uring_cqe& cqe)
+{
+    if ((cqe.flags & IORING_CQE_F_BUFFER) != 0)
+    {
+        uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0 && !connection.closed && !connection.draining && connection.handlers.onData)
+        {
+            const char* data = m_buffers.data() + static_cast<size_t>(bufferId) * m_bufferSize;
+            connection.handlers.onData(connection.fd, std::string_view(data, static_cast<size_t>(cqe.res)));
+        }
+        recycleBuffer(bufferId);
+    }
+
+    if (connection.closed || (cqe.flags & IORING_CQE_F_MORE) != 0)
+    {
+        return;
+    }
+
+    // The multishot request ended: re-arm it unless the peer ended its input or the socket failed.
+    if (cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -EINTR)
+    {
+        submitRecv(connection);
+    }
+    else if (cqe.res == 0 && (connection.draining || connection.handlers.onData))
+    {
+        // End of input only: the handler may still reply and calls remove() once done. A socket already
+        // removed is released once its queued messages are written.
+        if (!connection.draining)
+        {
+            connection.handlers.onData(connection.fd, std::string_view());
+        }
+    }
+    else
+    {
+        closeConnection(connection, !connection.draining);
+    }
+}
+
+void UringLoop::handleSend(Connection& connection, const struct io_uring_cqe& cqe)
+{
+    connection.sending = false;
+    if (connection.closed)
+    {
+        return;
+    }
+    if (cqe.res < 0 && cqe.res != -EAGAIN && cqe.res != -EINTR)
+    {
+        closeConnection(connection, !connection.draining);
+        return;
+    }
+
+    // Drop the fully written iovecs and trim the partially written one.
+    size_t written = cqe.res > 0 ? static_cast<size_t>(cqe.res) : 0;
+    size_t consumed = 0;
+    while (consumed < connection.iov.size() && written >= connection.iov[consumed].iov_len)
+    {
+        written -= connection.iov[consumed].iov_len;
+        ++consumed;
+    }
+    connection.iov.erase(connection.iov.begin(), connection.iov.begin() + static_cast<std::ptrdiff_t>(consumed));
+    if (!connection.iov.empty())
+    {
+        connection.iov.front().iov_base = static_cast<char*>(connection.iov.front().iov_base) + written;
+        connection.iov.front().iov_len -= written;
+    }
+
+    if (!connection.iov.empty() || !connection.pending.empty())
+    {
+        submitSend(connection);
+    }
+    else if (connection.draining)
+    {
+        closeConnection(connection, false);
+    }
+}
+
+void UringLoop::handleCompletion(const struct io_uring_cqe& cqe)
+{
+    Operation operation = static_cast<Operation>(cqe.user_data & OPERATION_MASK);
+    if (operation == Operation::Wake)
+    {
+        submitWake();
+        return;
+    }
+    if (operation == Operation::Cancel)
+    {
+        return;
+    }
+
+    Connection& connection = *reinterpret_cast<Connection*>(cqe.user_data & ~OPERATION_MASK);
+    bool finished = (cqe.flags & IORING_CQE_F_MORE) == 0;
+
+    switch (operation)
+    {
+        case Operation::Accept: handleAccept(connection, cqe); break;
+        case Operation::Recv: handleRecv(connection, cqe); break;
+        case Operation::Send: handleSend(connection, cqe); break;
+        default: break;
+    }
+
+    if (finished)
+    {
+        release(connection);
+    }
+}
+
+int UringLoop::enter(unsigned minComplete, int timeoutMs, bool getEvents)
+{
+    unsigned flags = 0;
+    struct __kernel_timespec timeout;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+
+    // GETEVENTS also runs the deferred task work that posts completions (IORING_SETUP_COOP_TASKRUN).
+    if (getEvents)
+    {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if (minComplete > 0 && timeoutMs >= 0)
+        {
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64_t>(&timeout);
+        }
+    }
+
+    int result = ioUringEnter(m_ringFd,
+                              m_unsubmitted,
+                              minComplete,
+                              flags,
+                              (flags & IORING_ENTER_EXT_ARG) != 0 ? &arg : nullptr,
+                              (flags & IORING_ENTER_EXT_ARG) != 0 ? sizeof(arg) : 0);
+    ++m_stats.enterCalls;
+    if (result < 0)
+    {
+        if (errno == ETIME || errno == EINTR || errno == EBUSY || errno == EAGAIN)
+        {
+            return 0;
+        }
+        throw std::runtime_error(std::string("Error: io_uring_enter failed: ") + strerror(errno));
+    }
+
+    m_unsubmitted -= static_cast<unsigned>(result);
+    m_stats.submissions += static_cast<uint64_t>(result);
+    return result;
+}
+
+int UringLoop::runOnce(int timeoutMs)
+{
+    unsigned head = *m_cqHead;
+    bool empty = head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    if (empty || m_unsubmitted > 0)
+    {
+        enter(empty && timeoutMs != 0 ? 1 : 0, timeoutMs, true);
+    }
+
+    int processed = 0;
+    unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        // Copy the entry and free its slot first, handlers may queue new submissions.
+        struct io_uring_cqe cqe = m_cqes[head & m_cqMask];
+        ++head;
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+        handleCompletion(cqe);
+        ++processed;
+        tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    }
+
+    m_stats.completions += static_cast<uint64_t>(processed);
+    return processed;
+}
+
+void UringLoop::run()
+{
+    while (!m_stopRequested)
+    {
+        runOnce(-1);
+    }
+    m_stopRequested = false;
+}
+
+void UringLoop::stop()
+{
+    m_stopRequested = true;
+    uint64_t value = 1;
+    if (::write(m_wakeFd, &value, sizeof(value)) < 0)
+    {
+        // The counter is already non-zero, the loop will wake up anyway.
+    }
+}
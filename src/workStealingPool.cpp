@@ -0,0 +1,296 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "workStealingPool.hpp"
+
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    thread_local const WorkStealingPool* currentPool = nullptr; ///< Pool of the calling worker, if any.
+    thread_local size_t currentWorker = 0;                      ///< Index of the calling worker.
+} // namespace
+
+WorkStealingDeque::Array::Array(size_t capacity)
+    : mask(capacity - 1)
+    , slots(std::make_unique<std::atomic<Task*>[]>(capacity))
+{
+}
+
+WorkStealingDeque::WorkStealingDeque(size_t capacity)
+    : m_top(0)
+    , m_bottom(0)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        throw std::invalid_argument("Error: deque capacity must be a power of two");
+    }
+    m_arrays.push_back(std::make_unique<Array>(capacity));
+    m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+    while (Task* task = pop())
+    {
+        delete task;
+    }
+}
+
+WorkStealingDeque::Array* WorkStealingDeque::grow(Array* array, int64_t top, int64_t bottom)
+{
+    auto bigger = std::make_unique<Array>((array->mask + 1) * 2);
+    for (int64_t i = top; i < bottom; ++i)
+    {
+        bigger->slots[i & bigger->mask].store(array->slots[i & array->mask].load(std::memory_order_relaxed),
+                                              std::memory_order_relaxed);
+    }
+    m_arrays.push_back(std::move(bigger));
+    Array* current = m_arrays.back().get();
+    m_array.store(current, std::memory_order_release);
+    return current;
+}
+
+void WorkStealingDeque::push(Task* task)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    Array* array = m_array.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(array->mask))
+    {
+        array = grow(array, top, bottom);
+    }
+    array->slots[bottom & array->mask].store(task, std::memory_order_relaxed);
+    // Publishes the task to thieves, which read the bottom with acquire.
+    m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+Task* WorkStealingDeque::pop()
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    Array* array = m_array.load(std::memory_order_relaxed);
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty: restore the bottom.
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Task* task = array->slots[bottom & array->mask].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last task: race the thieves for it.
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            task = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+Task* WorkStealingDeque::steal()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Array* array = m_array.load(std::memory_order_acquire);
+    Task* task = array->slots[top & array->mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return task;
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : m_queued(0)
+    , m_pending(0)
+    , m_sleeping(0)
+    , m_stopping(false)
+    , m_executed(0)
+    , m_stolen(0)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Every deque exists before the first worker starts stealing.
+    for (size_t i = 0; i < threads; ++i)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; ++i)
+    {
+        m_workers[i]->thread = std::thread([this, i] { work(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    waitIdle();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker->thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    auto* queued = new Task(std::move(task));
+    m_pending.fetch_add(1);
+    // Counted before it is visible so a worker never takes more tasks than m_queued announces.
+    m_queued.fetch_add(1);
+
+    if (currentPool == this)
+    {
+        m_workers[currentWorker]->deque.push(queued);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injectMutex);
+        m_injected.push_back(queued);
+    }
+
+    // Pairs with the sleeping count taken before a worker checks m_queued, so no wakeup is lost.
+    if (m_sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+    }
+}
+
+Task* WorkStealingPool::take(size_t index)
+{
+    if (Task* task = m_workers[index]->deque.pop())
+    {
+        return task;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_injectMutex);
+        if (!m_injected.empty())
+        {
+            Task* task = m_injected.front();
+            m_injected.pop_front();
+            return task;
+        }
+    }
+
+    thread_local std::minstd_rand random(static_cast<unsigned>(index + 1));
+    const size_t count = m_workers.size();
+    const size_t start = random() % count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t victim = (start + i) % count;
+        if (victim == index)
+        {
+            continue;
+        }
+        if (Task* task = m_workers[victim]->deque.steal())
+        {
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::work(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (true)
+    {
+        if (std::unique_ptr<Task> task {take(index)})
+        {
+            m_queued.fetch_sub(1);
+            try
+            {
+                (*task)();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_error)
+                {
+                    m_error = std::current_exception();
+                }
+            }
+            task.reset();
+            m_executed.fetch_add(1, std::memory_order_relaxed);
+            finish();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+        m_sleeping.fetch_sub(1);
+        if (m_stopping && m_queued.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::finish()
+{
+    if (m_pending.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_idle.notify_all();
+    }
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending.load() == 0; });
+    if (m_error)
+    {
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+}
+
+void WorkStealingPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+WorkStealingPool::Counters WorkStealingPool::counters() const
+{
+    return Counters {m_executed.load(std::memory_order_relaxed), m_stolen.load(std::memory_order_relaxed)};
+}
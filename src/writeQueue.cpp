@@ -0,0 +1,221 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "writeQueue.hpp"
+
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+namespace
+{
+    constexpr auto WRITE_QUEUE_IOV = 16; // Chunks or parts gathered by one sendmsg without allocating.
+
+    /**
+     * @brief Write once with sendmsg.
+     *
+     * @return size_t Bytes written, 0 when the socket is full. Any other failure throws.
+     */
+    size_t writeOnce(int socket, struct iovec* iov, size_t count, ConnectionMetrics* metrics)
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        while (true)
+        {
+            ssize_t sentBytes = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+            ConnectionMetrics::add(metrics, &ConnectionMetrics::syscalls);
+            if (sentBytes >= 0)
+            {
+                size_t requested = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    requested += iov[i].iov_len;
+                }
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::bytesSent, static_cast<uint64_t>(sentBytes));
+                if (static_cast<size_t>(sentBytes) < requested)
+                {
+                    ConnectionMetrics::add(metrics, &ConnectionMetrics::partialWrites);
+                }
+                return static_cast<size_t>(sentBytes);
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::wouldBlock);
+                return 0;
+            }
+            if (errno != EINTR)
+            {
+                ConnectionMetrics::add(metrics, &ConnectionMetrics::errors);
+                throw std::runtime_error(std::string("Error: message sending failure: ") + strerror(errno));
+            }
+        }
+    }
+} // namespace
+
+WriteQueue::WriteQueue(int socket, size_t highWatermark, size_t lowWatermark)
+    : m_socket(socket)
+    , m_offset(0)
+    , m_pending(0)
+    , m_throttled(false)
+    , m_metrics(nullptr)
+{
+    setWatermarks(highWatermark, lowWatermark);
+}
+
+void WriteQueue::setWatermarks(size_t highWatermark, size_t lowWatermark)
+{
+    if (lowWatermark > highWatermark)
+    {
+        throw std::invalid_argument("Error: low watermark above the high watermark");
+    }
+    m_highWatermark = highWatermark;
+    m_lowWatermark = lowWatermark;
+}
+
+void WriteQueue::setCallbacks(Callback onHighWatermark, Callback onLowWatermark)
+{
+    m_onHighWatermark = std::move(onHighWatermark);
+    m_onLowWatermark = std::move(onLowWatermark);
+}
+
+bool WriteQueue::write(std::string_view data)
+{
+    return write(std::span<const std::string_view>(&data, 1));
+}
+
+bool WriteQueue::write(std::span<const std::string_view> parts)
+{
+    if (m_throttled)
+    {
+        return false;
+    }
+    if (parts.size() > IOV_MAX)
+    {
+        throw std::invalid_argument("Error: too many message parts");
+    }
+
+    // Bytes only go straight to the socket when nothing older is waiting.
+    size_t written = 0;
+    if (m_chunks.empty())
+    {
+        std::array<struct iovec, WRITE_QUEUE_IOV> inlineIov;
+        std::vector<struct iovec> heapIov;
+        struct iovec* iov = inlineIov.data();
+        if (parts.size() > inlineIov.size())
+        {
+            heapIov.resize(parts.size());
+            iov = heapIov.data();
+        }
+
+        size_t count = 0;
+        for (const std::string_view& part : parts)
+        {
+            if (!part.empty())
+            {
+                iov[count++] = {const_cast<char*>(part.data()), part.size()};
+            }
+        }
+        written = count > 0 ? writeOnce(m_socket, iov, count, m_metrics) : 0;
+    }
+
+    ConnectionMetrics::add(m_metrics, &ConnectionMetrics::messagesSent);
+
+    std::string rest;
+    for (const std::string_view& part : parts)
+    {
+        if (written >= part.size())
+        {
+            written -= part.size();
+            continue;
+        }
+        rest.append(part.substr(written));
+        written = 0;
+    }
+    if (rest.empty())
+    {
+        return true;
+    }
+
+    m_pending += rest.size();
+    m_chunks.push_back(std::move(rest));
+    if (m_pending >= m_highWatermark)
+    {
+        m_throttled = true;
+        if (m_onHighWatermark)
+        {
+            m_onHighWatermark();
+        }
+    }
+    return true;
+}
+
+size_t WriteQueue::flush()
+{
+    size_t total = 0;
+    while (!m_chunks.empty())
+    {
+        std::array<struct iovec, WRITE_QUEUE_IOV> iov;
+        size_t count = 0;
+        for (auto it = m_chunks.begin(); it != m_chunks.end() && count < iov.size(); ++it)
+        {
+            size_t skip = count == 0 ? m_offset : 0;
+            iov[count++] = {it->data() + skip, it->size() - skip};
+        }
+
+        size_t written = writeOnce(m_socket, iov.data(), count, m_metrics);
+        if (written == 0)
+        {
+            break;
+        }
+        consume(written);
+        total += written;
+    }
+
+    if (m_throttled && m_pending <= m_lowWatermark)
+    {
+        m_throttled = false;
+        if (m_onLowWatermark)
+        {
+            m_onLowWatermark();
+        }
+    }
+    return total;
+}
+
+void WriteQueue::consume(size_t bytes)
+{
+    m_pending -= bytes;
+    while (bytes > 0)
+    {
+        size_t left = m_chunks.front().size() - m_offset;
+        if (bytes < left)
+        {
+            m_offset += bytes;
+            return;
+        }
+        bytes -= left;
+        m_offset = 0;
+        m_chunks.pop_front();
+    }
+}
@@ -0,0 +1,255 @@
+/*
+ * Socket Library - cppSocketWrapper
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#include "zeroCopySender.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <linux/errqueue.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+ZeroCopySender::ZeroCopySender(IConnection& connection, int socket, size_t threshold)
+    : m_connection(connection)
+    , m_socket(socket < 0 ? connection.getSocket() : socket)
+    , m_threshold(threshold)
+    , m_enabled(false)
+    , m_nextId(0)
+    , m_counters {}
+{
+    int value = 1;
+    m_enabled = setsockopt(m_socket, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == 0;
+}
+
+bool ZeroCopySender::send(std::string_view buffer, Completion onComplete)
+{
+    if (!m_enabled || buffer.size() < m_threshold)
+    {
+        std::array<std::string_view, 1> parts = {buffer};
+        bool sent = m_socket == m_connection.getSocket() ? m_connection.send(parts)
+                                                         : m_connection.sendto(parts, m_socket);
+        if (sent)
+        {
+            ++m_counters.copiedSends;
+            if (onComplete)
+            {
+                onComplete(true);
+            }
+        }
+        return sent;
+    }
+
+    // Bytes queued by earlier copying sends must reach the socket before this payload.
+    WriteQueue* queue = m_socket == m_connection.getSocket() ? m_connection.writeQueue() : nullptr;
+    if (queue != nullptr)
+    {
+        queue->flush();
+        if (queue->pending() > 0)
+        {
+            return false;
+        }
+    }
+
+    const uint64_t firstId = m_nextId;
+    size_t offset = 0;
+    while (offset < buffer.size())
+    {
+        struct iovec iov = {const_cast<char*>(buffer.data() + offset), buffer.size() - offset};
+        struct msghdr msg {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        ssize_t sent = sendmsg(m_socket, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (sent < 0 && errno == ENOBUFS)
+        {
+            // Out of optmem for pinned pages: this chunk takes the copying path.
+            sent = ::send(m_socket, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+        }
+        else if (sent > 0)
+        {
+            ++m_nextId;
+            ++m_counters.zeroCopySends;
+        }
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                struct pollfd descriptor = {m_socket, POLLOUT, 0};
+                if (poll(&descriptor, 1, -1) > 0 && (descriptor.revents & POLLERR))
+                {
+                    pollCompletions(0);
+                }
+                continue;
+            }
+            throw std::runtime_error("Error: sendmsg failed: " + std::string(std::strerror(errno)));
+        }
+        offset += static_cast<size_t>(sent);
+    }
+
+    if (m_nextId == firstId)
+    {
+        ++m_counters.copiedSends;
+        if (onComplete)
+        {
+            onComplete(true);
+        }
+        return true;
+    }
+
+    m_pending.push_back({firstId, m_nextId - 1, 0, false, std::move(onComplete)});
+    return true;
+}
+
+std::future<bool> ZeroCopySender::send(std::string_view buffer)
+{
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    if (!send(buffer, [promise](bool copied) { promise->set_value(copied); }))
+    {
+        promise->set_exception(
+            std::make_exception_ptr(std::runtime_error("Error: payload not sent, the write queue is busy")));
+    }
+    return future;
+}
+
+size_t ZeroCopySender::pollCompletions(int timeoutMs)
+{
+    size_t completed = 0;
+    bool polled = false;
+    short revents = 0;
+    while (true)
+    {
+        std::array<char, CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_storage))> control;
+        struct msghdr msg {};
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        if (recvmsg(m_socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                throw std::runtime_error("Error: recvmsg on the error queue failed: " +
+                                         std::string(std::strerror(errno)));
+            }
+            if (polled)
+            {
+                // Woken up without a notification: the connection itself failed.
+                int socketError = 0;
+                socklen_t length = sizeof(socketError);
+                getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &socketError, &length);
+                if (socketError != 0 || (revents & (POLLHUP | POLLNVAL)))
+                {
+                    throw std::runtime_error("Error: connection failed with zero-copy sends pending");
+                }
+            }
+            if (polled || completed > 0 || timeoutMs == 0 || m_pending.empty())
+            {
+                return completed;
+            }
+
+            // Only POLLERR is requested: it is raised as soon as the error queue has an entry.
+            struct pollfd descriptor = {m_socket, 0, 0};
+            if (poll(&descriptor, 1, timeoutMs) <= 0)
+            {
+                return completed;
+            }
+            polled = true;
+            revents = descriptor.revents;
+            continue;
+        }
+
+        for (struct cmsghdr* header = CMSG_FIRSTHDR(&msg); header != nullptr; header = CMSG_NXTHDR(&msg, header))
+        {
+            if (!((header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+                  (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+
+            struct sock_extended_err error;
+            std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+            if (error.ee_errno != 0 || error.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // The kernel reports 32-bit ids; they always lie shortly before the next id to be given.
+            auto widen = [this](uint32_t id) {
+                return m_nextId - static_cast<uint32_t>(static_cast<uint32_t>(m_nextId) - id);
+            };
+            const bool copied = (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+            completed += complete(widen(error.ee_info), widen(error.ee_data), copied);
+        }
+    }
+}
+
+void ZeroCopySender::flush()
+{
+    while (!m_pending.empty())
+    {
+        pollCompletions(-1);
+    }
+}
+
+size_t ZeroCopySender::complete(uint64_t first, uint64_t last, bool copied)
+{
+    // The kernel may merge consecutive notifications, so a range can finish several sends at once.
+    std::vector<std::pair<Completion, bool>> finished;
+    for (auto it = m_pending.begin(); it != m_pending.end() && it->firstId <= last;)
+    {
+        uint64_t from = std::max(first, it->firstId);
+        uint64_t to = std::min(last, it->lastId);
+        if (from <= to)
+        {
+            it->completedIds += to - from + 1;
+            it->copied = it->copied || copied;
+        }
+
+        if (it->completedIds == it->lastId - it->firstId + 1)
+        {
+            if (it->copied)
+            {
+                ++m_counters.kernelCopies;
+            }
+            finished.emplace_back(std::move(it->onComplete), it->copied);
+            it = m_pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Callbacks run last: they may reuse the buffer for another send().
+    for (auto& [onComplete, wasCopied] : finished)
+    {
+        if (onComplete)
+        {
+            onComplete(wasCopied);
+        }
+    }
+    return finished.size();
+}
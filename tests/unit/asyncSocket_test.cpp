@@ -0,0 +1,236 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef ASYNC_SOCKET_TEST_HPP
+#define ASYNC_SOCKET_TEST_HPP
+
+#include "asyncSocket.hpp"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+namespace
+{
+    // Echo every message back until the client closes.
+    AsyncTask<void> echoSession(std::unique_ptr<AsyncSocket> client, int& open)
+    {
+        std::array<std::byte, 1024> buffer;
+        while (size_t bytes = co_await client->asyncReceive(buffer))
+        {
+            std::string_view message(reinterpret_cast<const char*>(buffer.data()), bytes);
+            co_await client->asyncSend(message);
+        }
+        --open;
+    }
+
+    // Accept clients until cancelled, one echo session each.
+    AsyncTask<void> acceptLoop(AsyncSocket& listener, int& open)
+    {
+        while (true)
+        {
+            auto client = co_await listener.asyncAccept();
+            ++open;
+            spawn(echoSession(std::move(client), open));
+        }
+    }
+
+    // Connect, send a greeting and read the echo.
+    AsyncTask<std::string> greet(EventLoop& loop, const std::string& port, std::string greeting)
+    {
+        TCPv4Connection connection("127.0.0.1", port, true);
+        AsyncSocket client(loop, connection);
+        co_await client.asyncConnect(std::chrono::milliseconds(1000));
+        co_await client.asyncSend(greeting);
+
+        std::string reply;
+        std::array<std::byte, 1024> buffer;
+        while (reply.size() < greeting.size())
+        {
+            size_t bytes = co_await client.asyncReceive(buffer, std::chrono::milliseconds(1000));
+            if (bytes == 0)
+            {
+                break;
+            }
+            reply.append(reinterpret_cast<const char*>(buffer.data()), bytes);
+        }
+        co_return reply;
+    }
+
+    // One client session, counting the echoes that match.
+    AsyncTask<void> countEcho(EventLoop& loop, std::string port, int index, int& matched, int& finished)
+    {
+        std::string greeting = "Hello, " + std::to_string(index) + "!";
+        std::string reply = co_await greet(loop, port, greeting);
+        matched += reply == greeting ? 1 : 0;
+        ++finished;
+    }
+
+    void runUntil(EventLoop& loop, const std::function<bool()>& done)
+    {
+        for (int i = 0; i < 500 && !done(); ++i)
+        {
+            loop.runOnce(10);
+        }
+    }
+} // namespace
+
+// Test to verify straight-line coroutines connect, accept, send and receive on one loop
+TEST(AsyncSocketTest, EchoSessions)
+{
+    EventLoop loop;
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    AsyncSocket listener(loop, server);
+    int open = 0;
+    spawn(acceptLoop(listener, open));
+
+    constexpr int sessions = 200;
+    int matched = 0;
+    int finished = 0;
+    for (int i = 0; i < sessions; ++i)
+    {
+        spawn(countEcho(loop, server.GetPort(), i, matched, finished));
+    }
+
+    runUntil(loop, [&] { return finished == sessions; });
+    EXPECT_EQ(finished, sessions);
+    EXPECT_EQ(matched, sessions);
+
+    // The server sessions end once they read the end of stream of their client.
+    runUntil(loop, [&] { return open == 0; });
+    EXPECT_EQ(open, 0);
+    listener.cancel();
+}
+
+// Test to verify an operation fails with AsyncTimeoutError once its timeout expires
+TEST(AsyncSocketTest, ReceiveTimeout)
+{
+    EventLoop loop;
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection connection("127.0.0.1", server.GetPort(), true);
+    connection.connect();
+    int serverFd = server.connect();
+
+    AsyncSocket client(loop, connection);
+    bool timedOut = false;
+    auto start = std::chrono::steady_clock::now();
+    auto receive = [&]() -> AsyncTask<void>
+    {
+        std::array<std::byte, 16> buffer;
+        try
+        {
+            co_await client.asyncReceive(buffer, std::chrono::milliseconds(50));
+        }
+        catch (const AsyncTimeoutError&)
+        {
+            timedOut = true;
+        }
+    };
+    spawn(receive());
+
+    runUntil(loop, [&] { return timedOut; });
+    EXPECT_TRUE(timedOut);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    ::close(serverFd);
+}
+
+// Test to verify a half-closed peer does not close the socket: a reply larger than the buffers still completes
+TEST(AsyncSocketTest, ReplyAfterHalfClose)
+{
+    EventLoop loop;
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection connection("127.0.0.1", server.GetPort(), true);
+    connection.connect();
+    AsyncSocket session(loop, server.connect(), true);
+
+    connection.send("request");
+    ::shutdown(connection.getSocket(), SHUT_WR);
+
+    const std::string reply(4 * 1024 * 1024, 'r');
+    std::string request;
+    size_t sent = 0;
+    std::exception_ptr error;
+    auto serve = [&]() -> AsyncTask<void>
+    {
+        std::array<std::byte, 64> buffer;
+        while (size_t bytes = co_await session.asyncReceive(buffer))
+        {
+            request.append(reinterpret_cast<const char*>(buffer.data()), bytes);
+        }
+        sent = co_await session.asyncSend(reply);
+    };
+    spawn(serve(), [&error](std::exception_ptr exception) { error = exception; });
+
+    std::string received;
+    std::thread reader(
+        [&]
+        {
+            std::vector<std::byte> buffer(65536);
+            while (received.size() < reply.size())
+            {
+                ssize_t bytes = ::recv(connection.getSocket(), buffer.data(), buffer.size(), 0);
+                if (bytes <= 0)
+                {
+                    break;
+                }
+                received.append(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(bytes));
+            }
+        });
+    runUntil(loop, [&] { return sent > 0 || error != nullptr; });
+    if (sent == 0)
+    {
+        ::shutdown(connection.getSocket(), SHUT_RD);
+    }
+    reader.join();
+
+    EXPECT_EQ(error, nullptr);
+    EXPECT_EQ(request, "request");
+    EXPECT_EQ(sent, reply.size());
+    EXPECT_EQ(received.size(), reply.size());
+}
+
+// Test to verify cancel() interrupts a suspended operation and asyncSleep() resumes after its delay
+TEST(AsyncSocketTest, CancelAndSleep)
+{
+    EventLoop loop;
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    AsyncSocket listener(loop, server);
+
+    // The lambdas outlive their coroutines: a coroutine lambda only refers to its captures.
+    std::exception_ptr error;
+    auto accept = [&]() -> AsyncTask<void> { co_await listener.asyncAccept(); };
+    spawn(accept(), [&error](std::exception_ptr exception) { error = exception; });
+
+    bool slept = false;
+    auto sleeper = [&]() -> AsyncTask<void>
+    {
+        co_await asyncSleep(loop, std::chrono::milliseconds(20));
+        slept = true;
+        listener.cancel();
+    };
+    spawn(sleeper());
+
+    runUntil(loop, [&] { return error != nullptr; });
+    EXPECT_TRUE(slept);
+    ASSERT_NE(error, nullptr);
+    EXPECT_THROW(std::rethrow_exception(error), AsyncCanceledError);
+}
+
+#endif // ASYNC_SOCKET_TEST_HPP
@@ -0,0 +1,147 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef BUFFER_POOL_TEST_HPP
+#define BUFFER_POOL_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+#include <future>
+
+// Test to verify the pool stops allocating once its working set is reached
+TEST(BufferPoolTest, SteadyStateDoesNotAllocate)
+{
+    BufferPool pool(4096, 16, 8);
+
+    std::vector<PooledBuffer> inFlight;
+    for (int i = 0; i < 32; ++i)
+    {
+        inFlight.push_back(pool.acquire());
+    }
+    inFlight.clear();
+
+    const uint64_t warmChunks = pool.counters().chunkAllocations;
+    for (int round = 0; round < 1000; ++round)
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+            inFlight.push_back(pool.acquire());
+        }
+        inFlight.clear();
+    }
+
+    BufferPool::Counters counters = pool.counters();
+    EXPECT_EQ(counters.chunkAllocations, warmChunks);
+    EXPECT_EQ(counters.acquisitions, counters.releases);
+    EXPECT_GT(counters.cacheHits, 0u);
+}
+
+// Test to verify handles expose the slab and move ownership
+TEST(BufferPoolTest, HandleOwnership)
+{
+    BufferPool pool(64);
+
+    PooledBuffer first = pool.acquire();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.capacity(), 64u);
+    EXPECT_EQ(first.size(), 0u);
+
+    std::memcpy(first.data(), "pooled", 6);
+    first.resize(6);
+    EXPECT_EQ(first.view(), "pooled");
+    EXPECT_THROW(first.resize(65), std::out_of_range);
+
+    PooledBuffer second = std::move(first);
+    EXPECT_FALSE(first);
+    EXPECT_EQ(second.view(), "pooled");
+
+    second.reset();
+    EXPECT_FALSE(second);
+    EXPECT_EQ(pool.counters().releases, 1u);
+}
+
+// Test to verify buffers acquired on one thread can be released on another and reused
+TEST(BufferPoolTest, CrossThreadRelease)
+{
+    BufferPool pool(1024, 8, 4);
+
+    for (int round = 0; round < 50; ++round)
+    {
+        std::vector<PooledBuffer> buffers;
+        for (int i = 0; i < 16; ++i)
+        {
+            buffers.push_back(pool.acquire());
+        }
+        std::thread consumer([batch = std::move(buffers)]() mutable { batch.clear(); });
+        consumer.join();
+    }
+
+    BufferPool::Counters counters = pool.counters();
+    EXPECT_EQ(counters.acquisitions, counters.releases);
+    EXPECT_LE(counters.chunkAllocations, 4u);
+}
+
+// Test to verify a thread without a cache hands released buffers to the shared list, where others reuse them
+TEST(BufferPoolTest, ReleaseFromThreadWithoutCache)
+{
+    BufferPool pool(64, 1, 4);
+    PooledBuffer buffer = pool.acquire();
+
+    std::promise<void> released;
+    std::promise<void> done;
+    std::thread releaser(
+        [&, owned = std::move(buffer)]() mutable
+        {
+            owned.reset();
+            released.set_value();
+            done.get_future().wait();
+        });
+
+    // The releasing thread is still alive: its slab must already be in the shared list.
+    released.get_future().wait();
+    PooledBuffer reused = pool.acquire();
+    done.set_value();
+    releaser.join();
+
+    EXPECT_TRUE(reused);
+    EXPECT_EQ(pool.counters().chunkAllocations, 1u);
+}
+
+// Test to verify a message is received into a pooled buffer
+TEST(BufferPoolTest, ReceivePooled)
+{
+    BufferPool pool(MAX_MESSAGE_LENGTH);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    client.send("Hello, pool!");
+    PooledBuffer message = server.receivePooledFrom(serverFd, pool);
+    ASSERT_TRUE(message);
+    EXPECT_EQ(message.view(), "Hello, pool!");
+
+    server.sendto("Hello, client!", serverFd);
+    EXPECT_EQ(client.receivePooled(pool).view(), "Hello, client!");
+
+    ::close(serverFd);
+    EXPECT_FALSE(client.receivePooled(pool));
+}
+
+#endif // BUFFER_POOL_TEST_HPP
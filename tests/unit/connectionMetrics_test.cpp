@@ -0,0 +1,101 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef CONNECTION_METRICS_TEST_HPP
+#define CONNECTION_METRICS_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify every value lands in a bucket whose bound is within 12.5% of it
+TEST(ConnectionMetricsTest, HistogramBuckets)
+{
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 123456789ull, ~0ull})
+    {
+        size_t index = LatencyHistogram::bucketIndex(value);
+        ASSERT_LT(index, static_cast<size_t>(HISTOGRAM_BUCKETS));
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(index), value);
+        EXPECT_LE(LatencyHistogram::bucketUpperBound(index) - value, value / 8);
+    }
+
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.record(value * 1000);
+    }
+    HistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.max, 1000000u);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.5)), 500000.0, 500000.0 / 8);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.99)), 990000.0, 990000.0 / 8);
+    EXPECT_EQ(snapshot.percentile(1.0), 1000000u);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.snapshot().percentile(0.5), 0u);
+}
+
+// Test to verify a listener counts the traffic of every accepted socket, and the Prometheus export
+TEST(ConnectionMetricsTest, ListenerAggregate)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    EXPECT_EQ(server.metrics(), nullptr);
+    ConnectionMetrics& serverMetrics = server.enableMetrics();
+
+    TCPv4Connection first("127.0.0.1", server.GetPort(), true);
+    first.connect();
+    int firstFd = server.connect();
+    TCPv4Connection second("127.0.0.1", server.GetPort(), true);
+    second.connect();
+    int secondFd = server.connect();
+
+    ConnectionMetrics& clientMetrics = first.enableMetrics();
+    first.send("hello");
+    second.send("world!");
+    EXPECT_EQ(server.receiveFrom(firstFd), "hello");
+    EXPECT_EQ(server.receiveFrom(secondFd), "world!");
+    server.sendto("ok", firstFd);
+    EXPECT_EQ(first.receive(), "ok");
+
+    MetricsSnapshot snapshot = serverMetrics.snapshot();
+    EXPECT_EQ(snapshot.messagesReceived, 2u);
+    EXPECT_EQ(snapshot.bytesReceived, 11u);
+    EXPECT_EQ(snapshot.messagesSent, 1u);
+    EXPECT_EQ(snapshot.bytesSent, 2u);
+    EXPECT_EQ(snapshot.syscalls, 3u);
+    EXPECT_EQ(snapshot.receiveLatency.count, 2u);
+    EXPECT_EQ(snapshot.sendLatency.count, 1u);
+    EXPECT_EQ(snapshot.errors, 0u);
+
+    MetricsSnapshot total = snapshot;
+    total += clientMetrics.snapshot();
+    EXPECT_EQ(total.bytesSent, 7u);
+    EXPECT_EQ(total.receiveLatency.count, 3u);
+
+    std::string text = total.toPrometheus("net", "listener=\"test\"");
+    EXPECT_NE(text.find("# TYPE net_bytes_sent_total counter\nnet_bytes_sent_total{listener=\"test\"} 7\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("net_receive_latency_seconds{listener=\"test\",quantile=\"0.99\"}"), std::string::npos);
+    EXPECT_NE(text.find("net_send_latency_seconds_count{listener=\"test\"} 2\n"), std::string::npos);
+
+    serverMetrics.reset();
+    EXPECT_EQ(serverMetrics.snapshot().syscalls, 0u);
+
+    ::close(firstFd);
+    ::close(secondFd);
+}
+
+#endif // CONNECTION_METRICS_TEST_HPP
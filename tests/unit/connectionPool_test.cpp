@@ -0,0 +1,125 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef CONNECTION_POOL_TEST_HPP
+#define CONNECTION_POOL_TEST_HPP
+
+#include "connectionPool.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify a returned connection is reused for the next request to the same endpoint
+TEST(ConnectionPoolTest, ReuseIdleConnection)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    ConnectionPool pool;
+
+    IConnection* first = nullptr;
+    int serverFd = -1;
+    {
+        ConnectionPool::Lease lease = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+        ASSERT_TRUE(lease);
+        first = lease.get();
+        serverFd = server.connect();
+        lease->send("request");
+        EXPECT_EQ(server.receiveFrom(serverFd), "request");
+        server.sendto("response", serverFd);
+        EXPECT_EQ(lease->receive(), "response");
+    }
+    EXPECT_EQ(pool.idleCount(), 1u);
+
+    {
+        ConnectionPool::Lease lease = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+        EXPECT_EQ(lease.get(), first);
+        lease->send("again");
+        EXPECT_EQ(server.receiveFrom(serverFd), "again");
+    }
+
+    ConnectionPool::Counters counters = pool.counters();
+    EXPECT_EQ(counters.created, 1u);
+    EXPECT_EQ(counters.reused, 1u);
+    ::close(serverFd);
+}
+
+// Test to verify an idle connection closed by the server is replaced on checkout
+TEST(ConnectionPoolTest, HealthCheckDropsClosedConnection)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    ConnectionPool pool;
+
+    pool.acquire("127.0.0.1", server.GetPort(), TCP).release();
+    int serverFd = server.connect();
+    ::close(serverFd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    ConnectionPool::Lease lease = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+    ASSERT_TRUE(lease);
+
+    ConnectionPool::Counters counters = pool.counters();
+    EXPECT_EQ(counters.failedChecks, 1u);
+    EXPECT_EQ(counters.created, 2u);
+    EXPECT_EQ(counters.reused, 0u);
+}
+
+// Test to verify callers wait for a slot when the endpoint is at its limit
+TEST(ConnectionPoolTest, MaxPerEndpoint)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    ConnectionPool pool(1);
+
+    ConnectionPool::Lease held = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+    EXPECT_THROW(pool.acquire("127.0.0.1", server.GetPort(), TCP, std::chrono::milliseconds(20)), std::runtime_error);
+
+    IConnection* heldConnection = held.get();
+    std::thread releaser(
+        [&held]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            held.release();
+        });
+    ConnectionPool::Lease waited = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+    releaser.join();
+
+    EXPECT_EQ(waited.get(), heldConnection);
+    EXPECT_EQ(pool.counters().created, 1u);
+}
+
+// Test to verify idle connections are closed after the idle timeout and discarded leases are not kept
+TEST(ConnectionPoolTest, IdleEvictionAndDiscard)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    ConnectionPool pool(4, std::chrono::milliseconds(10));
+
+    pool.acquire("127.0.0.1", server.GetPort(), TCP).release();
+    pool.acquire("127.0.0.1", server.GetPort(), TCP).discard();
+    EXPECT_EQ(pool.idleCount(), 0u);
+
+    ConnectionPool::Lease first = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+    ConnectionPool::Lease second = pool.acquire("127.0.0.1", server.GetPort(), TCP);
+    first.release();
+    second.release();
+    EXPECT_EQ(pool.idleCount(), 2u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(pool.evictIdle(), 2u);
+    EXPECT_EQ(pool.idleCount(), 0u);
+    EXPECT_EQ(pool.counters().evicted, 2u);
+}
+
+#endif // CONNECTION_POOL_TEST_HPP
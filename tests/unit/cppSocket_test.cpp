@@ -20,6 +20,13 @@
 #include "cppSocket.hpp"
 #include "gtest/gtest.h"
 
+#include <array>
+#include <fcntl.h>
+#include <poll.h>
+#include <set>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
 TEST(TCPConnectionTestIPv4, BindSuccess)
 {
     GTEST_SKIP();
@@ -98,4 +105,960 @@ TEST(UDPConnectionTestIPv4, ConnectFailure)
     EXPECT_EQ(0, 0);
 }
 
+// Test to verify receiving into a caller-owned buffer
+TEST(ZeroCopyReceiveTest, ReceiveIntoSpan)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    client.send("Hello, span!");
+
+    std::array<std::byte, 64> buffer;
+    ssize_t bytes = server.receiveFrom(serverFd, buffer);
+    ASSERT_EQ(bytes, 12);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(buffer.data()), bytes), "Hello, span!");
+
+    ::close(serverFd);
+    EXPECT_EQ(client.receive(buffer), 0);
+}
+
+// Test to verify the view points into the connection buffer and is reused
+TEST(ZeroCopyReceiveTest, ReceiveView)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    ::send(serverFd, "first", 5, 0);
+    std::string_view first = client.receiveView();
+    EXPECT_EQ(first, "first");
+
+    ::send(serverFd, "second", 6, 0);
+    std::string_view second = client.receiveView();
+    EXPECT_EQ(second, "second");
+    EXPECT_EQ(first.data(), second.data());
+
+    ::close(serverFd);
+}
+
+// Test to verify UDP datagrams are received with their full length
+TEST(ZeroCopyReceiveTest, UDPReceive)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    client.send("datagram");
+
+    EXPECT_EQ(server.receive(), "datagram");
+}
+
+// Test to verify a large multi-part frame arrives complete and in order
+TEST(VectoredSendTest, LargeFrame)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    const std::string header = "HDR:";
+    const std::string payload(4 * 1024 * 1024, 'p');
+    std::vector<std::string_view> parts(20, "-");
+    parts.front() = header;
+    parts.back() = payload;
+
+    std::string received;
+    std::thread reader(
+        [&]
+        {
+            std::array<std::byte, 65536> buffer;
+            ssize_t bytes;
+            while ((bytes = server.receiveFrom(serverFd, buffer)) > 0)
+            {
+                received.append(reinterpret_cast<const char*>(buffer.data()), bytes);
+            }
+        });
+
+    EXPECT_TRUE(client.send(parts));
+    ::shutdown(client.getSocket(), SHUT_WR);
+    reader.join();
+    ::close(serverFd);
+
+    EXPECT_EQ(received, header + std::string(18, '-') + payload);
+}
+
+// Test to verify sendto() on a full non-blocking socket returns instead of waiting for the reader
+TEST(VectoredSendTest, FullNonBlockingSocket)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+    fcntl(serverFd, F_SETFL, fcntl(serverFd, F_GETFL, 0) | O_NONBLOCK);
+    int sendBuffer = 4096;
+    setsockopt(serverFd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+    // One-byte messages are never split, so the socket fills up without any of them being partly written.
+    size_t sent = 0;
+    while (server.sendto("x", serverFd))
+    {
+        ++sent;
+    }
+    EXPECT_GT(sent, 0u);
+
+    // A message the socket takes only in part is finished within SEND_STALL_TIMEOUT_MS, or reported.
+    std::array<std::byte, 65536> buffer;
+    ASSERT_GT(client.receive(buffer), 0);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(server.sendto(std::string(4 * 1024 * 1024, 'y'), serverFd), TimeoutError);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(SEND_STALL_TIMEOUT_MS));
+    ::close(serverFd);
+}
+
+// Test to verify the parts of a UDP message form a single datagram
+TEST(VectoredSendTest, UDPSingleDatagram)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    std::array<std::string_view, 3> parts = {"head", "", "body"};
+    EXPECT_TRUE(client.send(parts));
+
+    EXPECT_EQ(server.receive(), "headbody");
+}
+
+// Test to verify a batch of IPv4 datagrams is sent and received with its source address
+TEST(UDPBatchTest, IPv4RoundTrip)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    std::array<std::string_view, 3> datagrams = {"one", "two", "three"};
+    EXPECT_EQ(client.sendBatch(datagrams), 3u);
+
+    // Batches are move-only: a moved batch still receives into its own buffers.
+    static_assert(!std::is_copy_constructible_v<DatagramBatch>);
+    DatagramBatch staging(8, 64);
+    DatagramBatch batch(std::move(staging));
+    EXPECT_EQ(staging.size(), 0u);
+    size_t received = 0;
+    std::vector<std::string> payloads;
+    while (received < datagrams.size())
+    {
+        size_t count = server.receiveBatch(batch);
+        for (size_t i = 0; i < count; ++i)
+        {
+            payloads.emplace_back(batch[i].data);
+            EXPECT_EQ(batch[i].sourceAddress(), "127.0.0.1");
+            EXPECT_FALSE(batch[i].truncated);
+        }
+        received += count;
+    }
+
+    EXPECT_EQ(payloads, (std::vector<std::string> {"one", "two", "three"}));
+
+    // The moved-from batch reports nothing left to read, instead of pointing at the buffers it gave away.
+    const size_t last = batch.size();
+    ASSERT_GT(last, 0u);
+    staging = std::move(batch);
+    EXPECT_EQ(staging.size(), last);
+    EXPECT_EQ(batch.size(), 0u);
+    EXPECT_THROW(batch[0], std::out_of_range);
+}
+
+// Test to verify IPv6 replies reach the senders of a received batch
+TEST(UDPBatchTest, IPv6ReplyToSources)
+{
+    UDPConnection server("::1", "", true, true);
+    server.bind();
+    UDPConnection client("::1", server.GetPort(), true, true);
+    client.connect();
+
+    client.send("ping");
+
+    DatagramBatch batch(4, 64);
+    ASSERT_EQ(server.receiveBatch(batch), 1u);
+    EXPECT_EQ(batch[0].sourceAddress(), "::1");
+
+    std::array<std::string_view, 1> replies = {"pong"};
+    EXPECT_EQ(server.sendBatchTo(replies, batch), 1u);
+    EXPECT_EQ(client.receive(), "pong");
+}
+
+// Test to verify a segmented send is split into datagrams and coalesced back on receive
+TEST(UDPOffloadTest, SegmentAndCoalesce)
+{
+    UDPConnection server("127.0.0.1", "", true, false);
+    server.bind();
+    server.enableReceiveOffload(true);
+    UDPConnection client("127.0.0.1", server.GetPort(), true, false);
+    client.connect();
+
+    std::string buffer;
+    for (char c = 'a'; c < 'a' + 10; ++c)
+    {
+        buffer.append(1000, c);
+    }
+    buffer.append(500, 'z');
+    ASSERT_TRUE(client.sendSegmented(buffer, 1000));
+
+    std::vector<std::byte> storage(UDP_MAX_PAYLOAD);
+    std::string reassembled;
+    size_t datagrams = 0;
+    while (reassembled.size() < buffer.size())
+    {
+        CoalescedDatagrams received = server.receiveCoalesced(storage);
+        ASSERT_GT(received.segmentCount(), 0u);
+        for (size_t i = 0; i < received.segmentCount(); ++i)
+        {
+            EXPECT_LE(received.segment(i).size(), 1000u);
+            reassembled.append(received.segment(i));
+            ++datagrams;
+        }
+    }
+
+    EXPECT_EQ(reassembled, buffer);
+    EXPECT_EQ(datagrams, 11u);
+}
+
+// Test to verify the event loop accepts clients and delivers their data
+TEST(EventLoopTest, AcceptAndReceive)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    EventLoop loop;
+    std::string received;
+    int acceptedFd = -1;
+    bool closed = false;
+
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [&](int fd)
+    {
+        char buffer[64];
+        ssize_t bytes;
+        while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            received.append(buffer, bytes);
+        }
+        // The peer closing is seen as end of input; the handler decides to drop the socket.
+        if (bytes == 0)
+        {
+            closed = true;
+            loop.remove(fd);
+        }
+    };
+    loop.listen(server, handlers, [&](int fd) { acceptedFd = fd; });
+
+    {
+        TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+        client.connect();
+        client.send("Hello, loop!");
+
+        for (int i = 0; i < 10 && received.size() < 12; ++i)
+        {
+            loop.runOnce(100);
+        }
+    }
+
+    for (int i = 0; i < 10 && !closed; ++i)
+    {
+        loop.runOnce(100);
+    }
+
+    EXPECT_GE(acceptedFd, 0);
+    EXPECT_EQ(received, "Hello, loop!");
+    EXPECT_TRUE(closed);
+    EXPECT_EQ(loop.size(), 1u);
+}
+
+// Test to verify a peer that shuts down its side still gets the reply, and the socket stays until removed
+TEST(EventLoopTest, HalfCloseStillReplies)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    EventLoop loop;
+    std::string received;
+    bool replied = false;
+    bool closed = false;
+
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [&](int fd)
+    {
+        char buffer[64];
+        ssize_t bytes;
+        while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            received.append(buffer, bytes);
+        }
+        if (bytes == 0)
+        {
+            replied = ::send(fd, "done", 4, MSG_NOSIGNAL) == 4;
+            loop.remove(fd);
+        }
+    };
+    handlers.onClosed = [&](int) { closed = true; };
+    loop.listen(server, handlers);
+
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    client.send("request");
+    ::shutdown(client.getSocket(), SHUT_WR);
+
+    for (int i = 0; i < 20 && !replied; ++i)
+    {
+        loop.runOnce(100);
+    }
+
+    EXPECT_EQ(received, "request");
+    ASSERT_TRUE(replied);
+    EXPECT_EQ(client.receive(), "done");
+    EXPECT_FALSE(closed);
+    EXPECT_EQ(loop.size(), 1u);
+}
+
+// Test to verify a listener that ran out of descriptors reports it and takes the queued client later
+TEST(EventLoopTest, AcceptRetriesAfterEmfile)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    EventLoop loop;
+    int accepted = 0;
+    int errors = 0;
+    std::string reason;
+    loop.setAcceptErrorHandler(
+        [&errors, &reason](int, const std::string& error)
+        {
+            ++errors;
+            reason = error;
+        });
+    loop.listen(server, EventLoop::Handlers {}, [&accepted](int) { ++accepted; });
+
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+
+    // The lowest free descriptor is the one accept() would take; forbid it.
+    struct rlimit original;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &original), 0);
+    const int lowest = ::dup(0);
+    ASSERT_GE(lowest, 0);
+    ::close(lowest);
+    struct rlimit lowered = original;
+    lowered.rlim_cur = static_cast<rlim_t>(lowest);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+    loop.runOnce(100);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &original), 0);
+
+    EXPECT_EQ(accepted, 0);
+    EXPECT_EQ(errors, 1);
+    EXPECT_NE(reason.find(strerror(EMFILE)), std::string::npos);
+
+    // No other client connects: only the retry can take the queued one.
+    for (int i = 0; i < 10 && accepted == 0; ++i)
+    {
+        loop.runOnce(100);
+    }
+    EXPECT_EQ(accepted, 1);
+    EXPECT_EQ(loop.size(), 2u);
+}
+
+// Test to verify acceptAll() drains the backlog in one call and reports where each client came from
+TEST(AcceptTest, DrainBacklogWithPeers)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    std::vector<std::unique_ptr<TCPv4Connection>> clients;
+    std::set<std::string> clientPorts;
+    for (int i = 0; i < 3; ++i)
+    {
+        clients.push_back(std::make_unique<TCPv4Connection>("127.0.0.1", server.GetPort(), true));
+        clients.back()->connect();
+        clientPorts.insert(std::to_string(clients.back()->stream().localPort()));
+    }
+
+    std::vector<AcceptedSocket> accepted;
+    EXPECT_EQ(server.acceptAll(accepted), 3u);
+    EXPECT_EQ(server.acceptAll(accepted), 0u);
+    ASSERT_EQ(accepted.size(), 3u);
+
+    std::set<std::string> peerPorts;
+    for (const AcceptedSocket& client : accepted)
+    {
+        EXPECT_EQ(client.peer.family, AF_INET);
+        EXPECT_EQ(client.peer.host(), "127.0.0.1");
+        peerPorts.insert(client.peer.port());
+        EXPECT_TRUE(fcntl(client.socket, F_GETFL, 0) & O_NONBLOCK);
+        EXPECT_TRUE(fcntl(client.socket, F_GETFD, 0) & FD_CLOEXEC);
+        ::close(client.socket);
+    }
+    EXPECT_EQ(peerPorts, clientPorts);
+
+    // A blocking listener takes the queued clients without waiting for one more.
+    TCPv4Connection blockingServer("127.0.0.1", "", true);
+    blockingServer.bind();
+    TCPv4Connection first("127.0.0.1", blockingServer.GetPort(), true);
+    first.connect();
+    TCPv4Connection second("127.0.0.1", blockingServer.GetPort(), true);
+    second.connect();
+    accepted.clear();
+    EXPECT_EQ(blockingServer.acceptAll(accepted), 2u);
+    for (const AcceptedSocket& client : accepted)
+    {
+        EXPECT_FALSE(fcntl(client.socket, F_GETFL, 0) & O_NONBLOCK);
+        ::close(client.socket);
+    }
+
+    // The event loop hands the peer address to onAccept as well.
+    EventLoop loop;
+    std::string peerPort;
+    loop.listen(server, {}, [&](int, const ResolvedAddress& peer) { peerPort = peer.port(); });
+    TCPv4Connection late("127.0.0.1", server.GetPort(), true);
+    late.connect();
+    for (int i = 0; i < 10 && peerPort.empty(); ++i)
+    {
+        loop.runOnce(100);
+    }
+    EXPECT_EQ(peerPort, std::to_string(late.stream().localPort()));
+}
+
+// Test to verify stop() makes run() return
+TEST(EventLoopTest, StopFromAnotherThread)
+{
+    EventLoop loop;
+    std::thread stopper([&loop] { loop.stop(); });
+
+    loop.run();
+    stopper.join();
+
+    SUCCEED();
+}
+
+// Test to verify handlers run in the pool, one at a time per socket, without blocking other sockets
+TEST(EventLoopTest, ExecutorDispatch)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    WorkStealingPool pool(2);
+    EventLoop loop;
+    loop.setExecutor(&pool);
+
+    std::mutex mutex;
+    std::unordered_map<int, std::string> received;
+    std::unordered_map<int, bool> active;
+    bool overlapped = false;
+    std::atomic<int> closed {0};
+
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [&](int fd)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            overlapped = overlapped || active[fd];
+            active[fd] = true;
+        }
+        // Only one client is slow; a single loop thread would make the other wait behind it.
+        char buffer[64];
+        ssize_t bytes;
+        while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            bool slow;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                received[fd].append(buffer, static_cast<size_t>(bytes));
+                slow = received[fd].rfind("slow", 0) == 0;
+            }
+            if (slow)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active[fd] = false;
+        }
+        // Handlers run in the pool, so the end of input hands the removal back to the loop thread.
+        if (bytes == 0)
+        {
+            ++closed;
+            loop.post([&loop, fd] { loop.remove(fd); });
+        }
+    };
+    loop.listen(server, handlers);
+
+    {
+        TCPv4Connection slowClient("127.0.0.1", server.GetPort(), true);
+        TCPv4Connection fastClient("127.0.0.1", server.GetPort(), true);
+        slowClient.connect();
+        fastClient.connect();
+        for (int i = 0; i < 20; ++i)
+        {
+            slowClient.send(i == 0 ? "slow" : "+");
+            fastClient.send("fast");
+        }
+
+        for (int i = 0; i < 100; ++i)
+        {
+            loop.runOnce(10);
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t total = 0;
+            for (const auto& [fd, bytes] : received)
+            {
+                total += bytes.size();
+            }
+            if (total == 4 + 19 + 20 * 4)
+            {
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < 100 && (closed < 2 || loop.size() > 1); ++i)
+    {
+        loop.runOnce(10);
+    }
+    pool.wait();
+
+    EXPECT_FALSE(overlapped);
+    EXPECT_EQ(closed, 2);
+    EXPECT_EQ(loop.size(), 1u);
+    EXPECT_EQ(received.size(), 2u);
+}
+
+// Test to verify a handler throwing in the pool drops its socket and the error surfaces from wait()
+TEST(EventLoopTest, ExecutorHandlerThrows)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    WorkStealingPool pool(1);
+    EventLoop loop;
+    loop.setExecutor(&pool);
+
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [](int) { throw std::runtime_error("Error: handler failed"); };
+    loop.listen(server, handlers);
+
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    client.send("boom");
+
+    for (int i = 0; i < 10 && loop.size() < 2; ++i)
+    {
+        loop.runOnce(100);
+    }
+    for (int i = 0; i < 100 && loop.size() > 1; ++i)
+    {
+        loop.runOnce(10);
+    }
+
+    EXPECT_EQ(loop.size(), 1u);
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    // Closed with its request still unread, the server side resets the connection.
+    EXPECT_THROW(client.receive(), std::runtime_error);
+}
+
+// Test to verify timers fire in deadline order and cancelled timers never run
+TEST(EventLoopTest, Timers)
+{
+    EventLoop loop;
+    std::vector<int> fired;
+
+    loop.addTimer(std::chrono::milliseconds(30), [&fired] { fired.push_back(2); });
+    loop.addTimer(std::chrono::milliseconds(10), [&fired] { fired.push_back(1); });
+    uint64_t cancelled = loop.addTimer(std::chrono::milliseconds(20), [&fired] { fired.push_back(3); });
+    EXPECT_TRUE(loop.cancelTimer(cancelled));
+    EXPECT_FALSE(loop.cancelTimer(cancelled));
+
+    auto start = std::chrono::steady_clock::now();
+    while (fired.size() < 2 && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+    {
+        loop.runOnce(-1);
+    }
+
+    EXPECT_EQ(fired, (std::vector<int> {1, 2}));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(30));
+}
+
+// Test to verify idle clients are closed once their idle timeout passes, while active ones stay open
+TEST(EventLoopTest, IdleTimeout)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    EventLoop loop;
+    std::vector<int> closed;
+    EventLoop::Handlers handlers;
+    handlers.onReadable = [](int fd)
+    {
+        char buffer[64];
+        while (::recv(fd, buffer, sizeof(buffer), 0) > 0)
+        {
+        }
+    };
+    handlers.onClosed = [&closed](int fd) { closed.push_back(fd); };
+    std::vector<int> accepted;
+    loop.listen(server,
+                handlers,
+                [&](int fd)
+                {
+                    accepted.push_back(fd);
+                    loop.setIdleTimeout(fd, std::chrono::milliseconds(100));
+                });
+    EXPECT_THROW(loop.setIdleTimeout(server.getSocket(), std::chrono::milliseconds(100)), std::invalid_argument);
+
+    TCPv4Connection idle("127.0.0.1", server.GetPort(), true);
+    idle.connect();
+    TCPv4Connection active("127.0.0.1", server.GetPort(), true);
+    active.connect();
+
+    const auto start = std::chrono::steady_clock::now();
+    while (closed.empty() && std::chrono::steady_clock::now() - start < std::chrono::seconds(2))
+    {
+        active.send("ping");
+        loop.runOnce(20);
+    }
+
+    ASSERT_EQ(accepted.size(), 2u);
+    EXPECT_EQ(closed, (std::vector<int> {accepted[0]}));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    EXPECT_EQ(loop.size(), 2u);
+    EXPECT_EQ(idle.receiveView(), "");
+}
+
+// Test to verify blocking accept, receive and connect calls give up with TimeoutError
+TEST(TimeoutTest, BlockingCalls)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    SocketOptions options;
+    options.receiveTimeout = std::chrono::milliseconds(50);
+    server.changeOptions(options);
+    EXPECT_THROW(server.connect(), TimeoutError);
+
+    // Accepted sockets inherit the receive timeout of the listener, which bounds idle clients.
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.setConnectTimeout(std::chrono::milliseconds(500));
+    client.connect();
+    int fd = server.connect();
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(server.receiveFrom(fd), TimeoutError);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(40));
+    client.send("late");
+    EXPECT_EQ(server.receiveFrom(fd), "late");
+    ::close(fd);
+
+    // A listener with a full backlog drops the handshake, so the connect has to time out.
+    int full = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ASSERT_EQ(::bind(full, reinterpret_cast<struct sockaddr*>(&address), length), 0);
+    ASSERT_EQ(::listen(full, 0), 0);
+    getsockname(full, reinterpret_cast<struct sockaddr*>(&address), &length);
+    const std::string port = std::to_string(ntohs(address.sin_port));
+
+    std::vector<std::unique_ptr<TCPv4Connection>> queued;
+    bool timedOut = false;
+    for (int i = 0; i < 4 && !timedOut; ++i)
+    {
+        queued.push_back(std::make_unique<TCPv4Connection>("127.0.0.1", port, true));
+        queued.back()->setConnectTimeout(std::chrono::milliseconds(100));
+        try
+        {
+            queued.back()->connect();
+        }
+        catch (const TimeoutError&)
+        {
+            timedOut = true;
+        }
+    }
+    EXPECT_TRUE(timedOut);
+    EXPECT_EQ(fcntl(queued.back()->getSocket(), F_GETFL, 0) & O_NONBLOCK, 0);
+    ::close(full);
+}
+
+namespace
+{
+    // In-memory file filled with a position-dependent pattern.
+    int makePatternFile(size_t size, std::string& contents)
+    {
+        contents.resize(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            contents[i] = static_cast<char>('a' + (i * 7 + i / 251) % 26);
+        }
+        int fd = memfd_create("sendfile-test", MFD_CLOEXEC);
+        EXPECT_EQ(::write(fd, contents.data(), size), static_cast<ssize_t>(size));
+        return fd;
+    }
+
+    std::string receiveExactly(IConnection& connection, int socket, size_t size)
+    {
+        std::string received;
+        std::array<std::byte, 65536> buffer;
+        while (received.size() < size)
+        {
+            ssize_t bytes = connection.receiveFrom(socket, buffer);
+            if (bytes <= 0)
+            {
+                break;
+            }
+            received.append(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(bytes));
+        }
+        return received;
+    }
+} // namespace
+
+// Test to verify a range of a regular file is streamed with sendfile
+TEST(SendFileTest, RegularFileRange)
+{
+    std::string contents;
+    int fd = makePatternFile(1 << 20, contents);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    std::thread sender([&] { EXPECT_EQ(client.sendFile(fd, 1000, 500000), 500000u); });
+    EXPECT_EQ(receiveExactly(server, serverFd, 500000), contents.substr(1000, 500000));
+    sender.join();
+
+    // Asking past the end stops at the end of the file.
+    std::thread tail([&] { EXPECT_EQ(server.sendFileTo(serverFd, fd, (1 << 20) - 10, 100), 10u); });
+    EXPECT_EQ(receiveExactly(client, client.getSocket(), 10), contents.substr((1 << 20) - 10));
+    tail.join();
+
+    ::close(serverFd);
+    ::close(fd);
+}
+
+// Test to verify the read end of a pipe is spliced into the socket
+TEST(SendFileTest, PipeSplice)
+{
+    std::string contents;
+    int file = makePatternFile(200000, contents);
+    int pipeFds[2];
+    ASSERT_EQ(::pipe(pipeFds), 0);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    std::thread writer(
+        [&]
+        {
+            EXPECT_EQ(::write(pipeFds[1], contents.data(), contents.size()), static_cast<ssize_t>(contents.size()));
+            ::close(pipeFds[1]);
+        });
+    std::thread sender(
+        [&] { EXPECT_EQ(server.sendFileTo(serverFd, pipeFds[0], 0, contents.size()), contents.size()); });
+    EXPECT_EQ(receiveExactly(client, client.getSocket(), contents.size()), contents);
+    writer.join();
+    sender.join();
+
+    EXPECT_THROW(server.sendFileTo(serverFd, pipeFds[0], 10, 1), std::invalid_argument);
+    ::close(pipeFds[0]);
+    ::close(serverFd);
+    ::close(file);
+}
+
+// Test to verify a non-blocking socket returns partial counts that resume the transfer
+TEST(SendFileTest, NonBlockingResume)
+{
+    const size_t size = 8 << 20;
+    std::string contents;
+    int fd = makePatternFile(size, contents);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    int sendBuffer = 16384;
+    setsockopt(client.getSocket(), SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    fcntl(client.getSocket(), F_SETFL, fcntl(client.getSocket(), F_GETFL, 0) | O_NONBLOCK);
+
+    std::string received;
+    std::thread receiver([&] { received = receiveExactly(server, serverFd, size); });
+
+    size_t offset = 0;
+    int calls = 0;
+    while (offset < size)
+    {
+        offset += client.sendFile(fd, static_cast<off_t>(offset), size - offset);
+        ++calls;
+        struct pollfd pollFd = {client.getSocket(), POLLOUT, 0};
+        ::poll(&pollFd, 1, 1000);
+    }
+    receiver.join();
+
+    EXPECT_GT(calls, 1);
+    EXPECT_EQ(received, contents);
+    ::close(serverFd);
+    ::close(fd);
+}
+
+// Test to verify sendFile() waits for the bytes queued by send() instead of overtaking them
+TEST(SendFileTest, QueuedBytesGoFirst)
+{
+    const size_t size = 1 << 20;
+    std::string contents;
+    int fd = makePatternFile(size, contents);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), false);
+    client.connect();
+    int serverFd = server.connect();
+
+    int sendBuffer = 16384;
+    setsockopt(client.getSocket(), SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    const std::string message(4 << 20, 'q');
+    ASSERT_TRUE(client.send(message));
+    ASSERT_GT(client.writeQueue()->pending(), 0u);
+    EXPECT_EQ(client.sendFile(fd, 0, size), 0u);
+
+    std::string received;
+    std::thread receiver([&] { received = receiveExactly(server, serverFd, message.size() + size); });
+
+    size_t offset = 0;
+    while (offset < size)
+    {
+        offset += client.sendFile(fd, static_cast<off_t>(offset), size - offset);
+        struct pollfd pollFd = {client.getSocket(), POLLOUT, 0};
+        ::poll(&pollFd, 1, 1000);
+    }
+    receiver.join();
+
+    EXPECT_EQ(received, message + contents);
+    ::close(serverFd);
+    ::close(fd);
+}
+
+// Test to verify a Unix domain stream connection works through an automatic abstract name
+TEST(UnixConnectionTest, StreamAbstractEcho)
+{
+    auto server = createConnection("", "", true, UNIX_STREAM);
+    server->bind();
+    const std::string path = static_cast<UnixConnection&>(*server).GetPath();
+    ASSERT_EQ(path[0], '@');
+    EXPECT_EQ(server->GetEndpoint().host(), path);
+
+    auto client = createConnection(path, "", true, UNIX_STREAM);
+    client->connect();
+    int serverFd = server->connect();
+
+    client->send("Hello, Unix!");
+    EXPECT_EQ(server->receiveFrom(serverFd), "Hello, Unix!");
+    server->sendto("Hello back", serverFd);
+    EXPECT_EQ(client->receive(), "Hello back");
+
+    ::close(serverFd);
+    EXPECT_THROW(UnixConnection("@" + std::string(sizeof(sockaddr_un::sun_path), 'x'), true), std::invalid_argument);
+}
+
+// Test to verify sequenced packets keep their boundaries and a stale socket file is replaced
+TEST(UnixConnectionTest, SeqPacketBoundariesAndStalePath)
+{
+    char directory[] = "/tmp/cppSocketUnixXXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    const std::string path = std::string(directory) + "/socket";
+    {
+        UnixConnection previous(path, true, true);
+        previous.bind();
+        ::unlink(path.c_str());
+        // Leave a socket file nobody listens on, as a crashed server would.
+        ::bind(socket(AF_UNIX, SOCK_SEQPACKET, 0), UnixConnection::makeEndpoint(path).data(),
+               UnixConnection::makeEndpoint(path).length);
+    }
+
+    UnixConnection server(path, true, true);
+    EXPECT_NO_THROW(server.bind());
+
+    UnixConnection client(path, true, true);
+    client.connect();
+    int serverFd = server.connect();
+    EXPECT_TRUE(client.isSeqPacket());
+
+    client.send("first");
+    client.send("second");
+    EXPECT_EQ(server.receiveFrom(serverFd), "first");
+    EXPECT_EQ(server.receiveFrom(serverFd), "second");
+
+    UnixConnection busy(path, true, true);
+    EXPECT_THROW(busy.bind(), std::runtime_error);
+
+    ::close(serverFd);
+    {
+        UnixConnection owner(path + ".owned", true);
+        owner.bind();
+    }
+    EXPECT_NE(::access((path + ".owned").c_str(), F_OK), 0);
+    ::unlink(path.c_str());
+    ::rmdir(directory);
+}
+
+// Test to verify file descriptors are passed to the peer with SCM_RIGHTS
+TEST(UnixConnectionTest, PassDescriptors)
+{
+    UnixConnection server("@cppSocketPassDescriptors", true);
+    server.bind();
+    UnixConnection client("@cppSocketPassDescriptors", true);
+    client.connect();
+    int serverFd = server.connect();
+
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+    std::array<int, 2> passed = {pipeFds[0], pipeFds[1]};
+    EXPECT_THROW(client.sendFds("", passed), std::invalid_argument);
+    EXPECT_TRUE(client.sendFds("pipe", passed));
+    ::close(pipeFds[0]);
+    ::close(pipeFds[1]);
+
+    std::array<std::byte, 16> buffer;
+    std::vector<int> received;
+    ASSERT_EQ(server.receiveFdsFrom(serverFd, buffer, received), 4);
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(buffer.data()), 4), "pipe");
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_TRUE(fcntl(received[0], F_GETFD) & FD_CLOEXEC);
+
+    // The received descriptors are the two ends of the same pipe.
+    ASSERT_EQ(::write(received[1], "x", 1), 1);
+    char byte = 0;
+    EXPECT_EQ(::read(received[0], &byte, 1), 1);
+    EXPECT_EQ(byte, 'x');
+
+    // A message without descriptors still arrives through receiveFds().
+    server.sendFdsTo(serverFd, "plain", {});
+    std::vector<int> none;
+    EXPECT_EQ(client.receiveFds(buffer, none), 5);
+    EXPECT_TRUE(none.empty());
+
+    ::close(received[0]);
+    ::close(received[1]);
+    ::close(serverFd);
+}
+
 #endif // TCP_TEST_HPP
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef FRAMED_CONNECTION_TEST_HPP
+#define FRAMED_CONNECTION_TEST_HPP
+
+#include "framedConnection.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify several small frames and one frame far larger than MAX_MESSAGE_LENGTH round-trip
+TEST(FramedConnectionTest, RoundTripFixedPrefix)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    FramedConnection sender(client, FramePrefix::FixedU32);
+    FramedConnection receiver(server, FramePrefix::FixedU32, serverFd);
+
+    const std::string large(1024 * 1024, 'L');
+    std::thread writer(
+        [&]
+        {
+            sender.sendFrame("first");
+            sender.sendFrame("");
+            sender.sendFrame("third");
+            sender.sendFrame(large);
+            ::shutdown(client.getSocket(), SHUT_WR);
+        });
+
+    EXPECT_EQ(receiver.receiveFrame(), "first");
+    EXPECT_EQ(receiver.receiveFrame(), "");
+    EXPECT_EQ(receiver.receiveFrame(), "third");
+    EXPECT_EQ(receiver.receiveFrame(), large);
+    EXPECT_FALSE(receiver.receiveFrame().has_value());
+    EXPECT_TRUE(receiver.closed());
+
+    writer.join();
+    ::close(serverFd);
+}
+
+// Test to verify varint prefixes are reassembled from bytes fed one at a time
+TEST(FramedConnectionTest, VarintFeedReassembly)
+{
+    TCPv4Connection unused("127.0.0.1", "", true);
+    FramedConnection framer(unused, FramePrefix::Varint);
+
+    const std::string payload(300, 'v');
+    uint8_t prefix[FRAME_MAX_PREFIX];
+    size_t prefixSize = FramedConnection::encodePrefix(FramePrefix::Varint, payload.size(), prefix);
+    ASSERT_EQ(prefixSize, 2u);
+
+    std::string stream(reinterpret_cast<const char*>(prefix), prefixSize);
+    stream += payload;
+    stream += '\x02';
+    stream += "ok";
+
+    for (size_t i = 0; i + 3 < stream.size(); ++i)
+    {
+        EXPECT_FALSE(framer.nextFrame().has_value());
+        framer.feed(stream.substr(i, 1));
+    }
+    framer.feed(stream.substr(stream.size() - 3));
+
+    EXPECT_EQ(framer.nextFrame(), payload);
+    EXPECT_EQ(framer.nextFrame(), "ok");
+    EXPECT_EQ(framer.buffered(), 0u);
+}
+
+// Test to verify frames above the configured limit are rejected
+TEST(FramedConnectionTest, RejectsOversizedFrame)
+{
+    TCPv4Connection unused("127.0.0.1", "", true);
+    FramedConnection framer(unused, FramePrefix::FixedU32, -1, 16);
+
+    framer.feed(std::string("\x00\x00\x01\x00", 4));
+
+    EXPECT_THROW(framer.nextFrame(), std::runtime_error);
+}
+
+#endif // FRAMED_CONNECTION_TEST_HPP
@@ -0,0 +1,148 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef HAPPY_EYEBALLS_TEST_HPP
+#define HAPPY_EYEBALLS_TEST_HPP
+
+#include "happyEyeballs.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+    ResolvedAddress endpointOf(const std::string& host, uint16_t port, int family)
+    {
+        return Resolver::instance().resolve(host, std::to_string(port), family, SOCK_STREAM).front();
+    }
+
+    /**
+     * @brief Loopback listener that never completes a handshake: its accept queue is full, so the
+     * kernel drops further SYNs and connects to it hang as on a dead address.
+     */
+    template <typename Family>
+    struct BlackHole
+    {
+        explicit BlackHole(const std::string& host)
+        {
+            listener.bind(endpointOf(host, 0, Family::domain));
+            listener.listen(0);
+            port = listener.localPort();
+            // A backlog of 0 still queues one connection; the second one makes sure the queue is full.
+            // Their connects are not waited for, as the second handshake may never finish.
+            const ResolvedAddress endpoint = endpointOf(host, port, Family::domain);
+            for (auto& client : fillers)
+            {
+                ::connect(client.fd(), endpoint.data(), endpoint.length);
+            }
+        }
+
+        Socket<Tcp, Family> listener;
+        Socket<Tcp, Family> fillers[2] = {Socket<Tcp, Family>(false), Socket<Tcp, Family>(false)};
+        uint16_t port = 0;
+    };
+} // namespace
+
+// Test to verify addresses alternate between families, starting with the family of the first one
+TEST(HappyEyeballsTest, InterleavesFamilies)
+{
+    std::vector<ResolvedAddress> addresses = {endpointOf("::1", 1, AF_INET6),
+                                              endpointOf("::1", 2, AF_INET6),
+                                              endpointOf("::1", 3, AF_INET6),
+                                              endpointOf("127.0.0.1", 4, AF_INET),
+                                              endpointOf("127.0.0.1", 5, AF_INET)};
+
+    auto ports = [](const std::vector<ResolvedAddress>& ordered)
+    {
+        std::string result;
+        for (const auto& address : ordered)
+        {
+            result += address.port();
+        }
+        return result;
+    };
+    EXPECT_EQ(ports(interleaveAddresses(addresses)), "14253");
+    EXPECT_EQ(ports(interleaveAddresses(addresses, 2)), "12435");
+}
+
+// Test to verify a dead first address only costs the attempt delay and the live one wins
+TEST(HappyEyeballsTest, DeadAddressFallsBack)
+{
+    BlackHole<IPv6> dead("::1");
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+
+    std::vector<ResolvedAddress> addresses = {endpointOf("::1", dead.port, AF_INET6),
+                                              endpointOf("127.0.0.1", std::stoi(server.GetPort()), AF_INET)};
+    HappyEyeballsOptions options;
+    options.attemptDelay = std::chrono::milliseconds(50);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto client = connectHappyEyeballs(addresses, true, options);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(40));
+    EXPECT_LT(elapsed, std::chrono::seconds(1));
+    EXPECT_EQ(client->GetEndpoint().family, AF_INET);
+    EXPECT_EQ(client->GetPort(), server.GetPort());
+
+    const int serverFd = server.connect();
+    EXPECT_TRUE(client->connect());
+    client->send("hello");
+    EXPECT_EQ(server.receiveFrom(serverFd), "hello");
+    ::close(serverFd);
+}
+
+// Test to verify the preferred address wins when it answers within the delay, without a second attempt
+TEST(HappyEyeballsTest, PreferredAddressWins)
+{
+    TCPv6Connection server6("::1", "", false);
+    server6.bind();
+    TCPv4Connection server4("127.0.0.1", "", false);
+    server4.bind();
+
+    std::vector<ResolvedAddress> addresses = {endpointOf("::1", std::stoi(server6.GetPort()), AF_INET6),
+                                              endpointOf("127.0.0.1", std::stoi(server4.GetPort()), AF_INET)};
+    auto client = connectHappyEyeballs(addresses, false);
+    EXPECT_EQ(client->GetEndpoint().family, AF_INET6);
+
+    const int accepted = server6.connect();
+    EXPECT_GE(accepted, 0);
+    EXPECT_EQ(server4.connect(), ERROR);
+    ::close(accepted);
+}
+
+// Test to verify refused addresses fail fast and unanswered ones end with the timeout
+TEST(HappyEyeballsTest, RefusedAndTimeout)
+{
+    // Bound but not listening: connects are refused at once.
+    Socket<Tcp, IPv4> closed4;
+    closed4.bind(endpointOf("127.0.0.1", 0, AF_INET));
+    Socket<Tcp, IPv6> closed6;
+    closed6.bind(endpointOf("::1", 0, AF_INET6));
+
+    std::vector<ResolvedAddress> refused = {endpointOf("::1", closed6.localPort(), AF_INET6),
+                                            endpointOf("127.0.0.1", closed4.localPort(), AF_INET)};
+    HappyEyeballsOptions options;
+    options.attemptDelay = std::chrono::seconds(5);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(connectHappyEyeballs(refused, true, options), std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    BlackHole<IPv4> dead("127.0.0.1");
+    std::vector<ResolvedAddress> unanswered = {endpointOf("127.0.0.1", dead.port, AF_INET)};
+    options.timeout = std::chrono::milliseconds(50);
+    EXPECT_THROW(connectHappyEyeballs(unanswered, true, options), TimeoutError);
+}
+
+#endif // HAPPY_EYEBALLS_TEST_HPP
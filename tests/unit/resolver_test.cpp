@@ -0,0 +1,183 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef RESOLVER_TEST_HPP
+#define RESOLVER_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+namespace
+{
+    /**
+     * @brief Stand-in resolver answering every name with 127.0.0.1.
+     */
+    class FakeResolverBackend : public ResolverBackend
+    {
+    public:
+        explicit FakeResolverBackend(std::chrono::milliseconds ttl = std::chrono::milliseconds(-1))
+            : ttl(ttl)
+        {
+        }
+
+        Resolution lookup(const std::string& host, const std::string& port, const struct addrinfo& hints) override
+        {
+            ++calls;
+            if (gate.valid())
+            {
+                gate.wait();
+            }
+            if (host == "missing.test" || failuresLeft-- > 0)
+            {
+                throw std::runtime_error("Error: unknown host " + host);
+            }
+
+            ResolvedAddress resolved {};
+            auto* address = reinterpret_cast<struct sockaddr_in*>(&resolved.address);
+            address->sin_family = AF_INET;
+            address->sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+            inet_pton(AF_INET, "127.0.0.1", &address->sin_addr);
+            resolved.length = sizeof(struct sockaddr_in);
+            resolved.family = AF_INET;
+            resolved.socktype = hints.ai_socktype;
+            resolved.protocol = 0;
+            return Resolution {{resolved}, ttl};
+        }
+
+        std::chrono::milliseconds ttl;
+        std::atomic<int> calls {0};
+        std::atomic<int> failuresLeft {0};
+        std::shared_future<void> gate;
+    };
+} // namespace
+
+// Test to verify results are served from the cache until their TTL expires
+TEST(ResolverTest, CacheRespectsTtl)
+{
+    auto backend = std::make_shared<FakeResolverBackend>(std::chrono::milliseconds(30));
+    Resolver resolver(backend);
+
+    EXPECT_EQ(resolver.resolve("service.test", "8080", AF_INET, SOCK_STREAM).front().port(), "8080");
+    EXPECT_EQ(resolver.resolve("service.test", "8080", AF_INET, SOCK_STREAM).front().host(), "127.0.0.1");
+    EXPECT_EQ(backend->calls, 1);
+    EXPECT_EQ(resolver.counters().hits, 1u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    resolver.resolve("service.test", "8080", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(backend->calls, 2);
+
+    resolver.resolve("service.test", "9090", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(backend->calls, 3);
+}
+
+// Test to verify concurrent requests for the same name share one lookup
+TEST(ResolverTest, CoalescesConcurrentLookups)
+{
+    auto backend = std::make_shared<FakeResolverBackend>();
+    std::promise<void> release;
+    backend->gate = release.get_future().share();
+    Resolver resolver(backend);
+
+    std::vector<std::shared_future<std::vector<ResolvedAddress>>> pending;
+    for (int i = 0; i < 5; ++i)
+    {
+        pending.push_back(resolver.resolveAsync("service.test", "8080", AF_INET, SOCK_STREAM));
+    }
+    EXPECT_EQ(pending.front().wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+    release.set_value();
+
+    for (auto& result : pending)
+    {
+        EXPECT_EQ(result.get().front().port(), "8080");
+    }
+    EXPECT_EQ(backend->calls, 1);
+    EXPECT_EQ(resolver.counters().coalesced, 4u);
+}
+
+// Test to verify failures reach every caller and are not cached
+TEST(ResolverTest, FailuresAreNotCached)
+{
+    auto backend = std::make_shared<FakeResolverBackend>();
+    backend->failuresLeft = 1;
+    Resolver resolver(backend);
+
+    EXPECT_THROW(resolver.resolve("service.test", "8080", AF_INET, SOCK_STREAM), std::runtime_error);
+    EXPECT_NO_THROW(resolver.resolve("service.test", "8080", AF_INET, SOCK_STREAM));
+    EXPECT_EQ(resolver.counters().lookups, 2u);
+}
+
+// Test to verify a full cache evicts the least recently used name
+TEST(ResolverTest, CacheIsBounded)
+{
+    auto backend = std::make_shared<FakeResolverBackend>();
+    Resolver resolver(backend, std::chrono::milliseconds(RESOLVER_TTL_MS), 2);
+
+    resolver.resolve("service.test", "1", AF_INET, SOCK_STREAM);
+    resolver.resolve("service.test", "2", AF_INET, SOCK_STREAM);
+    resolver.resolve("service.test", "1", AF_INET, SOCK_STREAM);
+    resolver.resolve("service.test", "3", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(resolver.size(), 2u);
+    EXPECT_EQ(backend->calls, 3);
+
+    resolver.resolve("service.test", "1", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(backend->calls, 3);
+    resolver.resolve("service.test", "2", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(backend->calls, 4);
+}
+
+// Test to verify expired names are dropped when a new name is added
+TEST(ResolverTest, ExpiredEntriesAreEvicted)
+{
+    auto backend = std::make_shared<FakeResolverBackend>(std::chrono::milliseconds(30));
+    Resolver resolver(backend);
+
+    resolver.resolve("service.test", "1", AF_INET, SOCK_STREAM);
+    resolver.resolve("service.test", "2", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(resolver.size(), 2u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    resolver.resolve("service.test", "3", AF_INET, SOCK_STREAM);
+    EXPECT_EQ(resolver.size(), 1u);
+}
+
+// Test to verify the connection constructors and the factory resolve through the shared resolver
+TEST(ResolverTest, ConnectionsUseResolver)
+{
+    auto backend = std::make_shared<FakeResolverBackend>();
+    Resolver::instance().setBackend(backend);
+
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+
+    TCPv4Connection client("service.test", server.GetPort(), true);
+    EXPECT_NO_THROW(client.connect());
+    EXPECT_THROW(createConnection("missing.test", server.GetPort(), true, TCP), std::runtime_error);
+
+    auto endpoint = Resolver::instance().resolveAsync("service.test", server.GetPort(), AF_INET, SOCK_STREAM);
+    auto connection = createConnection(endpoint.get().front(), true, TCP);
+    EXPECT_NO_THROW(connection->connect());
+    EXPECT_EQ(connection->GetPort(), server.GetPort());
+
+    int first = server.connect();
+    int second = server.connect();
+    ::close(first);
+    ::close(second);
+
+    Resolver::instance().setBackend(nullptr);
+    EXPECT_EQ(backend->calls, 2);
+}
+
+#endif // RESOLVER_TEST_HPP
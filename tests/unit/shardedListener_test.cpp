@@ -0,0 +1,131 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef SHARDED_LISTENER_TEST_HPP
+#define SHARDED_LISTENER_TEST_HPP
+
+#include "shardedListener.hpp"
+#include "gtest/gtest.h"
+
+#include <array>
+
+namespace
+{
+    constexpr auto SHARDS = 4;   // Listeners opened by the tests.
+    constexpr auto CLIENTS = 32; // Connections or flows spread across them.
+} // namespace
+
+// Test to verify TCP clients are echoed by several shards bound to the same port
+TEST(ShardedListenerTest, TCPEchoAcrossShards)
+{
+    ShardedListener listener("127.0.0.1", "", TCP, SHARDS, true);
+    ASSERT_EQ(listener.size(), static_cast<size_t>(SHARDS));
+
+    std::array<std::atomic<int>, SHARDS> accepted {};
+    listener.start(
+        [&accepted](EventLoop& loop, IConnection& shardListener, size_t shard)
+        {
+            EventLoop::Handlers handlers;
+            handlers.onReadable = [&loop](int fd)
+            {
+                char buffer[256];
+                ssize_t bytes;
+                while ((bytes = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+                {
+                    ::send(fd, buffer, static_cast<size_t>(bytes), MSG_NOSIGNAL);
+                }
+                if (bytes == 0)
+                {
+                    loop.remove(fd);
+                }
+            };
+            loop.listen(shardListener, handlers, [&accepted, shard](int) { ++accepted[shard]; });
+        });
+
+    for (int i = 0; i < CLIENTS; ++i)
+    {
+        TCPv4Connection client("127.0.0.1", listener.GetPort(), true);
+        client.connect();
+        client.send("ping " + std::to_string(i));
+        EXPECT_EQ(client.receive(), "ping " + std::to_string(i));
+    }
+    listener.stop();
+
+    int total = 0;
+    int busyShards = 0;
+    for (auto& count : accepted)
+    {
+        total += count;
+        busyShards += count > 0 ? 1 : 0;
+    }
+    EXPECT_EQ(total, CLIENTS);
+    EXPECT_GT(busyShards, 1);
+}
+
+// Test to verify datagrams from many flows are received by the UDP shards
+TEST(ShardedListenerTest, UDPReceiveAcrossShards)
+{
+    ShardedListener listener("127.0.0.1", "", UDP, SHARDS);
+
+    std::atomic<int> received {0};
+    listener.start(
+        [&received](EventLoop& loop, IConnection& shardListener, size_t)
+        {
+            EventLoop::Handlers handlers;
+            handlers.onReadable = [&received, &shardListener](int)
+            {
+                std::array<std::byte, 64> buffer;
+                while (shardListener.receive(buffer) > 0)
+                {
+                    ++received;
+                }
+            };
+            loop.add(shardListener.getSocket(), handlers);
+        });
+
+    for (int i = 0; i < CLIENTS; ++i)
+    {
+        UDPConnection client("127.0.0.1", listener.GetPort(), true, false);
+        client.connect();
+        client.send("datagram");
+    }
+
+    for (int i = 0; i < 100 && received < CLIENTS; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    listener.stop();
+
+    EXPECT_EQ(received, CLIENTS);
+}
+
+// Test to verify an exception thrown by a setup callback reaches start()
+TEST(ShardedListenerTest, SetupFailure)
+{
+    ShardedListener listener("127.0.0.1", "", TCP, 2);
+
+    EXPECT_THROW(listener.start(
+                     [](EventLoop&, IConnection&, size_t shard)
+                     {
+                         if (shard == 1)
+                         {
+                             throw std::runtime_error("Error: setup failed");
+                         }
+                     }),
+                 std::runtime_error);
+}
+
+#endif // SHARDED_LISTENER_TEST_HPP
@@ -0,0 +1,161 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef SHARED_MEMORY_CONNECTION_TEST_HPP
+#define SHARED_MEMORY_CONNECTION_TEST_HPP
+
+#include "sharedMemoryConnection.hpp"
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+// Test to verify messages wrap around the end of the ring in one piece and a full ring refuses writes
+TEST(SharedMemoryRingTest, WrapAroundAndFull)
+{
+    const size_t capacity = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    int memfd = memfd_create("ringTest", MFD_CLOEXEC);
+    ASSERT_GE(memfd, 0);
+    ASSERT_EQ(ftruncate(memfd, static_cast<off_t>(SharedMemoryRing::segmentSize(capacity))), 0);
+
+    auto makeEventFd = [] { return eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC); };
+    SharedMemoryRing producer(memfd, 0, capacity, makeEventFd(), makeEventFd());
+    SharedMemoryRing consumer(memfd, 0, capacity, makeEventFd(), makeEventFd());
+    ::close(memfd);
+
+    // 1000-byte messages take 1008 bytes, so the fifth one straddles the end of a 4 KiB ring.
+    for (int i = 0; i < 20; ++i)
+    {
+        const std::string message(1000, static_cast<char>('a' + i));
+        std::string_view part = message;
+        ASSERT_TRUE(producer.tryWrite(std::span<const std::string_view>(&part, 1)));
+        auto received = consumer.peek();
+        ASSERT_TRUE(received.has_value());
+        EXPECT_EQ(*received, message);
+        consumer.release();
+    }
+    EXPECT_FALSE(consumer.peek().has_value());
+
+    const std::string message(1000, 'x');
+    std::string_view part = message;
+    int written = 0;
+    while (producer.tryWrite(std::span<const std::string_view>(&part, 1)))
+    {
+        ++written;
+    }
+    EXPECT_EQ(written, static_cast<int>(capacity / 1008));
+    EXPECT_TRUE(consumer.peek().has_value());
+    consumer.release();
+    EXPECT_TRUE(producer.tryWrite(std::span<const std::string_view>(&part, 1)));
+
+    const std::string tooLarge(producer.maxMessage() + 1, 'x');
+    part = tooLarge;
+    EXPECT_THROW(producer.tryWrite(std::span<const std::string_view>(&part, 1)), std::invalid_argument);
+}
+
+// Test to verify a capacity that is not a page multiple power of two, or overflows the mapping, is refused
+TEST(SharedMemoryRingTest, RejectsBadCapacity)
+{
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    int memfd = memfd_create("ringTest", MFD_CLOEXEC);
+    ASSERT_GE(memfd, 0);
+
+    for (size_t capacity : {page / 2, 3 * page, size_t {1} << 63})
+    {
+        // The ring takes ownership of its eventfds even when it refuses to be built.
+        int readable = eventfd(0, EFD_CLOEXEC);
+        int writable = eventfd(0, EFD_CLOEXEC);
+        EXPECT_THROW(SharedMemoryRing(memfd, 0, capacity, readable, writable), std::invalid_argument);
+        EXPECT_EQ(fcntl(readable, F_GETFD), -1);
+        EXPECT_EQ(fcntl(writable, F_GETFD), -1);
+    }
+    ::close(memfd);
+}
+
+// Test to verify the handshake maps both rings and blocking calls wake each other up
+TEST(SharedMemoryConnectionTest, PingPong)
+{
+    SharedMemoryConnection server("", true, 64 * 1024);
+    server.bind();
+
+    std::thread peer(
+        [path = server.GetPath()]
+        {
+            SharedMemoryConnection client(path, true);
+            client.connect();
+            EXPECT_EQ(client.maxMessage(), 64u * 1024 - SHM_RECORD_HEADER);
+            for (int i = 0; i < 1000; ++i)
+            {
+                client.send(client.receive());
+            }
+        });
+
+    int clientFd = server.connect();
+    server.enableMetrics();
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string message = "ping " + std::to_string(i);
+        server.sendto(message, clientFd);
+        ASSERT_EQ(server.receiveFrom(clientFd), message);
+    }
+    peer.join();
+
+    // The client is gone: the ring is empty and the hangup ends the wait.
+    std::array<std::byte, 16> buffer;
+    EXPECT_EQ(server.receiveFrom(clientFd, buffer), 0);
+    EXPECT_EQ(server.metrics()->snapshot().messagesReceived, 1000u);
+    server.disconnect(clientFd);
+    EXPECT_THROW(server.receiveFrom(clientFd), std::invalid_argument);
+}
+
+// Test to verify a non-blocking connection reports an empty ring and signals its eventfd once armed
+TEST(SharedMemoryConnectionTest, NonBlockingNotify)
+{
+    SharedMemoryConnection server("", false);
+    server.bind();
+    EXPECT_EQ(server.connect(), ERROR);
+
+    SharedMemoryConnection client(server.GetPath(), false);
+    std::thread connector([&client] { client.connect(); });
+    int clientFd = ERROR;
+    while ((clientFd = server.connect()) == ERROR)
+    {
+        std::this_thread::yield();
+    }
+    connector.join();
+
+    std::array<std::byte, 64> buffer;
+    EXPECT_EQ(server.receiveFrom(clientFd, buffer), ERROR);
+
+    std::vector<std::string_view> parts = {"shared ", "memory"};
+    EXPECT_TRUE(client.send(parts));
+    struct pollfd pollFd = {server.notifyFd(clientFd), POLLIN, 0};
+    EXPECT_EQ(::poll(&pollFd, 1, 1000), 1);
+    ASSERT_EQ(server.receiveFrom(clientFd, buffer), 13);
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(buffer.data()), 13), "shared memory");
+
+    // A full ring refuses the message instead of waiting.
+    const std::string large(client.maxMessage() / 2, 'x');
+    int sent = 0;
+    while (client.send(large))
+    {
+        ++sent;
+    }
+    EXPECT_EQ(sent, 1);
+}
+
+#endif // SHARED_MEMORY_CONNECTION_TEST_HPP
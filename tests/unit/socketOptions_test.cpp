@@ -0,0 +1,105 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef SOCKET_OPTIONS_TEST_HPP
+#define SOCKET_OPTIONS_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+#include <netinet/tcp.h>
+
+namespace
+{
+    int readOption(int socket, int level, int name)
+    {
+        int value = -1;
+        socklen_t length = sizeof(value);
+        EXPECT_EQ(getsockopt(socket, level, name, &value, &length), 0);
+        return value;
+    }
+} // namespace
+
+// Test to verify options given to createConnection() are set on the new socket
+TEST(SocketOptionsTest, AppliedAtCreation)
+{
+    SocketOptions options;
+    options.noDelay = true;
+    options.keepAlive = true;
+    options.keepAliveIdle = 30;
+    options.keepAliveInterval = 5;
+    options.keepAliveCount = 4;
+    options.reuseAddress = true;
+
+    auto connection = createConnection("127.0.0.1", "", true, TCP, options);
+    int socket = connection->getSocket();
+
+    EXPECT_EQ(readOption(socket, IPPROTO_TCP, TCP_NODELAY), 1);
+    EXPECT_EQ(readOption(socket, SOL_SOCKET, SO_KEEPALIVE), 1);
+    EXPECT_EQ(readOption(socket, IPPROTO_TCP, TCP_KEEPIDLE), 30);
+    EXPECT_EQ(readOption(socket, IPPROTO_TCP, TCP_KEEPINTVL), 5);
+    EXPECT_EQ(readOption(socket, IPPROTO_TCP, TCP_KEEPCNT), 4);
+    EXPECT_EQ(readOption(socket, SOL_SOCKET, SO_REUSEADDR), 1);
+}
+
+// Test to verify options can be changed on a live connection and unset ones are left alone
+TEST(SocketOptionsTest, ChangedAtRuntime)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    EXPECT_TRUE(client.changeOptions(SocketOptions::lowLatency()));
+    EXPECT_EQ(readOption(client.getSocket(), IPPROTO_TCP, TCP_NODELAY), 1);
+    EXPECT_EQ(readOption(client.getSocket(), IPPROTO_TCP, TCP_NOTSENT_LOWAT), 16384);
+    EXPECT_EQ(readOption(client.getSocket(), SOL_SOCKET, SO_PRIORITY), 6);
+
+    SocketOptions cork;
+    cork.cork = true;
+    client.changeOptions(cork);
+    EXPECT_EQ(readOption(client.getSocket(), IPPROTO_TCP, TCP_CORK), 1);
+    EXPECT_EQ(readOption(client.getSocket(), IPPROTO_TCP, TCP_NODELAY), 1);
+
+    ::close(serverFd);
+}
+
+// Test to verify the bulk preset enlarges the kernel buffers
+TEST(SocketOptionsTest, BulkThroughputPreset)
+{
+    auto connection = createConnection("127.0.0.1", "", true, TCP);
+    int defaultBuffer = readOption(connection->getSocket(), SOL_SOCKET, SO_SNDBUF);
+
+    connection->changeOptions(SocketOptions::bulkThroughput());
+
+    EXPECT_GT(readOption(connection->getSocket(), SOL_SOCKET, SO_SNDBUF), defaultBuffer);
+    EXPECT_EQ(readOption(connection->getSocket(), IPPROTO_TCP, TCP_NODELAY), 0);
+}
+
+// Test to verify TCP-level options are skipped on UDP sockets and rejected values throw
+TEST(SocketOptionsTest, UdpAndErrors)
+{
+    auto connection = createConnection("127.0.0.1", "", true, UDP, SocketOptions::lowLatency());
+    EXPECT_EQ(readOption(connection->getSocket(), SOL_SOCKET, SO_PRIORITY), 6);
+
+    SocketOptions invalid;
+    invalid.keepAliveIdle = -1;
+    auto tcp = createConnection("127.0.0.1", "", true, TCP);
+    EXPECT_THROW(tcp->changeOptions(invalid), std::runtime_error);
+}
+
+#endif // SOCKET_OPTIONS_TEST_HPP
@@ -0,0 +1,172 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef SOCKET_TEST_HPP
+#define SOCKET_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+#include <array>
+
+namespace
+{
+    // Receive exactly length bytes from a stream socket.
+    template <typename Stream>
+    std::string receiveAll(Stream& stream, size_t length)
+    {
+        std::string received(length, '\0');
+        size_t offset = 0;
+        while (offset < length)
+        {
+            const ssize_t bytes = stream.receive(std::as_writable_bytes(std::span(received)).subspan(offset));
+            if (bytes <= 0)
+            {
+                break;
+            }
+            offset += static_cast<size_t>(bytes);
+        }
+        received.resize(offset);
+        return received;
+    }
+} // namespace
+
+// Test to verify an IPv4 stream socket binds a free port, accepts a client and echoes a message
+TEST(SocketTest, TcpIPv4Echo)
+{
+    Socket<Tcp, IPv4> listener;
+    listener.bindAny();
+    listener.listen();
+    ASSERT_NE(listener.localPort(), 0);
+
+    auto address = IPv4::any(listener.localPort());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Socket<Tcp, IPv4> client;
+    client.connect(address);
+    IPv4::Address peer {};
+    auto server = listener.accept(&peer);
+    ASSERT_TRUE(server.has_value());
+    EXPECT_EQ(IPv4::port(peer), client.localPort());
+
+    const std::string message(100000, 'x');
+    EXPECT_EQ(client.send(message), message.size());
+    EXPECT_EQ(receiveAll(*server, message.size()), message);
+
+    server->send("pong");
+    EXPECT_EQ(receiveAll(client, 4), "pong");
+
+    ::close(server->release());
+    std::array<std::byte, 16> buffer {};
+    EXPECT_EQ(client.receive(buffer), 0);
+}
+
+// Test to verify an IPv6 stream socket connects to a resolved address and rejects one of the other family
+TEST(SocketTest, TcpIPv6Resolved)
+{
+    Socket<Tcp, IPv6> listener;
+    auto address = IPv6::any(0);
+    address.sin6_addr = in6addr_loopback;
+    listener.bind(address);
+    listener.listen();
+
+    auto endpoint = Resolver::instance().resolve("::1", std::to_string(listener.localPort()), AF_INET6, SOCK_STREAM);
+    Socket<Tcp, IPv6> client;
+    client.connect(endpoint.front());
+    auto server = listener.accept();
+    ASSERT_TRUE(server.has_value());
+
+    client.send("hello");
+    EXPECT_EQ(receiveAll(*server, 5), "hello");
+
+    auto v4Endpoint = Resolver::instance().resolve("127.0.0.1", "80", AF_INET, SOCK_STREAM);
+    Socket<Tcp, IPv6> other;
+    EXPECT_THROW(other.connect(v4Endpoint.front()), std::invalid_argument);
+}
+
+// Test to verify datagram sockets keep boundaries and report the sender, and non-blocking calls do not wait
+TEST(SocketTest, UdpAndNonBlocking)
+{
+    Socket<Udp, IPv4> receiver(false);
+    auto address = IPv4::any(0);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    receiver.bind(address);
+    address.sin_port = htons(receiver.localPort());
+
+    std::array<std::byte, 64> buffer {};
+    IPv4::Address source {};
+    EXPECT_EQ(receiver.receiveFrom(buffer, source), ERROR);
+
+    Socket<Udp, IPv4> sender;
+    sender.bindAny();
+    EXPECT_EQ(sender.sendTo("first", address), 5u);
+    EXPECT_EQ(sender.sendTo("second", address), 6u);
+
+    EXPECT_EQ(receiver.receiveFrom(buffer, source), 5);
+    EXPECT_EQ(IPv4::port(source), sender.localPort());
+    EXPECT_EQ(receiver.receiveFrom(buffer, source), 6);
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(buffer.data()), 6), "second");
+
+    Socket<Tcp, IPv4> listener(false);
+    listener.bindAny();
+    listener.listen();
+    EXPECT_FALSE(listener.accept().has_value());
+}
+
+// Test to verify TCP connections expose their socket and blocking timeouts surface as TimeoutError
+TEST(SocketTest, ConnectionStreamAndTimeout)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    const int serverFd = server.connect();
+
+    EXPECT_EQ(client.stream().fd(), client.getSocket());
+    client.stream().send("inline");
+    EXPECT_EQ(server.receiveFrom(serverFd), "inline");
+
+    SocketOptions options;
+    options.receiveTimeout = std::chrono::milliseconds(20);
+    client.stream().setOptions(options);
+    std::array<std::byte, 16> buffer {};
+    EXPECT_THROW(client.stream().receive(buffer), TimeoutError);
+    ::close(serverFd);
+}
+
+// Test to verify a connect to a peer that never answers gives up at the deadline
+TEST(SocketTest, ConnectTimeout)
+{
+    // A full accept queue makes the kernel drop further SYNs, as on an unreachable host.
+    Socket<Tcp, IPv4> listener;
+    auto address = IPv4::any(0);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listener.bind(address);
+    listener.listen(0);
+    address.sin_port = htons(listener.localPort());
+    Socket<Tcp, IPv4> fillers[2] = {Socket<Tcp, IPv4>(false), Socket<Tcp, IPv4>(false)};
+    for (auto& filler : fillers)
+    {
+        ::connect(filler.fd(), reinterpret_cast<const struct sockaddr*>(&address), sizeof(address));
+    }
+
+    Socket<Tcp, IPv4> client;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW(client.connect(address, std::chrono::milliseconds(50)), TimeoutError);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    EXPECT_FALSE(fcntl(client.fd(), F_GETFL, 0) & O_NONBLOCK);
+}
+
+#endif // SOCKET_TEST_HPP
@@ -0,0 +1,97 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef TIMING_WHEEL_TEST_HPP
+#define TIMING_WHEEL_TEST_HPP
+
+#include "timingWheel.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify timers fire in deadline order, never early, and can be cancelled or re-armed
+TEST(TimingWheelTest, OrderCancelAndReschedule)
+{
+    TimingWheel wheel;
+    EXPECT_EQ(wheel.timeoutMs(), -1);
+
+    const auto start = TimingWheel::Clock::now();
+    std::vector<int> fired;
+    wheel.schedule(std::chrono::milliseconds(60), [&fired] { fired.push_back(3); });
+    wheel.schedule(std::chrono::milliseconds(10), [&fired] { fired.push_back(1); });
+    uint64_t moved = wheel.schedule(std::chrono::milliseconds(5), [&fired] { fired.push_back(2); });
+    uint64_t cancelled = wheel.schedule(std::chrono::milliseconds(20), [&fired] { fired.push_back(4); });
+    EXPECT_EQ(wheel.size(), 4u);
+    EXPECT_LE(wheel.timeoutMs(), 6);
+
+    EXPECT_TRUE(wheel.cancel(cancelled));
+    EXPECT_FALSE(wheel.cancel(cancelled));
+    EXPECT_TRUE(wheel.reschedule(moved, std::chrono::milliseconds(20)));
+
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(9)), 0u);
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(45)), 2u);
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(80)), 1u);
+    EXPECT_EQ(fired, (std::vector<int> {1, 2, 3}));
+    EXPECT_EQ(wheel.size(), 0u);
+    EXPECT_FALSE(wheel.reschedule(moved, std::chrono::milliseconds(1)));
+}
+
+// Test to verify timers further than one turn wait for their own turn, and tasks may re-arm timers
+TEST(TimingWheelTest, SeveralTurnsAndRearmFromTask)
+{
+    TimingWheel wheel(std::chrono::milliseconds(1), 64);
+    const auto start = TimingWheel::Clock::now();
+
+    int fired = 0;
+    uint64_t periodic = 0;
+    periodic = wheel.schedule(std::chrono::milliseconds(200),
+                              [&]
+                              {
+                                  ++fired;
+                                  wheel.schedule(std::chrono::milliseconds(100), [&fired] { fired += 10; });
+                              });
+    EXPECT_NE(periodic, 0u);
+
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(130)), 0u);
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(205)), 1u);
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_EQ(wheel.advance(start + std::chrono::milliseconds(400)), 1u);
+    EXPECT_EQ(fired, 11);
+
+    EXPECT_THROW(TimingWheel(std::chrono::milliseconds(1), 100), std::invalid_argument);
+}
+
+// Test to verify arming and cancelling stay cheap with hundreds of thousands of timers
+TEST(TimingWheelTest, ManyTimers)
+{
+    constexpr size_t COUNT = 200000;
+    TimingWheel wheel;
+    std::vector<uint64_t> ids;
+    ids.reserve(COUNT);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ids.push_back(wheel.schedule(std::chrono::milliseconds(1000 + i % 60000), [] {}));
+    }
+    EXPECT_EQ(wheel.size(), COUNT);
+
+    for (size_t i = 0; i < COUNT; i += 2)
+    {
+        EXPECT_TRUE(wheel.cancel(ids[i]));
+    }
+    EXPECT_EQ(wheel.size(), COUNT / 2);
+    EXPECT_EQ(wheel.advance(TimingWheel::Clock::now() + std::chrono::minutes(2)), COUNT / 2);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+#endif // TIMING_WHEEL_TEST_HPP
@@ -0,0 +1,138 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef URING_LOOP_TEST_HPP
+#define URING_LOOP_TEST_HPP
+
+#include "uringLoop.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify accepted clients are served and echoed through io_uring
+TEST(UringLoopTest, AcceptAndEcho)
+{
+    if (!UringLoop::isSupported())
+    {
+        GTEST_SKIP();
+    }
+
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    UringLoop loop;
+    bool closed = false;
+
+    UringLoop::Handlers handlers;
+    handlers.onData = [&](int fd, std::string_view data)
+    {
+        if (data.empty())
+        {
+            closed = true;
+            loop.remove(fd);
+            return;
+        }
+        loop.send(fd, std::string(data));
+    };
+    loop.listen(server, handlers);
+
+    {
+        TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+        client.connect();
+        client.send("Hello, ring!");
+
+        std::thread reader([&client] { EXPECT_EQ(client.receive(), "Hello, ring!"); });
+        for (int i = 0; i < 20 && loop.stats().messages == 0; ++i)
+        {
+            loop.runOnce(50);
+        }
+        loop.runOnce(50);
+        reader.join();
+    }
+
+    for (int i = 0; i < 20 && !closed; ++i)
+    {
+        loop.runOnce(50);
+    }
+
+    EXPECT_TRUE(closed);
+    EXPECT_GT(loop.stats().enterCalls, 0u);
+}
+
+// Test to verify a peer that shuts down its side still gets the reply queued after end of input
+TEST(UringLoopTest, HalfCloseStillReplies)
+{
+    if (!UringLoop::isSupported())
+    {
+        GTEST_SKIP();
+    }
+
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+
+    UringLoop loop;
+    std::string received;
+    bool replied = false;
+    bool closed = false;
+
+    UringLoop::Handlers handlers;
+    handlers.onData = [&](int fd, std::string_view data)
+    {
+        received.append(data);
+        if (data.empty())
+        {
+            replied = loop.send(fd, "done");
+            loop.remove(fd);
+        }
+    };
+    handlers.onClosed = [&](int) { closed = true; };
+    loop.listen(server, handlers);
+
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    client.send("request");
+    ::shutdown(client.getSocket(), SHUT_WR);
+
+    for (int i = 0; i < 20 && !replied; ++i)
+    {
+        loop.runOnce(50);
+    }
+    // Flushes the reply; the socket is released once it is written.
+    loop.runOnce(50);
+
+    EXPECT_EQ(received, "request");
+    ASSERT_TRUE(replied);
+    EXPECT_EQ(client.receive(), "done");
+    EXPECT_THROW(client.receive(), std::runtime_error);
+    EXPECT_FALSE(closed);
+}
+
+// Test to verify stop() makes run() return
+TEST(UringLoopTest, StopFromAnotherThread)
+{
+    if (!UringLoop::isSupported())
+    {
+        GTEST_SKIP();
+    }
+
+    UringLoop loop;
+    std::thread stopper([&loop] { loop.stop(); });
+
+    loop.run();
+    stopper.join();
+
+    SUCCEED();
+}
+
+#endif // URING_LOOP_TEST_HPP
@@ -0,0 +1,156 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef WORK_STEALING_POOL_TEST_HPP
+#define WORK_STEALING_POOL_TEST_HPP
+
+#include "workStealingPool.hpp"
+#include "gtest/gtest.h"
+
+// Test to verify the owner pops newest first while thieves take the oldest task
+TEST(WorkStealingDequeTest, OwnerAndThiefEnds)
+{
+    WorkStealingDeque deque(2);
+    std::vector<int> order;
+    for (int i = 0; i < 5; ++i)
+    {
+        deque.push(new Task([&order, i] { order.push_back(i); }));
+    }
+
+    std::unique_ptr<Task> stolen(deque.steal());
+    std::unique_ptr<Task> popped(deque.pop());
+    ASSERT_TRUE(stolen && popped);
+    (*stolen)();
+    (*popped)();
+    EXPECT_EQ(order, (std::vector<int> {0, 4}));
+}
+
+// Test to verify every task is taken exactly once while several thieves race the owner
+TEST(WorkStealingDequeTest, ConcurrentSteal)
+{
+    constexpr int tasks = 20000;
+    WorkStealingDeque deque(64);
+    std::atomic<int> executed {0};
+    std::atomic<bool> done {false};
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; ++i)
+    {
+        thieves.emplace_back(
+            [&]
+            {
+                while (!done)
+                {
+                    if (Task* task = deque.steal())
+                    {
+                        (*task)();
+                        delete task;
+                    }
+                }
+            });
+    }
+
+    for (int i = 0; i < tasks; ++i)
+    {
+        deque.push(new Task([&executed] { ++executed; }));
+        if (i % 3 == 0)
+        {
+            if (Task* task = deque.pop())
+            {
+                (*task)();
+                delete task;
+            }
+        }
+    }
+    while (Task* task = deque.pop())
+    {
+        (*task)();
+        delete task;
+    }
+    while (executed < tasks)
+    {
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto& thief : thieves)
+    {
+        thief.join();
+    }
+
+    EXPECT_EQ(executed, tasks);
+}
+
+// Test to verify tasks submitted from inside the pool are run and spread across workers
+TEST(WorkStealingPoolTest, NestedSubmissions)
+{
+    WorkStealingPool pool(4);
+    std::atomic<int> executed {0};
+
+    pool.submit(
+        [&]
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                pool.submit([&executed] { ++executed; });
+            }
+        });
+    pool.wait();
+
+    EXPECT_EQ(executed, 1000);
+    EXPECT_EQ(pool.counters().executed, 1001u);
+}
+
+// Test to verify the destructor runs every task still queued
+TEST(WorkStealingPoolTest, DestructorDrains)
+{
+    std::atomic<int> executed {0};
+    {
+        WorkStealingPool pool(2);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.submit(
+                [&executed]
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    ++executed;
+                });
+        }
+    }
+    EXPECT_EQ(executed, 100);
+}
+
+// Test to verify a throwing task neither stops its worker nor keeps wait() blocked, and wait() rethrows it
+TEST(WorkStealingPoolTest, ThrowingTask)
+{
+    WorkStealingPool pool(2);
+    std::atomic<int> executed {0};
+    pool.submit([] { throw std::runtime_error("Error: task failed"); });
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.submit([&executed] { ++executed; });
+    }
+
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    EXPECT_EQ(executed, 100);
+    EXPECT_EQ(pool.counters().executed, 101u);
+
+    // The error is reported once; the pool keeps running tasks afterwards.
+    pool.submit([&executed] { ++executed; });
+    EXPECT_NO_THROW(pool.wait());
+    EXPECT_EQ(executed, 101);
+}
+
+#endif // WORK_STEALING_POOL_TEST_HPP
@@ -0,0 +1,161 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef WRITE_QUEUE_TEST_HPP
+#define WRITE_QUEUE_TEST_HPP
+
+#include "cppSocket.hpp"
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+
+namespace
+{
+    constexpr auto CHUNK_SIZE = 64 * 1024; // Bytes handed to each send() by the tests.
+
+    std::string makeChunk(size_t index)
+    {
+        return std::string(CHUNK_SIZE, static_cast<char>('a' + index % 26));
+    }
+
+    // Read every byte until the peer closes, checking the chunks arrive whole and in order.
+    size_t readChunks(int fd, bool& ordered)
+    {
+        std::vector<char> buffer(CHUNK_SIZE);
+        size_t total = 0;
+        ordered = true;
+        ssize_t bytes;
+        while ((bytes = ::recv(fd, buffer.data(), buffer.size(), 0)) > 0)
+        {
+            for (ssize_t i = 0; i < bytes; ++i)
+            {
+                ordered = ordered && buffer[i] == static_cast<char>('a' + (total + i) / CHUNK_SIZE % 26);
+            }
+            total += static_cast<size_t>(bytes);
+        }
+        return total;
+    }
+} // namespace
+
+// Test to verify TCP honors non-blocking mode on connect, accept and accepted sockets
+TEST(WriteQueueTest, NonBlockingConnectAndAccept)
+{
+    TCPv4Connection server("127.0.0.1", "", false);
+    server.bind();
+    EXPECT_EQ(server.connect(), ERROR);
+
+    TCPv4Connection client("127.0.0.1", server.GetPort(), false);
+    EXPECT_NE(fcntl(client.getSocket(), F_GETFL, 0) & O_NONBLOCK, 0);
+    EXPECT_NO_THROW(client.connect());
+    ASSERT_NE(client.writeQueue(), nullptr);
+
+    int serverFd = server.connect();
+    ASSERT_GE(serverFd, 0);
+    EXPECT_NE(fcntl(serverFd, F_GETFL, 0) & O_NONBLOCK, 0);
+
+    TCPv4Connection blocking("127.0.0.1", server.GetPort(), true);
+    EXPECT_EQ(blocking.writeQueue(), nullptr);
+    EXPECT_EQ(blocking.flush(), 0u);
+
+    ::close(serverFd);
+}
+
+// Test to verify a slow peer throttles the producer and the queue resumes from EventLoop writability
+TEST(WriteQueueTest, WatermarksAndResume)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), false);
+    client.connect();
+    int serverFd = server.connect();
+
+    int highs = 0;
+    int lows = 0;
+    WriteQueue& queue = *client.writeQueue();
+    queue.setWatermarks(4 * CHUNK_SIZE, CHUNK_SIZE);
+    queue.setCallbacks([&highs] { ++highs; }, [&lows] { ++lows; });
+
+    // Nobody reads yet: the socket fills up, then the queue reaches its high watermark.
+    size_t accepted = 0;
+    while (client.send(makeChunk(accepted)))
+    {
+        ++accepted;
+        ASSERT_LT(accepted, 100000u);
+    }
+    EXPECT_TRUE(queue.throttled());
+    EXPECT_GE(queue.pending(), 4u * CHUNK_SIZE);
+    EXPECT_EQ(highs, 1);
+
+    bool ordered = false;
+    size_t received = 0;
+    std::thread reader([&] { received = readChunks(serverFd, ordered); });
+
+    EventLoop loop;
+    EventLoop::Handlers handlers;
+    handlers.onWritable = [&client](int) { client.flush(); };
+    loop.add(client.getSocket(), handlers);
+    for (int i = 0; i < 200 && queue.pending() > 0; ++i)
+    {
+        loop.runOnce(50);
+    }
+    loop.remove(client.getSocket());
+
+    EXPECT_EQ(queue.pending(), 0u);
+    EXPECT_FALSE(queue.throttled());
+    EXPECT_EQ(lows, 1);
+
+    ::shutdown(client.getSocket(), SHUT_WR);
+    reader.join();
+    EXPECT_EQ(received, accepted * CHUNK_SIZE);
+    EXPECT_TRUE(ordered);
+
+    ::close(serverFd);
+}
+
+// Test to verify a blocking send writes every byte of a message larger than the socket buffer
+TEST(WriteQueueTest, BlockingSendIsComplete)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    std::string message;
+    for (size_t i = 0; i < 64; ++i)
+    {
+        message += makeChunk(i);
+    }
+
+    bool ordered = false;
+    size_t received = 0;
+    std::thread reader([&] { received = readChunks(serverFd, ordered); });
+    EXPECT_TRUE(client.send(message));
+    ::shutdown(client.getSocket(), SHUT_WR);
+    reader.join();
+
+    EXPECT_EQ(received, message.size());
+    EXPECT_TRUE(ordered);
+    ::close(serverFd);
+}
+
+// Test to verify inconsistent watermarks are rejected
+TEST(WriteQueueTest, InvalidWatermarks)
+{
+    EXPECT_THROW(WriteQueue(-1, 10, 20), std::invalid_argument);
+}
+
+#endif // WRITE_QUEUE_TEST_HPP
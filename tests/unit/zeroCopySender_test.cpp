@@ -0,0 +1,198 @@
+/*
+ * Socket Library - cppSocketWrapperTest
+ * Copyright (C) 2024, Operating Systems II.
+ * Apr 23, 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ */
+
+#ifndef ZERO_COPY_SENDER_TEST_HPP
+#define ZERO_COPY_SENDER_TEST_HPP
+
+#include "zeroCopySender.hpp"
+#include "gtest/gtest.h"
+
+#include <poll.h>
+#include <thread>
+
+namespace
+{
+    // Read from the accepted socket until the expected number of bytes arrived.
+    std::string drain(TCPv4Connection& server, int fd, size_t expected)
+    {
+        std::string received;
+        std::vector<std::byte> buffer(65536);
+        while (received.size() < expected)
+        {
+            ssize_t bytes = server.receiveFrom(fd, buffer);
+            if (bytes <= 0)
+            {
+                break;
+            }
+            received.append(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(bytes));
+        }
+        return received;
+    }
+} // namespace
+
+// Test to verify a large payload is sent intact and its completion fires exactly once
+TEST(ZeroCopySenderTest, LargeSendCompletes)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    ZeroCopySender sender(client);
+    if (!sender.enabled())
+    {
+        ::close(serverFd);
+        GTEST_SKIP();
+    }
+
+    std::string payload(1024 * 1024, '\0');
+    for (size_t i = 0; i < payload.size(); ++i)
+    {
+        payload[i] = static_cast<char>(i * 31);
+    }
+
+    std::string received;
+    std::thread reader([&] { received = drain(server, serverFd, payload.size()); });
+
+    int completions = 0;
+    EXPECT_TRUE(sender.send(payload, [&completions](bool) { ++completions; }));
+    sender.flush();
+    reader.join();
+
+    EXPECT_EQ(completions, 1);
+    EXPECT_EQ(sender.pending(), 0u);
+    EXPECT_GT(sender.counters().zeroCopySends, 0u);
+    EXPECT_EQ(received, payload);
+
+    ::close(serverFd);
+}
+
+// Test to verify payloads below the threshold take the copying path and complete immediately
+TEST(ZeroCopySenderTest, SmallSendCopies)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    ZeroCopySender sender(client, -1, 4096);
+    auto copied = sender.send("Hello, world!");
+
+    ASSERT_EQ(copied.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_TRUE(copied.get());
+    EXPECT_EQ(sender.pending(), 0u);
+    EXPECT_EQ(sender.counters().copiedSends, 1u);
+    EXPECT_EQ(sender.counters().zeroCopySends, 0u);
+    EXPECT_EQ(drain(server, serverFd, 13), "Hello, world!");
+
+    ::close(serverFd);
+}
+
+// Test to verify payloads are refused, not reported done, while the write queue holds earlier bytes
+TEST(ZeroCopySenderTest, WaitsForWriteQueue)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), false);
+    client.connect();
+    int serverFd = server.connect();
+
+    int sendBuffer = 16384;
+    setsockopt(client.getSocket(), SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    client.writeQueue()->setWatermarks(1, 0);
+
+    ZeroCopySender copying(client, -1, 8 * 1024 * 1024);
+    const std::string first(512 * 1024, 'a');
+    int completions = 0;
+    EXPECT_TRUE(copying.send(first, [&completions](bool) { ++completions; }));
+    ASSERT_GT(client.writeQueue()->pending(), 0u);
+
+    // The queue is throttled: the copy is refused and its completion never runs.
+    EXPECT_FALSE(copying.send(first, [&completions](bool) { ++completions; }));
+    EXPECT_EQ(completions, 1);
+    auto refused = copying.send("late");
+    ASSERT_EQ(refused.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_THROW(refused.get(), std::runtime_error);
+    EXPECT_EQ(copying.counters().copiedSends, 1u);
+
+    ZeroCopySender zeroCopy(client, -1, 1024);
+    if (zeroCopy.enabled())
+    {
+        const std::string large(256 * 1024, 'b');
+        EXPECT_FALSE(zeroCopy.send(large, [&completions](bool) { ++completions; }));
+        EXPECT_EQ(completions, 1);
+        EXPECT_EQ(zeroCopy.counters().zeroCopySends, 0u);
+    }
+
+    std::string received;
+    std::thread reader([&] { received = drain(server, serverFd, first.size()); });
+    while (client.writeQueue()->pending() > 0)
+    {
+        struct pollfd pollFd = {client.getSocket(), POLLOUT, 0};
+        ::poll(&pollFd, 1, 1000);
+        client.flush();
+    }
+    reader.join();
+    EXPECT_EQ(received, first);
+    ::close(serverFd);
+}
+
+// Test to verify EventLoop reports completions through onErrorQueue without closing the socket
+TEST(ZeroCopySenderTest, EventLoopErrorQueue)
+{
+    TCPv4Connection server("127.0.0.1", "", true);
+    server.bind();
+    TCPv4Connection client("127.0.0.1", server.GetPort(), true);
+    client.connect();
+    int serverFd = server.connect();
+
+    ZeroCopySender sender(client);
+    if (!sender.enabled())
+    {
+        ::close(serverFd);
+        GTEST_SKIP();
+    }
+
+    EventLoop loop;
+    bool closed = false;
+    int notifications = 0;
+    EventLoop::Handlers handlers;
+    handlers.onErrorQueue = [&](int) { notifications += static_cast<int>(sender.pollCompletions(0)); };
+    handlers.onClosed = [&closed](int) { closed = true; };
+    loop.add(client.getSocket(), handlers);
+
+    const std::string payload(256 * 1024, 'z');
+    std::thread reader([&] { EXPECT_EQ(drain(server, serverFd, payload.size()).size(), payload.size()); });
+
+    auto completed = sender.send(payload);
+    for (int i = 0; i < 50 && completed.wait_for(std::chrono::seconds(0)) != std::future_status::ready; ++i)
+    {
+        loop.runOnce(50);
+    }
+    reader.join();
+
+    ASSERT_EQ(completed.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_GT(notifications, 0);
+    EXPECT_FALSE(closed);
+    EXPECT_EQ(sender.pending(), 0u);
+
+    loop.remove(client.getSocket());
+    ::close(serverFd);
+}
+
+#endif // ZERO_COPY_SENDER_TEST_HPP